@@ -1,8 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <queue> 
@@ -16,7 +18,11 @@
 #include "training_example.hpp"
 #include "util.hpp"
 #include "MCTS/scorer.hpp"
+#include "MCTS/budget.hpp"
+#include "MCTS/move_allocator.hpp"
 #include "MCTS/search_node.hpp"
+#include "MCTS/search_policy.hpp"
+#include "MCTS/stop_condition.hpp"
 #include "MCTS/simulator/simulator.hpp"
 
 #define LOG_LEVEL 1
@@ -76,6 +82,9 @@ search_node* choose_move(search_node* node, double terminal_thresh) {
     }
   }
 
+  if (moves.empty()) {
+    return nullptr;
+  }
   auto random = util::get_random_int(0, moves.size() - 1, symreg::mt);
   return moves[random];
 }
@@ -83,37 +92,70 @@ search_node* choose_move(search_node* node, double terminal_thresh) {
 /**
  * @brief the actual coordinator for monte carlo tree search
  */
-template <class Regressor = symreg::DNN>
+template <class Regressor = symreg::DNN, class Policy = dynamic_policy>
 class MCTS {
   private:
     // MEMBERS
     const int num_simulations_;
+    search_budget budget_;
+    move_allocator allocator_;
     dataset& dataset_; 
     search_node root_;
     search_node* curr_;
     std::ofstream log_stream_;
     std::shared_ptr<brick::AST::AST> result_ast_;
     double terminal_thresh_ = .999;
-    simulator::simulator<Regressor> simulator_;
+    simulator::simulator<Regressor, Policy> simulator_;
     training_examples examples_;
+    int num_moves_;
+    bool stopped_;
+    bool charge_evaluations_;
+    std::chrono::nanoseconds deadline_overshoot_;
     // HELPERS
+    std::size_t get_spent() const;
+    void set_spending_limit(std::size_t);
     void write_game_state(int) const;
-    bool game_over();
+    bool make_move(search_node*);
+    void simulate_until_stopped(search_node*, std::size_t = std::numeric_limits<std::size_t>::max(), bool = false);
+    void simulate_adaptively(int);
+    void simulate_move(int, std::size_t = 0, std::size_t = 1);
+    int get_simulations_per_move() const;
     std::shared_ptr<brick::AST::AST> build_current_ast();
     std::vector<std::shared_ptr<brick::AST::AST>> top_asts_;
   public:
     // composable constructor for testability
-    MCTS(dataset&, simulator::simulator<Regressor>, int);
+    MCTS(dataset&, simulator::simulator<Regressor, Policy>, int);
     // .toml configurable
     MCTS(dataset&, Regressor*, util::config);
     void iterate();
+    void iterate(const stop_condition&);
+    void iterate(stop_condition::clock::time_point);
+    void iterate(cancel_token);
+    void iterate(const search_budget&, const stop_condition& = stop_condition());
+    bool game_over();
+    void simulate(std::size_t = 0, std::size_t = 1);
+    bool got_reward_within_thresh();
+    bool make_move(std::size_t);
+    void finish();
+    const search_node& get_current_node() const;
     std::string to_gv() const;
     dataset& get_dataset();
     void reset();
     std::shared_ptr<brick::AST::AST> get_result();
     std::vector<std::shared_ptr<brick::AST::AST>> get_top_n_asts();
+    std::vector<std::pair<std::shared_ptr<brick::AST::AST>, double>> get_scored_top_n_asts();
+    void raise_admission_threshold(double);
     training_examples get_training_examples() const;
     std::size_t get_num_explored() const;
+    std::size_t get_num_evaluations() const;
+    const simulator::pipeline_stats& get_pipeline_stats() const;
+    std::size_t get_num_equivalent() const;
+    void set_budget(search_budget);
+    const search_budget& get_budget() const;
+    void set_move_allocator(move_allocator);
+    const move_allocator& get_move_allocator() const;
+    bool was_stopped() const;
+    std::chrono::nanoseconds get_deadline_overshoot() const;
 };
 
 /**
@@ -125,19 +167,24 @@ class MCTS {
  * @param num_simulations the number of times you want the simulator
  * to simulate between moves
  */
-template <class Regressor>
-MCTS<Regressor>::MCTS(
+template <class Regressor, class Policy>
+MCTS<Regressor, Policy>::MCTS(
     dataset& ds,
-    simulator::simulator<Regressor> _simulator,
+    simulator::simulator<Regressor, Policy> _simulator,
     int num_simulations
 )
   : num_simulations_(num_simulations),
+    budget_(search_budget::per_move(num_simulations)),
     dataset_(ds), 
     root_(search_node(std::make_unique<brick::AST::posit_node>())),
     curr_(&root_),
     log_stream_("mcts.log"),
     result_ast_(nullptr),
-    simulator_(_simulator)
+    simulator_(_simulator),
+    num_moves_(0),
+    stopped_(false),
+    charge_evaluations_(false),
+    deadline_overshoot_(0)
 { 
   simulator_.add_actions(curr_);
 }
@@ -149,15 +196,21 @@ MCTS<Regressor>::MCTS(
  * value and policy
  * @param cfg a wrapper around a cpptoml table
  */ 
-template <class Regressor>
-MCTS<Regressor>::MCTS(dataset& ds, Regressor* regr, util::config cfg)
+template <class Regressor, class Policy>
+MCTS<Regressor, Policy>::MCTS(dataset& ds, Regressor* regr, util::config cfg)
   : num_simulations_(cfg.get<int>("mcts.num_simulations")),
+    budget_(search_budget::from_config(cfg)),
+    allocator_(cfg),
     dataset_(ds),
     root_(search_node(std::make_unique<brick::AST::posit_node>())),
     curr_(&root_),
     log_stream_(cfg.get<std::string>("logging.file")),
     result_ast_(nullptr),
-    simulator_(simulator::simulator<Regressor>(cfg, ds, regr)) 
+    simulator_(simulator::simulator<Regressor, Policy>(cfg, ds, regr)),
+    num_moves_(0),
+    stopped_(false),
+    charge_evaluations_(false),
+    deadline_overshoot_(0)
 {
   simulator_.add_actions(curr_);
 }
@@ -169,71 +222,401 @@ MCTS<Regressor>::MCTS(dataset& ds, Regressor* regr, util::config cfg)
  * which explores/expands the tree followed by a step
  * which heuristically decides a move to take in the tree.
  * If make_move() returns false, a move was not made in the
- * game, and the game is over.
- * 
- * @param n number determining how many time we wish to loop
+ * game, and the game is over. How much simulation is done is
+ * set by the search's budget, see search_budget.
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::iterate() {
+  iterate(budget_);
+}
+
+/**
+ * @brief like iterate(), but gives up once stop is met
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::iterate(const stop_condition& stop) {
+  iterate(budget_, stop);
+}
+
+/**
+ * @brief plays a game within budget, giving up early once stop is met
+ *
+ * With a per move budget every move gets the same number of simulations.
+ * With a total budget, each move gets an equal share of what is left,
+ * divided between the moves which may still be made before the depth
+ * limit. The simulator stops once a move's share is used up, exactly
+ * unless constant fitting charges a leaf's evaluation more than one pass.
+ * Whatever the game didn't need, and the whole budget when moves aren't
+ * committed to, is then spent simulating from the root, so the search
+ * uses all of its budget unless the tree is exhausted first.
+ *
+ * The stop condition is polled by the simulator between simulations and
+ * again before every move. Once it is met the game ends where it is, with
+ * the top N holding the best ASTs found so far. How long after the
+ * deadline this returns is available from get_deadline_overshoot().
+ *
+ * @param budget how much work the search may do
+ * @param stop when to give up
  */
-template <class Regressor>
-void MCTS<Regressor>::iterate() {
-  std::size_t i = 0;
-  while (true) {
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::iterate(const search_budget& budget, const stop_condition& stop) {
+  using clock = stop_condition::clock;
+  stopped_ = false;
+  charge_evaluations_ = budget.kind == search_budget::unit::point_evaluations;
+
+  stop_condition limit = stop;
+  std::size_t max_spent = std::numeric_limits<std::size_t>::max();
+  if (budget.kind == search_budget::unit::seconds) {
+    limit = stop.with_deadline(clock::now()
+      + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(budget.amount)));
+  } else if (budget.kind == search_budget::unit::rollouts) {
+    max_spent = get_spent() + static_cast<std::size_t>(budget.amount);
+  } else if (budget.kind == search_budget::unit::point_evaluations) {
+    // one evaluation of the dataset is kept for scoring the final AST
+    auto num_evaluations = static_cast<std::size_t>(budget.amount / std::max<std::size_t>(1, dataset_.x.size()));
+    max_spent = get_spent() + (num_evaluations > 0 ? num_evaluations - 1 : 0);
+  }
+  auto budget_spent = [&] {
+    return get_spent() >= max_spent || limit.should_stop();
+  };
+
+  simulator_.set_stop_condition(limit);
+  while (budget.commit_moves) {
     if (game_over()) {
       break;
     }
-    simulator_.simulate(curr_, num_simulations_);
+    if (!budget.is_total()) {
+      if (allocator_.is_enabled()) {
+        simulate_adaptively(static_cast<int>(budget.amount));
+      } else {
+        simulate_move(static_cast<int>(budget.amount));
+      }
+    } else {
+      std::size_t moves_left = std::max(1, simulator_.get_depth_limit() - curr_->get_depth());
+      std::size_t move_limit = std::numeric_limits<std::size_t>::max();
+      if (budget.kind == search_budget::unit::seconds) {
+        auto now = clock::now();
+        simulator_.set_stop_condition(limit.with_deadline(
+          now + (std::max(limit.get_deadline(), now) - now) / moves_left));
+      } else {
+        auto left = max_spent - std::min(max_spent, get_spent());
+        move_limit = get_spent() + (left + moves_left - 1) / moves_left;
+        set_spending_limit(move_limit);
+      }
+      // a move stopped early by the allocator leaves more for the next ones
+      simulate_until_stopped(curr_, move_limit, allocator_.is_enabled());
+    }
+
+    if (got_reward_within_thresh()) {
+      break;
+    }
+
+    if (stop.should_stop()) {
+      stopped_ = true;
+      break;
+    }
+
+    // a move can't be chosen between children nobody has simulated
+    if (budget.is_total() && budget_spent()) {
+      break;
+    }
+
+    if (!make_move(choose_move(curr_, terminal_thresh_))) {
+      break;
+    }
+  }
+
+  if (budget.is_total() && !got_reward_within_thresh() && !stopped_) {
+    simulator_.set_stop_condition(limit);
+    set_spending_limit(max_spent);
+    simulate_until_stopped(&root_);
+    stopped_ = stop.should_stop();
+  }
+
+  finish();
+  simulator_.set_stop_condition(stop_condition());
+  set_spending_limit(std::numeric_limits<std::size_t>::max());
+  charge_evaluations_ = false;
+
+  deadline_overshoot_ = std::chrono::nanoseconds(0);
+  if (limit.has_deadline()) {
+    deadline_overshoot_ = std::max(deadline_overshoot_,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - limit.get_deadline()));
+  }
+  #if LOG_LEVEL > 0
+  if (stopped_) {
+    log_stream_ << "Stopped after " << num_moves_ << " moves, deadline overshoot: "
+      << deadline_overshoot_.count() / 1000 << "us" << std::endl;
+  }
+  #endif
+}
 
-    if (simulator_.got_reward_within_thresh()) {
-      result_ast_ = simulator_.get_ast_within_thresh();
+/**
+ * @brief simulates from node in batches until the simulator's stop
+ * condition or explore limit is reached, an AST within the early
+ * termination threshold is found, or a batch makes no progress because
+ * there is nothing left below node to search
+ * @param node the node to simulate from
+ * @param move_limit the explore limit of this move, if it has one
+ * @param adaptive whether to also stop once the move allocator considers
+ * the move decided
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::simulate_until_stopped(search_node* node, std::size_t move_limit, bool adaptive) {
+  const int batch_size = adaptive ? allocator_.get_check_interval() : std::max(1, num_simulations_);
+  while (!simulator_.should_stop() && !simulator_.got_reward_within_thresh()) {
+    auto explored = get_num_explored();
+    simulator_.simulate(node, batch_size);
+    if (get_num_explored() == explored) {
+      break;
+    }
+    auto remaining = move_limit - std::min(move_limit, get_spent());
+    if (adaptive && allocator_.is_decided(*node,
+          std::min<std::size_t>(remaining, std::numeric_limits<long>::max()), terminal_thresh_)) {
       break;
     }
+  }
+  if (simulator_.got_reward_within_thresh()) {
+    result_ast_ = simulator_.get_ast_within_thresh();
+  }
+}
+
+/**
+ * @brief how much of a total budget counted in rollouts or point
+ * evaluations has been spent: explored leaves, or with a point evaluation
+ * budget, evaluations of the dataset
+ */
+template <class Regressor, class Policy>
+std::size_t MCTS<Regressor, Policy>::get_spent() const {
+  return charge_evaluations_ ? get_num_evaluations() : get_num_explored();
+}
+
+/**
+ * @brief has the simulator stop once get_spent() reaches limit
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::set_spending_limit(std::size_t limit) {
+  if (charge_evaluations_) {
+    simulator_.set_evaluation_limit(limit);
+  } else {
+    simulator_.set_explore_limit(limit);
+  }
+}
+
+/**
+ * @brief like iterate(), but gives up once deadline has passed
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::iterate(stop_condition::clock::time_point deadline) {
+  iterate(stop_condition(deadline));
+}
+
+/**
+ * @brief like iterate(), but gives up once token is cancelled
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::iterate(cancel_token token) {
+  iterate(stop_condition(token));
+}
 
-    search_node* prev = curr_;
-    examples_.push_back(
-      training_example{build_current_ast()->to_string(), curr_->get_pi(), 0}
-    );
-    curr_ = choose_move(curr_, terminal_thresh_);
-    #if LOG_LEVEL > 0
-    log_stream_ << "Iteration: " << i << std::endl;
-    write_game_state(i);
-    #endif
-    if (!curr_) {
-      curr_ = prev;
+/**
+ * @brief runs the current move's simulations in batches, stopping early
+ * once the move allocator considers the move decided or there is nothing
+ * left to search. simulations left over are carried forward to later moves
+ * @param num_simulations the move's share of simulations, before what
+ * earlier moves carried forward
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::simulate_adaptively(int num_simulations) {
+  int budget = allocator_.allocate(num_simulations);
+  int done = 0;
+  while (done < budget) {
+    int batch = std::min(allocator_.get_check_interval(), budget - done);
+    auto explored = get_num_explored();
+    simulator_.simulate(curr_, batch);
+    done += batch;
+    if (simulator_.got_reward_within_thresh() || simulator_.should_stop()) {
+      break;
+    }
+    // nothing left below the move to search
+    if (get_num_explored() == explored) {
+      break;
+    }
+    if (allocator_.is_decided(*curr_, budget - done, terminal_thresh_)) {
       break;
     }
-    i++;
   }
+  allocator_.give_back(budget - done);
+  if (simulator_.got_reward_within_thresh()) {
+    result_ast_ = simulator_.get_ast_within_thresh();
+  }
+}
+
+/**
+ * @brief runs one round of simulations from the current move, as many as
+ * the budget gives a move (see get_simulations_per_move())
+ *
+ * with more than one partition, only the children of the current node
+ * whose index is congruent to partition modulo num_partitions are
+ * simulated from, each getting an equal share of the round. this lets
+ * several searches split the subtrees of a move between them.
+ *
+ * with progressive widening, every pending move of the current node is
+ * attached, before partitioning and again after the round, so that
+ * searches whose visit counts differ still agree on the current node's
+ * children. nodes further down widen as usual.
+ *
+ * @param partition which share of the children to simulate from
+ * @param num_partitions the number of shares the children are split into
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::simulate(std::size_t partition, std::size_t num_partitions) {
+  simulate_move(get_simulations_per_move(), partition, num_partitions);
+  simulator_.attach_pending(curr_);
+}
+
+/**
+ * @brief how many simulations a round of simulate() runs: the budget's
+ * amount when it is per move, otherwise mcts.num_simulations
+ */
+template <class Regressor, class Policy>
+int MCTS<Regressor, Policy>::get_simulations_per_move() const {
+  return budget_.is_total() ? num_simulations_ : static_cast<int>(budget_.amount);
+}
+
+/**
+ * @brief runs a round of num_simulations simulations from the current
+ * move, see simulate()
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::simulate_move(int num_simulations, std::size_t partition,
+    std::size_t num_partitions) {
+  if (num_partitions <= 1) {
+    simulator_.simulate(curr_, num_simulations);
+  } else {
+    if (curr_->get_children().empty() && !simulator_.add_actions(curr_)) {
+      curr_->set_dead_end();
+      return;
+    }
+    simulator_.attach_pending(curr_);
+    auto& children = curr_->get_children();
+    std::size_t num_mine = 0;
+    for (std::size_t i = partition; i < children.size(); i += num_partitions) {
+      num_mine++;
+    }
+    int share = std::max<int>(1, num_simulations / std::max<std::size_t>(1, num_mine));
+    for (std::size_t i = partition; i < children.size(); i += num_partitions) {
+      simulator_.simulate(&children[i], share);
+      if (simulator_.got_reward_within_thresh() || simulator_.should_stop()) {
+        break;
+      }
+    }
+  }
+  if (simulator_.got_reward_within_thresh()) {
+    result_ast_ = simulator_.get_ast_within_thresh();
+  }
+}
+
+/**
+ * @brief checks whether simulation has encountered an AST whose reward
+ * is within the early termination threshold
+ */
+template <class Regressor, class Policy>
+bool MCTS<Regressor, Policy>::got_reward_within_thresh() {
+  return result_ast_.get();
+}
+
+/**
+ * @brief records a training example for the current move and then commits
+ * to next
+ * @param next the child of the current node to move to, or nullptr if no
+ * move could be made
+ * @return whether a move was made
+ */
+template <class Regressor, class Policy>
+bool MCTS<Regressor, Policy>::make_move(search_node* next) {
+  examples_.push_back(
+    training_example{build_current_ast()->to_string(), curr_->get_pi(), 0}
+  );
+  #if LOG_LEVEL > 0
+  log_stream_ << "Iteration: " << num_moves_ << std::endl;
+  write_game_state(num_moves_);
+  #endif
+  if (!next) {
+    return false;
+  }
+  curr_ = next;
+  num_moves_++;
+  return true;
+}
+
+/**
+ * @brief commits to a move chosen elsewhere, e.g. by a distributed
+ * coordinator
+ * @param child the index of the child of the current node to move to
+ * @return whether a move was made
+ */
+template <class Regressor, class Policy>
+bool MCTS<Regressor, Policy>::make_move(std::size_t child) {
+  auto& children = curr_->get_children();
+  return make_move(child < children.size() ? &children[child] : nullptr);
+}
 
+/**
+ * @brief wraps up a game: the final AST enters the top N and every
+ * training example is assigned the final AST's reward
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::finish() {
   if (result_ast_) {
     simulator_.push_priq(result_ast_);
   } else {
-    simulator_.push_priq(build_current_ast());
+    auto current_ast = build_current_ast();
+    // a game which was stopped early may end on an incomplete AST. it is
+    // only worth completing when nothing else was found
+    if (current_ast->get_num_unconnected() == 0) {
+      simulator_.push_priq(current_ast);
+    } else if (simulator_.dump_scored_pri_q().empty()) {
+      simulator_.push_priq(simulator_.complete(current_ast));
+    }
   }
 
-  // assign rewards to examples
-  auto final_ast = get_result();
-  auto final_reward = simulator_.get_reward(final_ast); 
+  // assign rewards to examples. the best AST's reward is already known
+  auto scored = simulator_.dump_scored_pri_q();
+  auto final_reward = scored.empty()
+    ? simulator_.get_reward(get_result())
+    : scored.back().second;
   for (auto& ex : examples_) {
     ex.reward = final_reward;
   }
 }
 
+/**
+ * @brief a getter for the node of the current move
+ */
+template <class Regressor, class Policy>
+const search_node& MCTS<Regressor, Policy>::get_current_node() const {
+  return *curr_;
+}
+
 /**
  * @brief writes the MCTS tree as a gv to file
  * @param iteration an integer which determines the name of the gv file
  */
-template <class Regressor>
-void MCTS<Regressor>::write_game_state(int iteration) const {
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::write_game_state(int iteration) const {
   std::ofstream out_file(std::to_string(iteration) + ".gv");
   out_file << to_gv() << std::endl;
 }
 
 /**
  * @brief a check to determine whether or not more simulation is possible
- * given the current move
+ * given the current move. a solved AST which is complete is never selected
+ * again, so it isn't necessarily marked as a dead end
  */
-template <class Regressor>
-bool MCTS<Regressor>::game_over() {
-  return curr_->is_dead_end();
+template <class Regressor, class Policy>
+bool MCTS<Regressor, Policy>::game_over() {
+  return curr_->is_dead_end() || (curr_->is_solved() && curr_->get_children().empty());
 }
 
 /**
@@ -242,8 +625,8 @@ bool MCTS<Regressor>::game_over() {
  *
  * @return the graph viz string representation
  */
-template <class Regressor>
-std::string MCTS<Regressor>::to_gv() const {
+template <class Regressor, class Policy>
+std::string MCTS<Regressor, Policy>::to_gv() const {
   std::stringstream ss;
   ss << "digraph {" << std::endl;
   ss << root_.to_gv();
@@ -256,8 +639,8 @@ std::string MCTS<Regressor>::to_gv() const {
  *
  * @return a non-const reference to the MCTS class' symbol table
  */
-template <class Regressor>
-dataset& MCTS<Regressor>::get_dataset() {
+template <class Regressor, class Policy>
+dataset& MCTS<Regressor, Policy>::get_dataset() {
   return dataset_;
 }
 
@@ -267,8 +650,8 @@ dataset& MCTS<Regressor>::get_dataset() {
  *
  * @return a shared pointer to an AST
  */
-template <class Regressor>
-std::shared_ptr<brick::AST::AST> MCTS<Regressor>::build_current_ast() {
+template <class Regressor, class Policy>
+std::shared_ptr<brick::AST::AST> MCTS<Regressor, Policy>::build_current_ast() {
   return simulator::build_ast_upward(curr_);
 }
 
@@ -277,50 +660,154 @@ std::shared_ptr<brick::AST::AST> MCTS<Regressor>::build_current_ast() {
  * @return if the simulator encountered an AST whose value
  * was within the early termination threshold, that AST is returned.
  * otherwise, we simply return the AST that was formed from traditional
- * move making within the tree.
+ * move making within the tree. if nothing has been searched yet, the
+ * AST formed by the current move is returned.
  */
-template <class Regressor>
-std::shared_ptr<brick::AST::AST> MCTS<Regressor>::get_result() {
-  return get_top_n_asts().back(); 
+template <class Regressor, class Policy>
+std::shared_ptr<brick::AST::AST> MCTS<Regressor, Policy>::get_result() {
+  auto top_n = get_top_n_asts();
+  if (top_n.empty()) {
+    return build_current_ast();
+  }
+  return top_n.back(); 
 }
 
 /**
  * @brief Resets the state of the MCTS search, allowing the next
  * iterate call to operate from a blank slate
  */
-template <class Regressor>
-void MCTS<Regressor>::reset() {
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::reset() {
   root_.get_children().clear();
+  root_.get_pending().clear();
   root_.set_q(0);
+  root_.set_mean_q(0);
+  root_.set_max_q(-std::numeric_limits<double>::infinity());
   root_.set_n(0);
+  root_.set_solved(false);
   curr_ = &root_;
   result_ast_ = nullptr;
   simulator_.reset();
   top_asts_.clear();
+  num_moves_ = 0;
+  allocator_.reset();
+  stopped_ = false;
+  deadline_overshoot_ = std::chrono::nanoseconds(0);
 }
 
-template <class Regressor>
-std::vector<std::shared_ptr<brick::AST::AST>> MCTS<Regressor>::get_top_n_asts() {
+template <class Regressor, class Policy>
+std::vector<std::shared_ptr<brick::AST::AST>> MCTS<Regressor, Policy>::get_top_n_asts() {
   if (top_asts_.empty()) {
     top_asts_ = simulator_.dump_pri_q();
   }
   return top_asts_;
 }
 
+/**
+ * @brief the top N ASTs paired with their rewards, worst first
+ */
+template <class Regressor, class Policy>
+std::vector<std::pair<std::shared_ptr<brick::AST::AST>, double>> MCTS<Regressor, Policy>::get_scored_top_n_asts() {
+  return simulator_.dump_scored_pri_q();
+}
+
+/**
+ * @brief stops ASTs whose reward doesn't beat threshold from entering the
+ * top N, e.g. because better ones were already found by other searches
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::raise_admission_threshold(double threshold) {
+  simulator_.raise_admission_threshold(threshold);
+}
+
 /**
  * @brief a getter for the training_examples needed to
  * train the regressor/neural network about MCTS states.
  * @return a copy of the training examples vector
  */
-template <class Regressor>
-training_examples MCTS<Regressor>::get_training_examples() const {
+template <class Regressor, class Policy>
+training_examples MCTS<Regressor, Policy>::get_training_examples() const {
   return examples_;
 }
 
-template <class Regressor>
-std::size_t MCTS<Regressor>::get_num_explored() const {
+template <class Regressor, class Policy>
+std::size_t MCTS<Regressor, Policy>::get_num_explored() const {
   return simulator_.get_num_explored();
 }
+
+/**
+ * @brief how many times the dataset was evaluated since the last reset,
+ * counting constant fitting, see simulator::get_num_evaluations()
+ */
+template <class Regressor, class Policy>
+std::size_t MCTS<Regressor, Policy>::get_num_evaluations() const {
+  return simulator_.get_num_evaluations();
+}
   
+/**
+ * @brief a getter for the stage timings of pipelined simulation, accumulated
+ * over every move since the last reset
+ */
+template <class Regressor, class Policy>
+const simulator::pipeline_stats& MCTS<Regressor, Policy>::get_pipeline_stats() const {
+  return simulator_.get_pipeline_stats();
+}
+
+/**
+ * @brief how many rollouts since the last reset computed the same function
+ * of the dataset as an earlier rollout. only counted with mcts.semantic_dedup
+ */
+template <class Regressor, class Policy>
+std::size_t MCTS<Regressor, Policy>::get_num_equivalent() const {
+  return simulator_.get_num_equivalent();
+}
+
+/**
+ * @brief sets the budget iterate() spends when it isn't given one
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::set_budget(search_budget budget) {
+  budget_ = budget;
+}
+
+/**
+ * @brief a getter for the budget iterate() spends when it isn't given one
+ */
+template <class Regressor, class Policy>
+const search_budget& MCTS<Regressor, Policy>::get_budget() const {
+  return budget_;
+}
+
+/**
+ * @brief sets when moves may stop simulating early, see move_allocator
+ */
+template <class Regressor, class Policy>
+void MCTS<Regressor, Policy>::set_move_allocator(move_allocator allocator) {
+  allocator_ = allocator;
+}
+
+template <class Regressor, class Policy>
+const move_allocator& MCTS<Regressor, Policy>::get_move_allocator() const {
+  return allocator_;
+}
+
+/**
+ * @brief whether the last iterate() call gave up because its stop condition
+ * was met
+ */
+template <class Regressor, class Policy>
+bool MCTS<Regressor, Policy>::was_stopped() const {
+  return stopped_;
+}
+
+/**
+ * @brief how long after its deadline the last iterate() call returned, or
+ * 0 if it had no deadline or returned before it
+ */
+template <class Regressor, class Policy>
+std::chrono::nanoseconds MCTS<Regressor, Policy>::get_deadline_overshoot() const {
+  return deadline_overshoot_;
+}
+
 }
 }
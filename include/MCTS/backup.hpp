@@ -0,0 +1,90 @@
+#pragma once
+
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "util.hpp"
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief how rewards are backed up the tree, i.e. what a search node's q
+ * value, the value scorers see, stands for.
+ *
+ *   - mean: the running mean of the rewards below the node. this is the
+ *     classic MCTS backup
+ *   - max: the best reward of any rollout below the node. a single
+ *     excellent expression isn't buried under many poor ones
+ *   - mixed: (1 - mix) * mean + mix * max
+ *
+ * Every search node keeps its best reward (search_node::get_max_q()) and,
+ * outside of mean mode, its mean reward (search_node::get_mean_q()), so
+ * backprop() only has to combine the two and store the result in q. The
+ * best reward of a node without any is -infinity, rewards being 1 - loss
+ * and mostly negative.
+ */
+struct backup_rule {
+  enum class kind { mean, max, mixed };
+  kind op = kind::mean;
+  double mix = .5;
+  bool is_mean() const;
+  double combine(double, double) const;
+  static backup_rule from_string(const std::string&, double = .5);
+  static backup_rule from_config(util::config&);
+};
+
+inline bool backup_rule::is_mean() const {
+  return op == kind::mean;
+}
+
+/**
+ * @brief the q value of a node given its reward statistics
+ * @param mean the mean reward below the node
+ * @param best the best reward below the node, -infinity if there's none
+ * yet, in which case the mean is returned
+ */
+inline double backup_rule::combine(double mean, double best) const {
+  if (best == -std::numeric_limits<double>::infinity()) {
+    return mean;
+  }
+  switch (op) {
+    case kind::max:
+      return best;
+    case kind::mixed:
+      return (1 - mix) * mean + mix * best;
+    default:
+      return mean;
+  }
+}
+
+/**
+ * @brief a backup rule given its name, "mean", "max" or "mixed"
+ * @param name the name of the rule
+ * @param mix the weight of the best reward in mixed mode
+ */
+inline backup_rule backup_rule::from_string(const std::string& name, double mix) {
+  if (name == "mean") {
+    return backup_rule{kind::mean, mix};
+  } else if (name == "max") {
+    return backup_rule{kind::max, mix};
+  } else if (name == "mixed") {
+    return backup_rule{kind::mixed, mix};
+  }
+  std::cerr << "Error: unknown backup rule: " << name << std::endl;
+  throw "InvalidBackupException";
+}
+
+/**
+ * @brief reads mcts.backup and mcts.backup_mix. the default is mean
+ */
+inline backup_rule backup_rule::from_config(util::config& cfg) {
+  return from_string(cfg.get_or<std::string>("mcts.backup", "mean"),
+      cfg.get_or<double>("mcts.backup_mix", .5));
+}
+
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "util.hpp"
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief how much work a search may do.
+ *
+ * simulations_per_move is the classic mode: every move gets the same
+ * number of simulations, so the total depends on how long the game is.
+ * The other modes bound the whole search instead:
+ *   - rollouts: the total number of leaf evaluations
+ *   - point_evaluations: the total number of dataset points evaluated.
+ *     every pass over the dataset is charged its size: a leaf's rollout
+ *     (or its inference by the regressor, in its stead), every pass
+ *     constant fitting makes and scoring the fitted AST, and scoring the
+ *     final AST. semantic keys hash the predictions the loss computed, so
+ *     they cost nothing extra
+ *   - seconds: wall-clock time
+ * With commit_moves, a total budget is spread over the moves which may
+ * still be made, and whatever the game didn't need is spent simulating
+ * from the root. Without it, no moves are made and the whole budget is
+ * spent simulating from the root.
+ */
+struct search_budget {
+  enum class unit { simulations_per_move, rollouts, point_evaluations, seconds };
+  unit kind = unit::simulations_per_move;
+  double amount = 0;
+  bool commit_moves = true;
+  bool is_total() const;
+  static search_budget per_move(int);
+  static search_budget rollouts(std::size_t, bool = true);
+  static search_budget point_evaluations(std::size_t, bool = true);
+  static search_budget seconds(double, bool = true);
+  static search_budget from_config(util::config&);
+};
+
+/**
+ * @brief whether this budget bounds the whole search rather than each move
+ */
+inline bool search_budget::is_total() const {
+  return kind != unit::simulations_per_move;
+}
+
+inline search_budget search_budget::per_move(int num_simulations) {
+  return search_budget{unit::simulations_per_move, static_cast<double>(num_simulations), true};
+}
+
+inline search_budget search_budget::rollouts(std::size_t num_rollouts, bool commit_moves) {
+  return search_budget{unit::rollouts, static_cast<double>(num_rollouts), commit_moves};
+}
+
+inline search_budget search_budget::point_evaluations(std::size_t num_points, bool commit_moves) {
+  return search_budget{unit::point_evaluations, static_cast<double>(num_points), commit_moves};
+}
+
+inline search_budget search_budget::seconds(double secs, bool commit_moves) {
+  return search_budget{unit::seconds, secs, commit_moves};
+}
+
+/**
+ * @brief reads mcts.budget_mode ("per_move", "rollouts",
+ * "point_evaluations" or "seconds"), mcts.budget and mcts.commit_moves.
+ * in per_move mode, or when no mode is configured, mcts.num_simulations
+ * is the budget
+ */
+inline search_budget search_budget::from_config(util::config& cfg) {
+  auto mode = cfg.get_or<std::string>("mcts.budget_mode", "per_move");
+  bool commit_moves = cfg.get_or<bool>("mcts.commit_moves", true);
+  if (mode == "per_move") {
+    return per_move(cfg.get<int>("mcts.num_simulations"));
+  } else if (mode == "rollouts") {
+    return rollouts(cfg.get<double>("mcts.budget"), commit_moves);
+  } else if (mode == "point_evaluations") {
+    return point_evaluations(cfg.get<double>("mcts.budget"), commit_moves);
+  } else if (mode == "seconds") {
+    return seconds(cfg.get<double>("mcts.budget"), commit_moves);
+  }
+  std::cerr << "Error: unknown budget mode: " << mode << std::endl;
+  throw "InvalidBudgetException";
+}
+
+}
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+#include "util.hpp"
+#include "MCTS/search_node.hpp"
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief decides when a move has been simulated enough, and carries the
+ * simulations it didn't need forward to later moves
+ *
+ * A move is decided once the most visited child (ignoring terminals whose
+ * value is below the terminal threshold unless there is nothing else, as
+ * choose_move() does) either
+ * can no longer be overtaken with the simulations left, or holds at least
+ * share_thresh of the visits. Neither check is made before
+ * min_simulations visits have been made below the move.
+ */
+class move_allocator {
+  private:
+    bool enabled_;
+    double share_thresh_;
+    int check_interval_;
+    int min_simulations_;
+    long carry_;
+  public:
+    move_allocator(bool = false, double = .9, int = 64, int = 64);
+    move_allocator(util::config&);
+    bool is_enabled() const;
+    int get_check_interval() const;
+    int allocate(int);
+    void give_back(int);
+    long get_carry() const;
+    bool is_decided(const search_node&, long, double) const;
+    void reset();
+};
+
+/**
+ * @brief move allocator constructor
+ * @param enabled whether moves may stop early at all
+ * @param share_thresh the visit share of the leading child which decides a
+ * move. 1 or more leaves only the can't-be-overtaken check
+ * @param check_interval how many simulations run between checks
+ * @param min_simulations how many visits a move needs before any check
+ */
+inline move_allocator::move_allocator(bool enabled, double share_thresh,
+    int check_interval, int min_simulations)
+  : enabled_(enabled),
+    share_thresh_(share_thresh),
+    check_interval_(std::max(1, check_interval)),
+    min_simulations_(min_simulations),
+    carry_(0)
+{}
+
+/**
+ * @brief .toml configurable move allocator constructor. reads
+ * mcts.adaptive_moves, mcts.adaptive_share, mcts.adaptive_check_every and
+ * mcts.adaptive_min_simulations
+ */
+inline move_allocator::move_allocator(util::config& cfg)
+  : move_allocator(cfg.get_or<bool>("mcts.adaptive_moves", false),
+      cfg.get_or<double>("mcts.adaptive_share", .9),
+      cfg.get_or<int>("mcts.adaptive_check_every", 64),
+      cfg.get_or<int>("mcts.adaptive_min_simulations", 64))
+{}
+
+inline bool move_allocator::is_enabled() const {
+  return enabled_;
+}
+
+inline int move_allocator::get_check_interval() const {
+  return check_interval_;
+}
+
+/**
+ * @brief the number of simulations a move may run: its own plus whatever
+ * earlier moves didn't use
+ * @param num_simulations the move's own simulations
+ */
+inline int move_allocator::allocate(int num_simulations) {
+  long total = num_simulations + carry_;
+  carry_ = 0;
+  return static_cast<int>(std::min<long>(total, std::numeric_limits<int>::max()));
+}
+
+/**
+ * @brief hands back the simulations a move didn't use, for later moves
+ */
+inline void move_allocator::give_back(int unused) {
+  carry_ += std::max(0, unused);
+}
+
+/**
+ * @brief the simulations handed back and not yet allocated again
+ */
+inline long move_allocator::get_carry() const {
+  return carry_;
+}
+
+/**
+ * @brief whether more simulation of node is unlikely to change which
+ * child is chosen as the move
+ * @param node the node of the current move
+ * @param remaining how many more simulations the move may run
+ * @param terminal_thresh see choose_move()
+ */
+inline bool move_allocator::is_decided(const search_node& node, long remaining,
+    double terminal_thresh) const {
+  long total = 0;
+  // the two most visited candidates, among moves and among weak terminals.
+  // like choose_move(), weak terminals are only candidates without moves
+  long first[2] = {-1, -1};
+  long second[2] = {0, 0};
+  for (auto& child : node.get_children()) {
+    long n = std::max(0, child.get_n());
+    total += n;
+    int weak = child.get_ast_node()->is_terminal() && child.get_q() < terminal_thresh;
+    if (n > first[weak]) {
+      second[weak] = std::max(0L, first[weak]);
+      first[weak] = n;
+    } else if (n > second[weak]) {
+      second[weak] = n;
+    }
+  }
+  int candidates = first[0] < 0 ? 1 : 0;
+  if (first[candidates] < 0 || total < min_simulations_) {
+    return false;
+  }
+  if (first[candidates] - second[candidates] > remaining) {
+    return true;
+  }
+  return first[candidates] >= share_thresh_ * total;
+}
+
+inline void move_allocator::reset() {
+  carry_ = 0;
+}
+
+}
+}
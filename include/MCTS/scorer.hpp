@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "util.hpp"
+
 namespace symreg
 {
 namespace MCTS
@@ -14,15 +20,66 @@ class scorer {
   public:
     virtual double score(double, int, int) = 0;
     virtual double score(double, int, int, double) = 0;
+    virtual double score(double, int, int, double, double);
+    virtual bool uses_priors() const;
+    virtual void configure(util::config&);
 };
 
+/**
+ * @brief scores a search node which has a prior. scorers which don't use
+ * priors ignore it
+ * @param child_val the q value of the node in question
+ * @param child_n the visit count of the node in question
+ * @param parent_n the visit count of the nodes parent
+ * @param avg_child_val the average q value of the parents children
+ * @param prior the node's prior probability (search_node::get_p())
+ */
+double scorer::score(double child_val, int child_n, int parent_n,
+    double avg_child_val, double) {
+  return score(child_val, child_n, parent_n, avg_child_val);
+}
+
+/**
+ * @brief whether the scorer weighs nodes by their priors. such scorers
+ * rank unvisited nodes by their priors too, so leaf pickers score them like
+ * any other node instead of trying every unvisited child first
+ */
+bool scorer::uses_priors() const {
+  return false;
+}
+
+/**
+ * @brief reads the scorer's parameters from a .toml config
+ */
+void scorer::configure(util::config&) {}
+
 /**
  * @brief a UCB1 scorer
  */
-class UCB1 : public scorer {
+class UCB1 final : public scorer {
+  public:
+    using scorer::score;
+    double score(double, int, int);
+    double score(double, int, int, double);
+};
+
+/**
+ * @brief a PUCT scorer, as in AlphaZero. a node's exploration bonus is
+ * weighted by its prior, so the children a regressor's policy favours are
+ * simulated first. every child is scored, visited or not
+ */
+class PUCT final : public scorer {
+  private:
+    double c_puct_;
   public:
+    PUCT(double = 1.5);
+    using scorer::score;
     double score(double, int, int);
     double score(double, int, int, double);
+    double score(double, int, int, double, double);
+    bool uses_priors() const;
+    void configure(util::config&);
+    double get_c_puct() const;
 };
 
 /**
@@ -42,18 +99,79 @@ double UCB1::score(double child_val, int child_n, int parent_n, double avg_child
 }
 
 /**
- * @brief gets a scorer instance given its string representation
+ * @brief PUCT constructor
+ * @param c_puct how strongly priors and exploration weigh against q values
+ */
+PUCT::PUCT(double c_puct)
+  : c_puct_(c_puct)
+{}
+
+/**
+ * @brief the PUCT value of a search node with a uniform prior
+ */
+double PUCT::score(double child_val, int child_n, int parent_n) {
+  return score(child_val, child_n, parent_n, 0, 1);
+}
+
+double PUCT::score(double child_val, int child_n, int parent_n, double avg_child_val) {
+  return score(child_val, child_n, parent_n, avg_child_val, 1);
+}
+
+/**
+ * @brief calculates the PUCT value of a search node
+ * @param child_val the q value of the node in question
+ * @param child_n the visit count of the node in question
+ * @param parent_n the visit count of the nodes parent
+ * @param prior the node's prior probability
+ * @return the PUCT value
+ */
+double PUCT::score(double child_val, int child_n, int parent_n, double, double prior) {
+  return child_val + c_puct_ * prior * sqrt(std::max(parent_n, 1)) / (1 + child_n);
+}
+
+bool PUCT::uses_priors() const {
+  return true;
+}
+
+/**
+ * @brief reads mcts.c_puct
+ */
+void PUCT::configure(util::config& cfg) {
+  c_puct_ = cfg.get_or<double>("mcts.c_puct", c_puct_);
+}
+
+double PUCT::get_c_puct() const {
+  return c_puct_;
+}
+
+/**
+ * @brief calls f with the type_tag of the scorer named scorer_str
  * @param scorer_str the string representation of a scorer
- * @return a scorer instance
+ * @param f a generic callable
+ * @return whatever f returns
  */
-std::shared_ptr<scorer> get(std::string scorer_str) {
+template <class F>
+decltype(auto) dispatch(const std::string& scorer_str, F&& f) {
   if (scorer_str == "UCB1") {
-    return std::make_shared<UCB1>();
+    return f(util::type_tag<UCB1>{});
+  } else if (scorer_str == "PUCT") {
+    return f(util::type_tag<PUCT>{});
   } else {
-    return std::make_shared<UCB1>();
+    return f(util::type_tag<UCB1>{});
   }
 }
 
+/**
+ * @brief gets a scorer instance given its string representation
+ * @param scorer_str the string representation of a scorer
+ * @return a scorer instance
+ */
+std::shared_ptr<scorer> get(std::string scorer_str) {
+  return dispatch(scorer_str, [](auto tag) -> std::shared_ptr<scorer> {
+    return std::make_shared<typename decltype(tag)::type>();
+  });
+}
+
 } // scorer
 } // MCTS
 } // symreg
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <cmath>
-#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
@@ -16,10 +15,22 @@ namespace symreg
    * @brief the node type which the MCTS tree is composed of
    */
   class search_node {
+    public:
+      /**
+       * @brief a move from a node which hasn't been attached as a child yet,
+       * see progressive widening in simulator::add_actions()
+       */
+      struct pending_child {
+        std::unique_ptr<brick::AST::node> ast_node;
+        search_node* up_link;
+        double p;
+      };
     private:
       // MEMBERS
       int n_;
       double q_;
+      double mean_q_;
+      double max_q_;
       double p_;
       int depth_;
       int unconnected_;
@@ -28,7 +39,11 @@ namespace symreg
       search_node* up_link_;
       std::vector<search_node> children_ = {};
       bool is_dead_end_;
-      std::function<double(double, int, int)> scorer_;
+      bool is_solved_;
+      double solved_value_;
+      std::size_t state_key_;
+      std::vector<pending_child> pending_;
+      int widen_at_;
     public:
       // LIFECYCLE
       search_node(std::unique_ptr<brick::AST::node>&&);
@@ -38,19 +53,26 @@ namespace symreg
       void set_up_link(search_node*);
       void add_child(std::unique_ptr<brick::AST::node>&&);
       void add_child(search_node&&);
-      void set_scorer(std::function<double(double, int, int)>);
       void set_n(int);
       void set_q(double);
+      void set_mean_q(double);
+      void set_max_q(double);
       void set_p(double);
       void set_depth(int);
       void set_unconnected(int);
       void set_dead_end();
+      void set_solved(bool, double = 0);
+      void set_state_key(std::size_t);
+      void set_widen_at(int);
       // ACCESSORS
       std::string to_gv() const;
       std::vector<search_node>& get_children();
+      const std::vector<search_node>& get_children() const;
       bool is_leaf_node() const;
       int get_n() const;
       double get_q() const;
+      double get_mean_q() const;
+      double get_max_q() const;
       double get_p() const;
       std::vector<double> get_pi();
       int get_depth() const;
@@ -59,9 +81,16 @@ namespace symreg
       bool is_terminal() const;
       search_node* get_up_link();
       std::unique_ptr<brick::AST::node>& get_ast_node();
+      const std::unique_ptr<brick::AST::node>& get_ast_node() const;
       bool is_visited() const;
       bool is_dead_end() const;
+      bool is_solved() const;
+      double get_solved_value() const;
+      std::size_t get_state_key() const;
       double get_avg_child_q() const;
+      std::vector<pending_child>& get_pending();
+      bool has_pending() const;
+      bool is_widening_due() const;
   };
   
   /**
@@ -76,12 +105,19 @@ namespace symreg
     search_node::search_node(std::unique_ptr<brick::AST::node>&& ast_node)
       : n_(0), 
         q_(0), 
+        mean_q_(0),
+        max_q_(-std::numeric_limits<double>::infinity()),
+        p_(1),
         depth_(0),
         unconnected_(1),
         ast_node_(std::move(ast_node)), 
         parent_(nullptr), 
         up_link_(nullptr),
-        is_dead_end_(false)
+        is_dead_end_(false),
+        is_solved_(false),
+        solved_value_(0),
+        state_key_(0),
+        widen_at_(0)
     {}
 
     /**
@@ -94,6 +130,9 @@ namespace symreg
     search_node::search_node(search_node&& other)
       : n_(other.n_),
         q_(other.q_),
+        mean_q_(other.mean_q_),
+        max_q_(other.max_q_),
+        p_(other.p_),
         depth_(other.depth_),
         unconnected_(other.unconnected_),
         ast_node_(std::move(other.ast_node_)),
@@ -101,7 +140,11 @@ namespace symreg
         up_link_(other.up_link_),
         children_(std::move(other.children_)),
         is_dead_end_(other.is_dead_end_),
-        scorer_(other.scorer_)
+        is_solved_(other.is_solved_),
+        solved_value_(other.solved_value_),
+        state_key_(other.state_key_),
+        pending_(std::move(other.pending_)),
+        widen_at_(other.widen_at_)
     {}
 
     /**
@@ -139,11 +182,6 @@ namespace symreg
       children_.push_back(std::move(child));
     }
 
-    // TODO: remove/change?
-    void search_node::set_scorer(std::function<double(double, int, int)> scorer) {
-      scorer_ = scorer;
-    }
-
     /**
      * @brief a setter for n (the number of times a node has been "visited")
      * @param val the value which we wish to set this nodes visit count to
@@ -160,7 +198,28 @@ namespace symreg
       q_ = val;
     }
 
-    // TODO: documentation here
+    /**
+     * @brief sets the mean of the rewards backed up through this node. only
+     * kept separately from q when q isn't the mean (see backup_rule)
+     * @param val the mean reward
+     */
+    void search_node::set_mean_q(double val) {
+      mean_q_ = val;
+    }
+
+    /**
+     * @brief sets the best reward backed up through this node
+     * @param val the best reward
+     */
+    void search_node::set_max_q(double val) {
+      max_q_ = val;
+    }
+
+    /**
+     * @brief sets this nodes prior, the probability a policy gives to choosing
+     * it from its parent
+     * @param val the prior
+     */
     void search_node::set_p(double val) {
       p_ = val;
     }
@@ -188,6 +247,34 @@ namespace symreg
       is_dead_end_ = true;
     }
 
+    /**
+     * @brief marks this node as solved, i.e. every AST below it has been
+     * evaluated, or clears the mark
+     * @param solved whether the node is solved
+     * @param value the exact best reward of any AST below the node
+     */
+    void search_node::set_solved(bool solved, double value) {
+      is_solved_ = solved;
+      solved_value_ = solved ? value : 0;
+    }
+
+    /**
+     * @brief sets the hash of the partial AST this node encodes, by which
+     * equivalent nodes are found in a transposition table
+     * @param key the hash. 0 leaves the node out of the table
+     */
+    void search_node::set_state_key(std::size_t key) {
+      state_key_ = key;
+    }
+
+    /**
+     * @brief sets the visit count from which on another pending child should
+     * be attached to this node
+     */
+    void search_node::set_widen_at(int n) {
+      widen_at_ = n;
+    }
+
     /**
      * @brief creates a graph viz string representation for a search node and
      * its children recursively
@@ -225,6 +312,10 @@ namespace symreg
       return children_;
     }
 
+    const std::vector<search_node>& search_node::get_children() const {
+      return children_;
+    }
+
     /**
      * @brief tells whether this search node has attached children
      * @return true if the node has no children, false otherwise
@@ -250,6 +341,17 @@ namespace symreg
       return q_;
     }
 
+    double search_node::get_mean_q() const {
+      return mean_q_;
+    }
+
+    /**
+     * @brief a getter for the best reward of any rollout below this node
+     */
+    double search_node::get_max_q() const {
+      return max_q_;
+    }
+
     // TODO: documentation here
     double search_node::get_p() const {
       return p_;
@@ -323,6 +425,10 @@ namespace symreg
       return ast_node_;
     } 
 
+    const std::unique_ptr<brick::AST::node>& search_node::get_ast_node() const {
+      return ast_node_;
+    }
+
     /**
      * @brief tells whether or not this node has been rolled out from
      * @return true if the node has been rolled out from, false if not
@@ -339,6 +445,25 @@ namespace symreg
       return is_dead_end_;
     }
 
+    /**
+     * @brief tells whether every AST below this node has been evaluated, in
+     * which case simulating it again can't find anything new
+     */
+    bool search_node::is_solved() const {
+      return is_solved_;
+    }
+
+    /**
+     * @brief the best reward of any AST below a solved node
+     */
+    double search_node::get_solved_value() const {
+      return solved_value_;
+    }
+
+    std::size_t search_node::get_state_key() const {
+      return state_key_;
+    }
+
     double search_node::get_avg_child_q() const {
       double sum = 0;
       for (auto& child : children_) {
@@ -347,4 +472,24 @@ namespace symreg
       return sum / children_.size();
     }
 
+    /**
+     * @brief the moves from this node which haven't been attached as
+     * children yet. the next one to be attached is at the back
+     */
+    std::vector<search_node::pending_child>& search_node::get_pending() {
+      return pending_;
+    }
+
+    bool search_node::has_pending() const {
+      return !pending_.empty();
+    }
+
+    /**
+     * @brief whether this node has been visited often enough for its next
+     * pending child to be attached. leaf pickers stop at such nodes
+     */
+    bool search_node::is_widening_due() const {
+      return !pending_.empty() && n_ >= widen_at_;
+    }
+
 }
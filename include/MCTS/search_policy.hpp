@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "loss.hpp"
+#include "util.hpp"
+#include "MCTS/scorer.hpp"
+#include "MCTS/search_node.hpp"
+#include "MCTS/simulator/leaf_picker.hpp"
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief the scorer, leaf picker and loss function a search is built with
+ *
+ * simulator and MCTS take a search_policy as a template parameter. with
+ * dynamic_policy, the components are picked at runtime and called through
+ * their interfaces. with concrete (final) component types, every call to
+ * them is resolved at compile time and can be inlined into the selection
+ * loop. with_search_policy() turns the names in a .toml config into the
+ * matching concrete search_policy.
+ */
+template <class Scorer, class LeafPicker, class Loss>
+struct search_policy {
+  using scorer_type = Scorer;
+  using leaf_picker_type = LeafPicker;
+  using loss_type = Loss;
+};
+
+using dynamic_policy = search_policy<
+  scorer::scorer,
+  simulator::leaf_picker::leaf_picker,
+  loss_fn::loss_fn
+>;
+
+/**
+ * @brief makes one component of a search policy. interfaces are looked up
+ * by name, concrete types are simply default constructed
+ * @param name the component's name in the config
+ * @param get the lookup function for the component's interface
+ */
+template <class T, class Get>
+std::shared_ptr<T> make_policy_component(const std::string& name, Get get) {
+  if constexpr (std::is_abstract_v<T>) {
+    return get(name);
+  } else {
+    return std::make_shared<T>();
+  }
+}
+
+/**
+ * @brief calls f with the search_policy named by mcts.scorer,
+ * mcts.leaf_picker and mcts.loss_fn. every combination is instantiated
+ * once at compile time, the choice between them is made once at runtime
+ * @param cfg a config holding the names
+ * @param f a generic callable taking a search_policy
+ * @return whatever f returns, which must be the same for every policy
+ */
+template <class F>
+decltype(auto) with_search_policy(util::config& cfg, F&& f) {
+  return scorer::dispatch(cfg.get<std::string>("mcts.scorer"), [&](auto scorer_tag) -> decltype(auto) {
+    return simulator::leaf_picker::dispatch(cfg.get<std::string>("mcts.leaf_picker"), [&](auto picker_tag) -> decltype(auto) {
+      return loss_fn::dispatch(cfg.get<std::string>("mcts.loss_fn"), [&](auto loss_tag) -> decltype(auto) {
+        return f(search_policy<
+          typename decltype(scorer_tag)::type,
+          typename decltype(picker_tag)::type,
+          typename decltype(loss_tag)::type
+        >{});
+      });
+    });
+  });
+}
+
+}
+}
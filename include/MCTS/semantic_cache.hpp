@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+#include "brick.hpp"
+#include "dataset.hpp"
+#include "expression.hpp"
+#include "MCTS/transposition_table.hpp"
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief a hash of what an expression computes on a dataset, i.e. of its
+ * column of predictions. predictions are rounded to a multiple of tolerance
+ * first, so expressions such as x+x and 2*x hash the same although their
+ * floating point results may differ in the last bits. all NaNs hash the
+ * same, as do all infinities of the same sign
+ * @param y_hat the predictions
+ * @param tolerance the resolution predictions are compared at
+ */
+inline std::size_t hash_predictions(const std::vector<double>& y_hat, double tolerance) {
+  std::size_t h = std::hash<std::size_t>{}(y_hat.size());
+  for (double y : y_hat) {
+    double q;
+    if (std::isnan(y)) {
+      q = std::numeric_limits<double>::quiet_NaN();
+    } else if (std::isinf(y)) {
+      q = y;
+    } else {
+      // adding 0 turns -0 into 0
+      q = std::round(y / tolerance) + 0.0;
+    }
+    h = hash_combine(h, std::isnan(q) ? 1 : std::hash<double>{}(q));
+  }
+  return h;
+}
+
+/**
+ * @brief remembers which functions of the dataset have been evaluated, so
+ * rollouts which only rediscover one of them can be recognized
+ *
+ * Syntactically different expressions often compute the same function on
+ * the dataset, like x+x and 2*x, or x/x and 1. Each rollout's expression is
+ * keyed by hash_predictions() of its predictions (see key()), and
+ * insert() tells whether that key is new. The simulator only lets new
+ * functions into the top N and only backpropagates their rewards; an
+ * equivalent rollout still counts as a visit of its path.
+ *
+ * key() only reads the dataset, so it may be called from evaluator
+ * threads, while insert() must be called from the thread owning the tree.
+ */
+class semantic_cache {
+  private:
+    double tolerance_;
+    bool protected_ops_;
+    std::unordered_set<std::size_t> seen_;
+    std::size_t num_equivalent_ = 0;
+  public:
+    semantic_cache(double = 1e-9, bool = false);
+    std::size_t key(const dataset&, brick::AST::AST&) const;
+    std::size_t key(const std::vector<double>&) const;
+    bool insert(std::size_t);
+    double get_tolerance() const;
+    std::size_t size() const;
+    std::size_t get_num_equivalent() const;
+    void clear();
+};
+
+/**
+ * @brief semantic cache constructor
+ * @param tolerance the resolution predictions are compared at
+ * @param protected_ops whether ASTs are evaluated with protected semantics,
+ * like the loss function does
+ */
+inline semantic_cache::semantic_cache(double tolerance, bool protected_ops)
+  : tolerance_(tolerance),
+    protected_ops_(protected_ops)
+{}
+
+/**
+ * @brief evaluates an AST at every point of a dataset and hashes the
+ * predictions
+ * @param ds the dataset
+ * @param ast the (complete) AST
+ */
+inline std::size_t semantic_cache::key(const dataset& ds, brick::AST::AST& ast) const {
+  std::vector<double> y_hat;
+  expression expr(ast, protected_ops_);
+  expr.optimize();
+  expr.eval(ds.x, y_hat);
+  return key(y_hat);
+}
+
+/**
+ * @brief the key of an AST whose predictions are known, e.g. because a
+ * loss function computed them
+ * @param predictions the AST's prediction at each point of the dataset
+ */
+inline std::size_t semantic_cache::key(const std::vector<double>& predictions) const {
+  return hash_predictions(predictions, tolerance_);
+}
+
+/**
+ * @brief records a function
+ * @param key the function's key
+ * @return whether the function is new. if not, it is counted as equivalent
+ * to one seen before
+ */
+inline bool semantic_cache::insert(std::size_t key) {
+  if (seen_.insert(key).second) {
+    return true;
+  }
+  num_equivalent_++;
+  return false;
+}
+
+inline double semantic_cache::get_tolerance() const {
+  return tolerance_;
+}
+
+/**
+ * @brief how many distinct functions have been recorded
+ */
+inline std::size_t semantic_cache::size() const {
+  return seen_.size();
+}
+
+/**
+ * @brief how many recorded candidates computed a function recorded before
+ */
+inline std::size_t semantic_cache::get_num_equivalent() const {
+  return num_equivalent_;
+}
+
+inline void semantic_cache::clear() {
+  seen_.clear();
+  num_equivalent_ = 0;
+}
+
+}
+}
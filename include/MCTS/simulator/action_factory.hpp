@@ -1,5 +1,7 @@
 #pragma once
 
+#include "expression.hpp"
+
 namespace symreg
 {
 namespace MCTS
@@ -81,7 +83,12 @@ namespace simulator
     }
 
     for (auto& elem : functions) {
-      
+      opcode op;
+      if (!function_opcode(elem, op)) {
+        std::cerr << "Error: function [" << elem << "] can't be evaluated, expected one of sin, cos, exp, log or sqrt" << std::endl;
+        throw "InvalidFunctionException";
+      }
+      function_set_.push_back(std::make_unique<brick::AST::function_node>(elem));
     }
 
     for (auto& elem : vars) {
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace symreg
+{
+namespace MCTS
+{
+namespace simulator
+{
+  /**
+   * @brief drops actions at expansion which only lead to expressions
+   * equivalent to ones reachable through other actions. each rule can be
+   * switched on separately:
+   *   - commutative: the operands of + and * are kept in order. the second
+   *     operand's AST node may not sort before the first's, so a+b is
+   *     searched but b+a isn't
+   *   - double_negation: no negate directly below a negate, and no posit
+   *     directly below a posit
+   *   - constant_folding: no operator on two constants whose result is
+   *     itself one of the constants in the action set, such as 3-2 when 1 is
+   *     available
+   *
+   * Every expression pruned by a rule has an equivalent of the same size
+   * which isn't, so no expression is lost from the search space.
+   */
+  class action_pruner {
+    private:
+      bool commutative_;
+      bool double_negation_;
+      bool constant_folding_;
+      std::size_t num_pruned_;
+      bool is_redundant(const brick::AST::node&, const std::vector<search_node*>&,
+          const brick::AST::node&, const std::vector<double>&) const;
+    public:
+      action_pruner(bool = false, bool = false, bool = false);
+      action_pruner(util::config&);
+      bool is_enabled() const;
+      void prune(search_node*, search_node*, std::vector<std::unique_ptr<brick::AST::node>>&);
+      std::size_t get_num_pruned() const;
+  };
+
+  /**
+   * @brief action pruner constructor
+   * @param commutative whether operands of commutative operators are ordered
+   * @param double_negation whether repeated negates and posits are dropped
+   * @param constant_folding whether foldable constant operations are dropped
+   */
+  action_pruner::action_pruner(bool commutative, bool double_negation, bool constant_folding)
+    : commutative_(commutative),
+      double_negation_(double_negation),
+      constant_folding_(constant_folding),
+      num_pruned_(0)
+  {}
+
+  /**
+   * @brief .toml configurable action pruner constructor. reads
+   * pruning.commutative, pruning.double_negation and pruning.constant_folding
+   */
+  action_pruner::action_pruner(util::config& cfg)
+    : action_pruner(cfg.get_or<bool>("pruning.commutative", false),
+        cfg.get_or<bool>("pruning.double_negation", false),
+        cfg.get_or<bool>("pruning.constant_folding", false))
+  {}
+
+  bool action_pruner::is_enabled() const {
+    return commutative_ || double_negation_ || constant_folding_;
+  }
+
+  /**
+   * @brief the AST children a search node already has, i.e. the nodes on the
+   * path from curr up to target which are up-linked to target, in order
+   */
+  std::vector<search_node*> get_ast_children(search_node* curr, search_node* target) {
+    std::vector<search_node*> children;
+    for (search_node* node = curr; node && node != target; node = node->get_parent()) {
+      if (node->get_up_link() == target) {
+        children.push_back(node);
+      }
+    }
+    std::reverse(children.begin(), children.end());
+    return children;
+  }
+
+  /**
+   * @brief the order commutative operands are kept in
+   */
+  std::pair<int, std::string> operand_key(const brick::AST::node& node) {
+    return std::make_pair(node.get_node_type(), node.to_string());
+  }
+
+  /**
+   * @brief applies op to two constants
+   * @param op a binary operator node
+   * @param a the first operand
+   * @param b the second operand
+   * @param result set to the result
+   * @return whether op is an operator whose result is known
+   */
+  bool fold_constants(const brick::AST::node& op, double a, double b, double& result) {
+    if (op.is_addition()) {
+      result = a + b;
+    } else if (op.is_subtraction()) {
+      result = a - b;
+    } else if (op.is_multiplication()) {
+      result = a * b;
+    } else if (op.is_division() && b != 0) {
+      result = a / b;
+    } else if (op.is_exponentiation()) {
+      result = std::pow(a, b);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief whether attaching action as the next child of target only leads to
+   * expressions reachable through other actions
+   * @param target the AST node the action would be attached to
+   * @param siblings the search nodes already attached to target
+   * @param action the action
+   * @param constants the values of the constants in the action set
+   */
+  bool action_pruner::is_redundant(const brick::AST::node& target,
+      const std::vector<search_node*>& siblings, const brick::AST::node& action,
+      const std::vector<double>& constants) const {
+    if (double_negation_ && siblings.empty()) {
+      if ((target.is_negate() && action.is_negate())
+          || (target.is_posit() && action.is_posit())) {
+        return true;
+      }
+    }
+    if (siblings.size() != 1) {
+      return false;
+    }
+    auto& first = *siblings.front()->get_ast_node();
+    bool commutes = target.is_addition() || target.is_multiplication();
+    if (commutative_ && commutes && operand_key(action) < operand_key(first)) {
+      return true;
+    }
+    double folded;
+    if (constant_folding_ && first.is_number() && action.is_number()
+        && fold_constants(target, std::stod(first.to_string()), std::stod(action.to_string()), folded)) {
+      return std::find(constants.begin(), constants.end(), folded) != constants.end();
+    }
+    return false;
+  }
+
+  /**
+   * @brief removes the redundant actions for one up-link target from an
+   * action set. when every action would be removed, none are
+   * @param curr the node being expanded
+   * @param target the node the actions would be up-linked to
+   * @param actions the actions, pruned in place
+   */
+  void action_pruner::prune(search_node* curr, search_node* target,
+      std::vector<std::unique_ptr<brick::AST::node>>& actions) {
+    auto siblings = get_ast_children(curr, target);
+    std::vector<double> constants;
+    for (auto& action : actions) {
+      if (action->is_number()) {
+        constants.push_back(std::stod(action->to_string()));
+      }
+    }
+    auto& target_node = *target->get_ast_node();
+    auto kept = std::stable_partition(actions.begin(), actions.end(), [&](auto& action) {
+      return !is_redundant(target_node, siblings, *action, constants);
+    });
+    if (kept == actions.begin()) {
+      return;
+    }
+    num_pruned_ += actions.end() - kept;
+    actions.erase(kept, actions.end());
+  }
+
+  /**
+   * @brief how many actions have been pruned in total
+   */
+  std::size_t action_pruner::get_num_pruned() const {
+    return num_pruned_;
+  }
+}
+}
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace symreg
+{
+namespace MCTS
+{
+namespace simulator
+{
+  /**
+   * @brief the name an AST node goes by in a .toml config: the names used in
+   * the [actions] table for operators and functions, "var" for variables
+   * and "scalar" for numbers
+   */
+  std::string node_name(const brick::AST::node& node) {
+    if (node.is_addition()) {
+      return "addition";
+    } else if (node.is_subtraction()) {
+      return "subtraction";
+    } else if (node.is_multiplication()) {
+      return "multiplication";
+    } else if (node.is_division()) {
+      return "division";
+    } else if (node.is_exponentiation()) {
+      return "exponentiation";
+    } else if (node.is_posit()) {
+      return "posit";
+    } else if (node.is_negate()) {
+      return "negate";
+    } else if (node.is_id()) {
+      return "var";
+    } else if (node.is_number()) {
+      return "scalar";
+    }
+    return node.to_string();
+  }
+
+  /**
+   * @brief whether an AST has no open slots anywhere
+   */
+  bool is_complete(brick::AST::AST& ast) {
+    if (!ast.is_full()) {
+      return false;
+    }
+    for (auto& child : ast.get_children()) {
+      if (!is_complete(*child)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief whether an AST contains a variable
+   */
+  bool has_variable(brick::AST::AST& ast) {
+    if (ast.get_node()->is_id()) {
+      return true;
+    }
+    for (auto& child : ast.get_children()) {
+      if (has_variable(*child)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief declarative constraints on the shape of searched expressions.
+   * actions which would break a constraint are never attached, neither at
+   * expansion nor during rollouts, so such expressions are never evaluated.
+   *
+   *   - max nesting: the most nodes of an operator on any path from the root
+   *     of an expression down, e.g. one exponentiation rules out (x^x)^x
+   *   - forbidden pairs: operators which may not be a direct child of some
+   *     other operator
+   *   - require variable: every operator's subtree must contain a variable,
+   *     which rules out constant subexpressions such as 5^(4^3) entirely
+   *   - max constant size: the size of the largest subtree without a
+   *     variable, e.g. 3 allows 2^3 but not 2^3^4. the posit at the root of
+   *     an expression isn't counted
+   */
+  class grammar {
+    private:
+      using AST = brick::AST::AST;
+      std::map<std::string, int> max_nesting_;
+      std::set<std::pair<std::string, std::string>> forbidden_;
+      bool require_variable_;
+      int max_constant_size_;
+    public:
+      grammar();
+      grammar(util::config&);
+      void set_max_nesting(const std::string&, int);
+      void forbid(const std::string&, const std::string&);
+      void set_require_variable(bool);
+      void set_max_constant_size(int);
+      bool is_enabled() const;
+      bool admits(const std::vector<AST*>&, const brick::AST::node&) const;
+      void filter(const std::vector<AST*>&, std::vector<std::unique_ptr<brick::AST::node>>&) const;
+  };
+
+  /**
+   * @brief a grammar without constraints
+   */
+  grammar::grammar()
+    : require_variable_(false),
+      max_constant_size_(0)
+  {}
+
+  /**
+   * @brief builds a grammar from the optional [constraints] table of a .toml
+   * config, for example
+   *
+   *   [constraints]
+   *   forbidden = ["exponentiation > exponentiation", "division > division"]
+   *   require_variable = false
+   *   max_constant_size = 3
+   *
+   *   [constraints.max_nesting]
+   *   exponentiation = 1
+   *
+   * a forbidden pair is written as "parent > child"
+   * @param cfg a wrapper around a .toml config
+   */
+  grammar::grammar(util::config& cfg)
+    : require_variable_(cfg.get_or<bool>("constraints.require_variable", false)),
+      max_constant_size_(cfg.get_or<int>("constraints.max_constant_size", 0))
+  {
+    std::vector<std::string> names = {"addition", "subtraction", "multiplication",
+      "division", "exponentiation", "posit", "negate"};
+    for (auto& function : cfg.get_vector<std::string>("actions.functions")) {
+      names.push_back(function);
+    }
+    for (auto& name : names) {
+      int limit = cfg.get_or<int>("constraints.max_nesting." + name, 0);
+      if (limit > 0) {
+        set_max_nesting(name, limit);
+      }
+    }
+    for (auto& pair : cfg.get_vector_or<std::string>("constraints.forbidden", {})) {
+      auto sep = pair.find('>');
+      if (sep == std::string::npos) {
+        std::cerr << "Error: forbidden pair [" << pair << "] isn't of the form \"parent > child\"" << std::endl;
+        throw "InvalidConstraintException";
+      }
+      auto trim = [](std::string s) {
+        s.erase(0, s.find_first_not_of(' '));
+        s.erase(s.find_last_not_of(' ') + 1);
+        return s;
+      };
+      forbid(trim(pair.substr(0, sep)), trim(pair.substr(sep + 1)));
+    }
+  }
+
+  /**
+   * @brief limits how many nodes named name any path from the root may hold
+   */
+  void grammar::set_max_nesting(const std::string& name, int limit) {
+    max_nesting_[name] = limit;
+  }
+
+  /**
+   * @brief forbids nodes named child directly below nodes named parent
+   */
+  void grammar::forbid(const std::string& parent, const std::string& child) {
+    forbidden_.insert(std::make_pair(parent, child));
+  }
+
+  void grammar::set_require_variable(bool require_variable) {
+    require_variable_ = require_variable;
+  }
+
+  /**
+   * @brief limits the size of subtrees without variables. 0 means no limit
+   */
+  void grammar::set_max_constant_size(int size) {
+    max_constant_size_ = size;
+  }
+
+  bool grammar::is_enabled() const {
+    return !max_nesting_.empty() || !forbidden_.empty() || require_variable_ || max_constant_size_ > 0;
+  }
+
+  /**
+   * @brief whether attaching action as the next child of an AST node keeps
+   * the expression within the constraints. only the subtrees the action
+   * completes are checked, since every other subtree was checked when it
+   * was completed
+   * @param ancestors the AST node the action would be attached to, then its
+   * parent and so on up to the root of the expression
+   * @param action the action
+   */
+  bool grammar::admits(const std::vector<AST*>& ancestors, const brick::AST::node& action) const {
+    if (ancestors.empty()) {
+      return true;
+    }
+    auto name = node_name(action);
+    auto limit = max_nesting_.find(name);
+    if (limit != max_nesting_.end()) {
+      int nesting = 1;
+      for (AST* ancestor : ancestors) {
+        nesting += node_name(*ancestor->get_node()) == name;
+      }
+      if (nesting > limit->second) {
+        return false;
+      }
+    }
+    if (forbidden_.count(std::make_pair(node_name(*ancestors.front()->get_node()), name))) {
+      return false;
+    }
+    if (!action.is_terminal() || (!require_variable_ && max_constant_size_ <= 0)) {
+      return true;
+    }
+
+    // walk up the subtrees the terminal completes
+    bool variable = action.is_id();
+    int size = 1;
+    AST* completed = nullptr;
+    for (AST* ancestor : ancestors) {
+      if (ancestor->vacancy() > (completed ? 0 : 1)) {
+        break;
+      }
+      bool complete = true;
+      for (auto& child : ancestor->get_children()) {
+        if (child.get() == completed) {
+          continue;
+        }
+        complete = complete && is_complete(*child);
+        variable = variable || has_variable(*child);
+        size += child->get_size();
+      }
+      if (!complete) {
+        break;
+      }
+      // a posit leaves its operand as it is
+      size += !ancestor->get_node()->is_posit();
+      if (!variable && (require_variable_ || (max_constant_size_ > 0 && size > max_constant_size_))) {
+        return false;
+      }
+      completed = ancestor;
+    }
+    return true;
+  }
+
+  /**
+   * @brief removes every action which admits() rejects
+   * @param ancestors as in admits()
+   * @param actions the actions, filtered in place
+   */
+  void grammar::filter(const std::vector<AST*>& ancestors,
+      std::vector<std::unique_ptr<brick::AST::node>>& actions) const {
+    actions.erase(std::remove_if(actions.begin(), actions.end(), [&](auto& action) {
+      return !admits(ancestors, *action);
+    }), actions.end());
+  }
+}
+}
+}
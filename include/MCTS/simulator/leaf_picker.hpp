@@ -13,18 +13,28 @@ namespace leaf_picker
 
 /**
  * @brief an interface for leaf pickers, which are responsible
- * for finding leaves to expand/rollout during simulation
+ * for finding leaves to expand/rollout during simulation.
+ * solved subtrees (see search_node::is_solved()) are never picked from.
+ * with progressive widening, a node due to get another child
+ * (search_node::is_widening_due()), or with pending moves but no unsolved
+ * children, is picked like a leaf
  */
 class leaf_picker {
   public:
     virtual search_node* pick(search_node*) = 0; 
+    virtual void configure(util::config&);
 }; 
 
+/**
+ * @brief reads the picker's parameters from a .toml config
+ */
+void leaf_picker::configure(util::config&) {}
+
 /**
  * @brief a leaf picker which first builds a vector of all leaves in the
  * tree and then picks at random from the vector
  */
-class random_leaf_picker : public leaf_picker {
+class random_leaf_picker final : public leaf_picker {
   private:
     void build_leaf_vector(search_node*, std::vector<search_node*>&);
   public:
@@ -39,13 +49,19 @@ class random_leaf_picker : public leaf_picker {
  */
 void random_leaf_picker::build_leaf_vector(search_node* node,
     std::vector<search_node*>& leaves) {
-  if (node->is_leaf_node()) {
+  if (node->is_solved()) {
+    return;
+  } else if (node->is_leaf_node()) {
     leaves.push_back(node);
   } else {
+    auto num_leaves = leaves.size();
     auto& children = node->get_children();
     for (auto& child : children) {
       build_leaf_vector(&child, leaves);
     }
+    if (node->is_widening_due() || (node->has_pending() && leaves.size() == num_leaves)) {
+      leaves.push_back(node);
+    }
   }
 }
 
@@ -71,13 +87,14 @@ search_node* random_leaf_picker::pick(search_node* node) {
  * to some scorer.
  */
 template <class Scorer>
-class recursive_heuristic_child_picker : public leaf_picker {
+class recursive_heuristic_child_picker final : public leaf_picker {
   private:
     Scorer scorer_;
     search_node* max_heuristic_node(search_node*);
   public:
-    recursive_heuristic_child_picker(Scorer);
+    recursive_heuristic_child_picker(Scorer = Scorer{});
     search_node* pick(search_node*);
+    void configure(util::config&);
 }; 
 
 /**
@@ -100,7 +117,10 @@ search_node* recursive_heuristic_child_picker<Scorer>::max_heuristic_node(search
   std::vector<search_node*> moves;
   double max = -std::numeric_limits<double>::infinity();
   for (auto& child : node->get_children()) {
-    if (child.get_n() == 0) {
+    if (child.is_solved()) {
+      continue;
+    }
+    if (child.get_n() == 0 && !scorer_.uses_priors()) {
       if (max < std::numeric_limits<double>::infinity()) {
         moves.clear();
       }
@@ -108,7 +128,8 @@ search_node* recursive_heuristic_child_picker<Scorer>::max_heuristic_node(search
       moves.push_back(&child);
       continue;
     }
-    double score = scorer_.score(child.get_q(), child.get_n(), node->get_n(), node->get_avg_child_q());
+    double score = scorer_.score(child.get_q(), child.get_n(), node->get_n(),
+        node->get_avg_child_q(), child.get_p());
     if (score > max) {
       max = score;
       moves.clear();
@@ -117,6 +138,9 @@ search_node* recursive_heuristic_child_picker<Scorer>::max_heuristic_node(search
       moves.push_back(&child);
     } 
   }
+  if (moves.empty()) {
+    return nullptr;
+  }
   auto random = util::get_random_int(0, moves.size() - 1, symreg::mt); 
   return moves[random];
 }
@@ -129,21 +153,29 @@ search_node* recursive_heuristic_child_picker<Scorer>::max_heuristic_node(search
  */
 template <class Scorer>
 search_node* recursive_heuristic_child_picker<Scorer>::pick(search_node* node) {
-  while (!node->is_leaf_node()) {
+  while (!node->is_leaf_node() && !node->is_widening_due()) {
     auto child = max_heuristic_node(node);
     if (child) {
       node = child;
     } else {
-      return nullptr;
+      return node->has_pending() ? node : nullptr;
     }
   }
   return node;
 }
 
+/**
+ * @brief configures the picker's scorer
+ */
+template <class Scorer>
+void recursive_heuristic_child_picker<Scorer>::configure(util::config& cfg) {
+  scorer_.configure(cfg);
+}
+
 /**
  * @brief a leaf picker which at every level of the tree chooses a child randomly
  */
-class recursive_random_child_picker : public leaf_picker {
+class recursive_random_child_picker final : public leaf_picker {
   private:
     search_node* random_child(search_node*);
   public:
@@ -156,14 +188,19 @@ class recursive_random_child_picker : public leaf_picker {
  * @return a pointer to the random child
  */
 search_node* recursive_random_child_picker::random_child(search_node* node) {
-  auto& children = node->get_children();
+  std::vector<search_node*> children;
+  for (auto& child : node->get_children()) {
+    if (!child.is_solved()) {
+      children.push_back(&child);
+    }
+  }
 
   if (children.empty()) {
     return nullptr;
   }
 
   int random = util::get_random_int(0, children.size() - 1, symreg::mt);
-  return &children[random]; 
+  return children[random]; 
 }
 
 /**
@@ -174,12 +211,12 @@ search_node* recursive_random_child_picker::random_child(search_node* node) {
  * @return the randomly selected leaf
  */
 search_node* recursive_random_child_picker::pick(search_node* node) {
-  while (!node->is_leaf_node()) {
+  while (!node->is_leaf_node() && !node->is_widening_due()) {
     auto child = random_child(node);
     if (child) {
       node = child;
     } else {
-      return nullptr;
+      return node->has_pending() ? node : nullptr;
     }
   }
 
@@ -187,29 +224,42 @@ search_node* recursive_random_child_picker::pick(search_node* node) {
 }
 
 /**
- * @brief given a string representation of a leaf_picker,
- * returns the corresponding picker.
+ * @brief calls f with the type_tag of the leaf picker named picker_str
  * @param picker_str a string representation of a leaf picker.
  * for example: "random_leaf"
- * @return a shared pointer to the correct leaf picker instance
+ * @param f a generic callable
+ * @return whatever f returns
  */
-std::shared_ptr<leaf_picker> get(std::string picker_str) {
+template <class F>
+decltype(auto) dispatch(const std::string& picker_str, F&& f) {
   std::string rhcp = "recursive_heuristic_child_picker";
   if (picker_str == "random_leaf") {
-    return std::make_shared<random_leaf_picker>();
+    return f(util::type_tag<random_leaf_picker>{});
   } else if (picker_str == "recursive_random_child") {
-    return std::make_shared<recursive_random_child_picker>();
-  } else if (picker_str.compare(0, rhcp.size(), rhcp) == 0) {
+    return f(util::type_tag<recursive_random_child_picker>{});
+  } else if (picker_str.compare(0, rhcp.size(), rhcp) == 0 && picker_str.size() > rhcp.size() + 1) {
     std::string tmpl = picker_str.substr(rhcp.size() + 1, 
         picker_str.size() - rhcp.size() - 2);  
-    if (tmpl == "UCB1") {
-      return std::make_shared<recursive_heuristic_child_picker<scorer::UCB1>>(scorer::UCB1{});
-    } else {
-      return std::make_shared<recursive_heuristic_child_picker<scorer::UCB1>>(scorer::UCB1{});
-    }
+    return scorer::dispatch(tmpl, [&f](auto scorer_tag) -> decltype(auto) {
+      using scorer_type = typename decltype(scorer_tag)::type;
+      return f(util::type_tag<recursive_heuristic_child_picker<scorer_type>>{});
+    });
   } else {
-    return std::make_shared<recursive_heuristic_child_picker<scorer::UCB1>>(scorer::UCB1{});
+    return f(util::type_tag<recursive_heuristic_child_picker<scorer::UCB1>>{});
   } 
+}
+
+/**
+ * @brief given a string representation of a leaf_picker,
+ * returns the corresponding picker.
+ * @param picker_str a string representation of a leaf picker.
+ * for example: "random_leaf"
+ * @return a shared pointer to the correct leaf picker instance
+ */
+std::shared_ptr<leaf_picker> get(std::string picker_str) {
+  return dispatch(picker_str, [](auto tag) -> std::shared_ptr<leaf_picker> {
+    return std::make_shared<typename decltype(tag)::type>();
+  });
 } 
 
 } // leaf_picker
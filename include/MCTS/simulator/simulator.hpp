@@ -1,18 +1,39 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <queue> 
 #include <random>
+#include <sstream>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
 
+#include "concurrent_priority_queue.hpp"
+#include "constant_fitter.hpp"
+#include "coroutine_scheduler.hpp"
+#include "inference_broker.hpp"
+#include "spsc_queue.hpp"
+#include "thread_pool.hpp"
+#include "MCTS/backup.hpp"
 #include "MCTS/search_node.hpp"
+#include "MCTS/search_policy.hpp"
+#include "MCTS/semantic_cache.hpp"
+#include "MCTS/stop_condition.hpp"
+#include "MCTS/transposition_table.hpp"
+#include "MCTS/widening.hpp"
 #include "MCTS/simulator/action_factory.hpp"
+#include "MCTS/simulator/action_pruner.hpp"
+#include "MCTS/simulator/grammar.hpp"
 #include "MCTS/simulator/leaf_picker.hpp"
 
 namespace symreg
@@ -32,12 +53,14 @@ namespace simulator
    * from the node to the root of the tree, building an actual AST as it goes.
    * 
    * @param bottom the MCTS search node to start building the AST from
+   * @param search_to_ast filled with the AST node built for each search node
+   * on the path
    * @return a shared pointer to the root of the AST which was built
    */
-  std::shared_ptr<AST> build_ast_upward(search_node* bottom) {
+  std::shared_ptr<AST> build_ast_upward(search_node* bottom,
+      std::map<search_node*, std::shared_ptr<AST>>& search_to_ast) {
     search_node* cur = bottom;
     search_node* root = nullptr; 
-    std::map<search_node*, std::shared_ptr<AST>> search_to_ast;
 
     while (cur->get_parent()) {
       search_to_ast[cur] = std::make_shared<AST>
@@ -58,6 +81,60 @@ namespace simulator
     return search_to_ast[root];
   }
 
+  /**
+   * @brief builds an AST starting from a search node to the root of the MCTS
+   * @param bottom the MCTS search node to start building the AST from
+   * @return a shared pointer to the root of the AST which was built
+   */
+  std::shared_ptr<AST> build_ast_upward(search_node* bottom) {
+    std::map<search_node*, std::shared_ptr<AST>> search_to_ast;
+    return build_ast_upward(bottom, search_to_ast);
+  }
+
+  /**
+   * @brief maps every node of an AST below ast to its parent
+   */
+  void map_parents(AST* ast, std::map<AST*, AST*>& parents) {
+    for (auto& child : ast->get_children()) {
+      parents[child.get()] = ast;
+      map_parents(child.get(), parents);
+    }
+  }
+
+  /**
+   * @brief an AST node followed by its parent and so on up to the root, as
+   * taken by grammar::admits()
+   */
+  std::vector<AST*> get_ancestors(AST* ast, const std::map<AST*, AST*>& parents) {
+    std::vector<AST*> ancestors;
+    while (ast) {
+      ancestors.push_back(ast);
+      auto it = parents.find(ast);
+      ast = it == parents.end() ? nullptr : it->second;
+    }
+    return ancestors;
+  }
+
+  /**
+   * @brief attaches an action as a child of curr in the MCTS tree and as a
+   * child of targ in the AST sense
+   * @param curr the node being expanded
+   * @param action the action's AST node
+   * @param targ the node the action is up-linked to
+   * @return the new child
+   */
+  search_node& attach_action(search_node* curr, std::unique_ptr<brick::AST::node>&& action, search_node* targ) {
+    curr->add_child(std::move(action));
+    auto& child = curr->get_children().back();
+    child.set_parent(curr);
+    child.set_up_link(targ);
+    child.set_depth(curr->get_depth() + 1);
+    child.set_unconnected(
+        curr->get_unconnected() - 1 + child.get_ast_node()->num_children()
+    );
+    return child;
+  }
+
   /**
    * @brief finds ancestors of the passed node which don't have enough children
    * in the AST sense. E.g. an addition node should have two children below it.
@@ -153,27 +230,32 @@ namespace simulator
   }
 
   /**
-   * @brief performs a random rollout starting from a search node in the MCTS
+   * @brief randomly completes a partial AST
    *
-   * first, the implicit AST at curr is built. next, we create a queue of 
-   * AST nodes which need to have children added to be "full". while this queue
-   * is not empty, we add random AST nodes to this AST, adding to the queue 
-   * when we append non-terminal AST nodes. once we manage to build a full/valid
-   * AST, we evaluate the AST using the symbol table member of the MCTS class.
-   * Rollouts may not exceed the depth_limit_ 
+   * we create a queue of AST nodes which need to have children added to be
+   * "full". while this queue is not empty, we add random AST nodes to this
+   * AST, adding to the queue when we append non-terminal AST nodes. the
+   * completed AST may not exceed the depth_limit. with a grammar, the random
+   * nodes are drawn from the actions it admits; where it admits none, from
+   * all actions, so that the AST can still be completed. this touches no
+   * search nodes, so it may run on any thread.
    *
    * Design decision: LIFO method of appending random nodes -- does it matter?
    * Design decision: depth limit
    *
-   * @param curr the node to rollout from
-   * @return the value of our randomly rolled out AST
+   * @param ast the partial AST to complete in place
+   * @param g the grammar the completion should keep to, or nullptr
+   * @return the completed AST
    */
-  std::shared_ptr<AST> rollout(search_node* curr, int depth_limit, action_factory& af) {
-    search_node* rollout_base = curr;
-    std::shared_ptr<AST> ast = build_ast_upward(rollout_base);
-
+  std::shared_ptr<AST> complete_ast(std::shared_ptr<AST> ast, int depth_limit,
+      const action_factory& af, const grammar* g = nullptr) {
     std::queue<std::shared_ptr<AST>> targets;
     set_targets_from_ast(ast, targets);
+    bool constrained = g && g->is_enabled();
+    std::map<AST*, AST*> parents;
+    if (constrained) {
+      map_parents(ast.get(), parents);
+    }
 
     auto size = ast->get_size();
     auto num_unconnected = ast->get_num_unconnected();
@@ -184,7 +266,18 @@ namespace simulator
       auto max_child_arity = depth_limit - (size + num_unconnected);
       std::shared_ptr<AST> targ = targets.front();
       // add actions randomly
-      std::shared_ptr<AST> child = targ->add_child(af.get_random(max_child_arity));
+      std::unique_ptr<brick::AST::node> action;
+      if (constrained) {
+        auto actions = af.get_set(max_child_arity);
+        g->filter(get_ancestors(targ.get(), parents), actions);
+        if (!actions.empty()) {
+          action = std::move(actions[util::get_random_int(0, actions.size() - 1, symreg::mt)]);
+        }
+      }
+      std::shared_ptr<AST> child = targ->add_child(action ? std::move(action) : af.get_random(max_child_arity));
+      if (constrained) {
+        parents[child.get()] = targ.get();
+      }
       size++;
       num_unconnected += child->vacancy() - 1;
       if (!child->is_terminal()) {
@@ -197,6 +290,21 @@ namespace simulator
     return ast;
   }
 
+  /**
+   * @brief performs a random rollout starting from a search node in the MCTS
+   *
+   * first, the implicit AST at curr is built. it is then randomly completed
+   * by complete_ast(). Rollouts may not exceed the depth_limit_ 
+   *
+   * @param curr the node to rollout from
+   * @param g the grammar the rollout should keep to, or nullptr
+   * @return the value of our randomly rolled out AST
+   */
+  std::shared_ptr<AST> rollout(search_node* curr, int depth_limit, action_factory& af,
+      const grammar* g = nullptr) {
+    return complete_ast(build_ast_upward(curr), depth_limit, af, g);
+  }
+
   /**
    * @brief the method for propagating visit count and node value
    * up the tree to ancestor nodes
@@ -207,18 +315,62 @@ namespace simulator
    *
    * Design decision: the way this math is done. 
    *
+   * What ends up in q depends on the backup rule. In mean mode q is the
+   * running mean. Otherwise the running mean is kept in mean_q, and q is
+   * the rule's blend of it with the best reward seen below the node.
+   *
    * @param value the value of the rollout to be propagated upward
    * @param curr a pointer to the leaf node which was rolled out
+   * @param rule how q is computed from the node's statistics
    */
-  void backprop(double value, search_node* curr) {
+  void backprop(double value, search_node* curr, const backup_rule& rule = backup_rule{}) {
+    double reward = value;
     while (curr) {
-      curr->set_q((curr->get_q() * curr->get_n() + value) / (curr->get_n() + 1)); 
-      curr->set_n(curr->get_n() + 1);
-      value = curr->get_q();
+      auto n = curr->get_n();
+      curr->set_max_q(std::max(curr->get_max_q(), reward));
+      if (rule.is_mean()) {
+        curr->set_q((curr->get_q() * n + value) / (n + 1)); 
+        value = curr->get_q();
+      } else {
+        curr->set_mean_q((curr->get_mean_q() * n + value) / (n + 1));
+        curr->set_q(rule.combine(curr->get_mean_q(), curr->get_max_q()));
+        value = curr->get_mean_q();
+      }
+      curr->set_n(n + 1);
       curr = curr->get_parent();
     }
   }
 
+  /**
+   * @brief MCTS-Solver style proving. marks node solved with an exact value
+   * and walks up the tree, marking every ancestor whose children are all
+   * solved as solved with the best of their values
+   *
+   * Expansion attaches every move from a node at once, so a node whose
+   * children are all solved has had every AST below it evaluated. with
+   * progressive widening, only once it has no pending moves left.
+   *
+   * @param node a node whose ASTs have all been evaluated. for a node whose
+   * AST is complete, that is the one AST itself
+   * @param value the best reward among them
+   */
+  void mark_solved(search_node* node, double value) {
+    node->set_solved(true, value);
+    for (search_node* parent = node->get_parent(); parent; parent = parent->get_parent()) {
+      if (parent->has_pending()) {
+        return;
+      }
+      double best = -std::numeric_limits<double>::infinity();
+      for (auto& child : parent->get_children()) {
+        if (!child.is_solved()) {
+          return;
+        }
+        best = std::max(best, child.get_solved_value());
+      }
+      parent->set_solved(true, best);
+    }
+  }
+
   /**
    * @brief loop up a path in the MCTS tree, increasing visit count by
    * the passed value and each search node
@@ -233,6 +385,82 @@ namespace simulator
     }
   }
 
+  /**
+   * @brief a virtual loss for a path: the lowest mean reward of a visited
+   * node on the path, within [-1, 0]. rewards being 1 - loss, a penalty of 0
+   * would raise the mean of most nodes and draw selections toward
+   * evaluations in flight.
+   *
+   * The penalty is bounded below because reverting takes it back out of
+   * every mean on the path. After a diverging rollout (a loss of up to
+   * 1e100) that cancellation would wipe out the ordinary rewards of every
+   * node. Nodes whose mean is below -1 are still steered away from by the
+   * extra visit.
+   *
+   * @param curr the leaf whose evaluation is in flight
+   * @param rule the backup rule rewards are backpropagated with
+   */
+  double virtual_loss_penalty(search_node* curr, const backup_rule& rule = backup_rule{}) {
+    double penalty = 0;
+    for (; curr; curr = curr->get_parent()) {
+      if (curr->get_n() > 0) {
+        penalty = std::min(penalty, rule.is_mean() ? curr->get_q() : curr->get_mean_q());
+      }
+    }
+    return std::max(penalty, -1.0);
+  }
+
+  /**
+   * @brief marks a path as having an evaluation in flight
+   *
+   * every node from curr to the root receives a visit with a reward of
+   * penalty (see virtual_loss_penalty()), so that selections made before
+   * the real reward arrives are steered toward other paths. must be undone
+   * with revert_virtual_loss() and the same penalty before the real reward
+   * is backpropagated. outside of mean mode the penalty only lowers the
+   * mean, so with the max rule virtual loss just adds visits.
+   *
+   * @param curr the leaf whose evaluation is in flight
+   * @param penalty the reward of the virtual visit
+   * @param rule the backup rule rewards are backpropagated with
+   */
+  void apply_virtual_loss(search_node* curr, double penalty, const backup_rule& rule = backup_rule{}) {
+    while (curr) {
+      auto n = curr->get_n();
+      if (rule.is_mean()) {
+        curr->set_q((curr->get_q() * n + penalty) / (n + 1));
+      } else {
+        curr->set_mean_q((curr->get_mean_q() * n + penalty) / (n + 1));
+        curr->set_q(rule.combine(curr->get_mean_q(), curr->get_max_q()));
+      }
+      curr->set_n(n + 1);
+      curr = curr->get_parent();
+    }
+  }
+
+  /**
+   * @brief removes the visit added by apply_virtual_loss(), i.e. takes its
+   * penalty back out of the mean. rewards backpropagated through the path
+   * in the meantime are kept
+   *
+   * @param curr the leaf whose evaluation has completed
+   * @param penalty the penalty the virtual loss was applied with
+   * @param rule the backup rule rewards are backpropagated with
+   */
+  void revert_virtual_loss(search_node* curr, double penalty, const backup_rule& rule = backup_rule{}) {
+    while (curr) {
+      auto n = curr->get_n();
+      if (rule.is_mean()) {
+        curr->set_q(n > 1 ? (curr->get_q() * n - penalty) / (n - 1) : 0);
+      } else {
+        curr->set_mean_q(n > 1 ? (curr->get_mean_q() * n - penalty) / (n - 1) : 0);
+        curr->set_q(rule.combine(curr->get_mean_q(), curr->get_max_q()));
+      }
+      curr->set_n(n - 1);
+      curr = curr->get_parent();
+    }
+  }
+
   /**
    * @brief uses secant method to find the number of times the highest
    * scored node must be visited before starting to visit the next
@@ -316,10 +544,11 @@ namespace simulator
    * @brief given a parent node, find the second highest scoring child node
    *
    * @param node the parent node for whose children we are interested in
-   * @param _scorer a shared pointer to a search node scorer 
+   * @param _scorer a search node scorer
    * @return a pointer to the second highest scoring search node
    */
-  search_node* get_second_highest(search_node* node, std::shared_ptr<scorer::scorer>& _scorer) {
+  template <class Scorer>
+  search_node* get_second_highest(search_node* node, Scorer& _scorer) {
     search_node* parent = node->get_parent();
     search_node* second_highest = nullptr;
     double max_score = -std::numeric_limits<double>::max(); 
@@ -327,7 +556,8 @@ namespace simulator
       if (&child == node) {
         continue;
       }
-      auto score = _scorer->score(child.get_q(), child.get_n(), parent->get_n(), parent->get_avg_child_q());
+      auto score = _scorer.score(child.get_q(), child.get_n(), parent->get_n(),
+          parent->get_avg_child_q(), child.get_p());
       if (score > max_score) {
         max_score = score;
         second_highest = &child;
@@ -340,13 +570,14 @@ namespace simulator
    * @brief inflates the visit count of a highest scoring terminal node to avoid wasting simulations
    *
    * @param node the highest scoring terminal node which needs its visit count increased
-   * @param _scorer a shared pointer to a search_node scorer
+   * @param _scorer a search node scorer
    */
-  void inflate_visit_count(search_node* node, std::shared_ptr<scorer::scorer>& _scorer) {
+  template <class Scorer>
+  void inflate_visit_count(search_node* node, Scorer& _scorer) {
     search_node* second_highest = get_second_highest(node, _scorer);
     if (second_highest) {
       auto scorer_lambda = [&] (double child_val, int child_n, int parent_n, double avg_child_q) {
-        return _scorer->score(child_val, child_n, parent_n, avg_child_q);
+        return _scorer.score(child_val, child_n, parent_n, avg_child_q);
       };
 
       auto tipping_point = compute_tipping_point(
@@ -366,10 +597,58 @@ namespace simulator
     return lhs.second > rhs.second;  
   };
 
+  // different expressions of the same reward are kept apart
   static auto priq_elem_sign = [](const priq_elem_type& elem) {
+    return std::make_pair(elem.second, elem.first->to_string());
+  };
+
+  static auto priq_elem_key = [](const priq_elem_type& elem) {
     return elem.second;
   };
 
+  using priq_type = concurrent_priority_queue<priq_elem_type,
+    decltype(priq_cmp), decltype(priq_elem_sign), decltype(priq_elem_key)>;
+
+  /**
+   * @brief timings and occupancy gathered by pipelined simulation.
+   * latencies are totals in nanoseconds across all jobs
+   */
+  struct pipeline_stats {
+    std::size_t num_jobs = 0;
+    std::size_t num_samples = 0;
+    std::size_t occupancy_sum = 0;
+    std::size_t max_occupancy = 0;
+    double select_ns = 0;
+    double eval_ns = 0;
+    double queue_ns = 0;
+    double backprop_ns = 0;
+    double mean_occupancy() const;
+    std::string to_string() const;
+  };
+
+  /**
+   * @brief the average number of jobs in flight whenever the selector looked
+   */
+  double pipeline_stats::mean_occupancy() const {
+    return num_samples ? static_cast<double>(occupancy_sum) / num_samples : 0;
+  }
+
+  /**
+   * @brief a human readable summary of per-job stage latencies
+   */
+  std::string pipeline_stats::to_string() const {
+    std::stringstream ss;
+    double n = num_jobs ? num_jobs : 1;
+    ss << "jobs: " << num_jobs
+      << ", mean occupancy: " << mean_occupancy()
+      << ", max occupancy: " << max_occupancy
+      << ", select us/job: " << select_ns / n / 1000
+      << ", eval us/job: " << eval_ns / n / 1000
+      << ", queued us/job: " << queue_ns / n / 1000
+      << ", backprop us/job: " << backprop_ns / n / 1000;
+    return ss.str();
+  }
+
   // SIMULATOR
 
   /**
@@ -377,29 +656,64 @@ namespace simulator
    * algorithm. that is, leaves are chosen within the search tree and expanded
    * or rolled out from
    */ 
-  template <class Regressor = symreg::DNN>
+  template <class Regressor = symreg::DNN, class Policy = dynamic_policy>
   class simulator {
     private:
-      std::shared_ptr<scorer::scorer> scorer_;
-      std::shared_ptr<loss_fn::loss_fn> loss_fn_;
-      std::shared_ptr<leaf_picker::leaf_picker> leaf_picker_;
+      using scorer_type = typename Policy::scorer_type;
+      using leaf_picker_type = typename Policy::leaf_picker_type;
+      using loss_type = typename Policy::loss_type;
+      std::shared_ptr<scorer_type> scorer_;
+      std::shared_ptr<loss_type> loss_fn_;
+      std::shared_ptr<leaf_picker_type> leaf_picker_;
       action_factory action_factory_;
       dataset& ds_;
       int depth_limit_;
       double early_term_thresh_;
       std::shared_ptr<AST> ast_within_thresh_;
-      fixed_priority_queue<priq_elem_type, 
-        decltype(priq_cmp), decltype(priq_elem_sign)> priq_; 
+      priq_type priq_; 
       Regressor* regr_;
+      std::shared_ptr<inference_broker<Regressor>> broker_;
       std::size_t num_explored_;
+      std::size_t num_evaluations_;
+      int pipeline_evaluators_;
+      std::size_t pipeline_depth_;
+      pipeline_stats pipeline_stats_;
+      int coroutine_simulations_;
+      std::shared_ptr<thread_pool> pool_;
+      stop_condition stop_;
+      std::size_t explore_limit_;
+      std::size_t evaluation_limit_;
+      backup_rule backup_;
+      std::shared_ptr<transposition_table> transpositions_;
+      action_pruner pruner_;
+      std::shared_ptr<semantic_cache> semantics_;
+      grammar grammar_;
+      widening_rule widening_;
+      std::shared_ptr<constant_fitter> fitter_;
+      double virtual_loss_ = std::numeric_limits<double>::quiet_NaN();
+      search_node* select(search_node*);
+      double get_virtual_loss(search_node*);
+      search_node* widen(search_node*);
+      std::vector<double> get_priors(search_node*, const std::vector<std::size_t>&);
+      double evaluate(std::shared_ptr<AST>&, std::size_t* = nullptr, std::size_t* = nullptr);
+      void record_rollout(search_node*, std::shared_ptr<AST>, double, std::size_t);
+      void set_priors(search_node*);
+      void pull_path(search_node*);
+      void push_path(search_node*);
+      void simulate_batched(search_node*, int);
+      void simulate_pipelined(search_node*, int);
+#ifdef SYMREG_HAS_COROUTINES
+      sim_task simulation_step(search_node*, serial_scheduler&);
+      void simulate_coroutines(search_node*, int);
+#endif
     public:
       // for convenience
       simulator(dataset&);
       // for testing
       simulator(
-        std::shared_ptr<scorer::scorer>,
-        std::shared_ptr<loss_fn::loss_fn>, 
-        std::shared_ptr<leaf_picker::leaf_picker>,
+        std::shared_ptr<scorer_type>,
+        std::shared_ptr<loss_type>, 
+        std::shared_ptr<leaf_picker_type>,
         action_factory,
         dataset&,
         int = 10,
@@ -410,13 +724,44 @@ namespace simulator
       simulator(util::config&, dataset&, Regressor*);
       void simulate(search_node*, int num_sim); 
       bool add_actions(search_node* curr); 
+      void attach_pending(search_node*);
       bool got_reward_within_thresh();
       std::shared_ptr<AST> get_ast_within_thresh();
+      void set_inference_broker(std::shared_ptr<inference_broker<Regressor>>);
+      std::shared_ptr<inference_broker<Regressor>> get_inference_broker();
+      void set_pipeline(int, std::size_t);
+      const pipeline_stats& get_pipeline_stats() const;
+      void set_coroutines(int, std::shared_ptr<thread_pool> = nullptr);
+      void set_stop_condition(stop_condition);
+      void set_explore_limit(std::size_t);
+      void set_evaluation_limit(std::size_t);
+      void set_backup_rule(backup_rule);
+      const backup_rule& get_backup_rule() const;
+      void set_virtual_loss(double);
+      void set_transposition_table(std::shared_ptr<transposition_table>);
+      std::shared_ptr<transposition_table> get_transposition_table();
+      void set_action_pruner(action_pruner);
+      const action_pruner& get_action_pruner() const;
+      void set_semantic_cache(std::shared_ptr<semantic_cache>);
+      std::shared_ptr<semantic_cache> get_semantic_cache();
+      std::size_t get_num_equivalent() const;
+      void set_grammar(grammar);
+      const grammar& get_grammar() const;
+      void set_widening_rule(widening_rule);
+      const widening_rule& get_widening_rule() const;
+      void set_constant_fitter(std::shared_ptr<constant_fitter>);
+      std::shared_ptr<constant_fitter> get_constant_fitter();
+      bool should_stop() const;
       void reset();
       std::vector<std::shared_ptr<AST>> dump_pri_q();
+      std::vector<priq_elem_type> dump_scored_pri_q();
+      void raise_admission_threshold(double);
       std::size_t get_num_explored() const;
+      std::size_t get_num_evaluations() const;
       void push_priq(std::shared_ptr<AST> ast); 
-      double get_reward(std::shared_ptr<AST> ast);
+      std::shared_ptr<AST> complete(std::shared_ptr<AST>);
+      double get_reward(std::shared_ptr<AST> ast, std::size_t* key = nullptr);
+      int get_depth_limit() const;
   };
 
   /**
@@ -424,20 +769,28 @@ namespace simulator
    *
    * @param ds a reference to a datset
    */
-  template <class Regressor>
-  simulator<Regressor>::simulator(dataset& ds)
-    : scorer_(std::make_shared<scorer::UCB1>()),
-      loss_fn_(std::make_shared<loss_fn::MAPE>()),
-      leaf_picker_(std::make_shared
-          <leaf_picker::recursive_heuristic_child_picker<scorer::UCB1>>(scorer::UCB1{})),
+  template <class Regressor, class Policy>
+  simulator<Regressor, Policy>::simulator(dataset& ds)
+    : scorer_(make_policy_component<scorer_type>("UCB1", scorer::get)),
+      loss_fn_(make_policy_component<loss_type>("MAPE", loss_fn::get)),
+      leaf_picker_(make_policy_component<leaf_picker_type>(
+          "recursive_heuristic_child_picker<UCB1>", leaf_picker::get)),
       action_factory_(action_factory{}), 
       ds_(ds),
       depth_limit_(8),
       early_term_thresh_(.999),
       ast_within_thresh_(nullptr),
-      priq_(priq_cmp, priq_elem_sign, 10),
+      priq_(priq_cmp, priq_elem_sign, priq_elem_key, 10),
       regr_(nullptr),
-      num_explored_(0)
+      broker_(nullptr),
+      num_explored_(0),
+      num_evaluations_(0),
+      pipeline_evaluators_(0),
+      pipeline_depth_(0),
+      coroutine_simulations_(0),
+      pool_(nullptr),
+      explore_limit_(std::numeric_limits<std::size_t>::max()),
+      evaluation_limit_(std::numeric_limits<std::size_t>::max())
   {}
       
   /**
@@ -459,11 +812,11 @@ namespace simulator
    * @param regr a pointer (or nullptr) to a supervised learner capable of inferring
    * a search nodes value and policy
    */
-  template <class Regressor>
-  simulator<Regressor>::simulator(
-    std::shared_ptr<scorer::scorer> _scorer,
-    std::shared_ptr<loss_fn::loss_fn> _loss_fn, 
-    std::shared_ptr<leaf_picker::leaf_picker> _leaf_picker, 
+  template <class Regressor, class Policy>
+  simulator<Regressor, Policy>::simulator(
+    std::shared_ptr<scorer_type> _scorer,
+    std::shared_ptr<loss_type> _loss_fn, 
+    std::shared_ptr<leaf_picker_type> _leaf_picker, 
     action_factory _action_factory,
     dataset& ds,
     int depth_limit,
@@ -478,9 +831,17 @@ namespace simulator
       depth_limit_(depth_limit),
       early_term_thresh_(early_term_thresh),
       ast_within_thresh_(nullptr),
-      priq_(priq_cmp, priq_elem_sign, 10),
+      priq_(priq_cmp, priq_elem_sign, priq_elem_key, 10),
       regr_(regr),
-      num_explored_(0)
+      broker_(nullptr),
+      num_explored_(0),
+      num_evaluations_(0),
+      pipeline_evaluators_(0),
+      pipeline_depth_(0),
+      coroutine_simulations_(0),
+      pool_(nullptr),
+      explore_limit_(std::numeric_limits<std::size_t>::max()),
+      evaluation_limit_(std::numeric_limits<std::size_t>::max())
   {}
 
   /**
@@ -494,20 +855,60 @@ namespace simulator
    * @param regr a pointer (or nullptr) to a supervised learner capable of inferring
    * a search node's value and policy
    */
-  template <class Regressor>
-  simulator<Regressor>::simulator(util::config& cfg, dataset& ds, Regressor* regr)
-    : scorer_(scorer::get(cfg.get<std::string>("mcts.scorer"))),
-      loss_fn_(loss_fn::get(cfg.get<std::string>("mcts.loss_fn"))),
-      leaf_picker_(leaf_picker::get(cfg.get<std::string>("mcts.leaf_picker"))),
+  template <class Regressor, class Policy>
+  simulator<Regressor, Policy>::simulator(util::config& cfg, dataset& ds, Regressor* regr)
+    : scorer_(make_policy_component<scorer_type>(cfg.get<std::string>("mcts.scorer"), scorer::get)),
+      loss_fn_(make_policy_component<loss_type>(cfg.get<std::string>("mcts.loss_fn"), loss_fn::get)),
+      leaf_picker_(make_policy_component<leaf_picker_type>(
+          cfg.get<std::string>("mcts.leaf_picker"), leaf_picker::get)),
       action_factory_(action_factory(cfg)),
       ds_(ds),
       depth_limit_(cfg.get<int>("mcts.depth_limit")),
       early_term_thresh_(cfg.get<double>("mcts.early_term_thresh")),
       ast_within_thresh_(nullptr),
-      priq_(priq_cmp, priq_elem_sign, cfg.get<int>("mcts.top_N")),
+      priq_(priq_cmp, priq_elem_sign, priq_elem_key, cfg.get<int>("mcts.top_N")),
       regr_(regr),
-      num_explored_(0)
-  {}
+      broker_(nullptr),
+      num_explored_(0),
+      num_evaluations_(0),
+      pipeline_evaluators_(cfg.get_or<int>("mcts.pipeline_evaluators", 0)),
+      pipeline_depth_(cfg.get_or<int>("mcts.pipeline_depth", 4 * pipeline_evaluators_)),
+      coroutine_simulations_(0),
+      pool_(nullptr),
+      explore_limit_(std::numeric_limits<std::size_t>::max()),
+      evaluation_limit_(std::numeric_limits<std::size_t>::max()),
+      backup_(backup_rule::from_config(cfg)),
+      pruner_(cfg),
+      grammar_(cfg),
+      widening_(widening_rule::from_config(cfg))
+  {
+    int batch_size = cfg.get_or<int>("mcts.inference_batch_size", 1);
+    if (regr_ && batch_size > 1) {
+      broker_ = std::make_shared<inference_broker<Regressor>>(regr_, batch_size,
+        std::chrono::microseconds(cfg.get_or<int>("mcts.inference_timeout_us", 1000)));
+    }
+    if (cfg.get_or<bool>("mcts.transpositions", false)) {
+      transpositions_ = std::make_shared<transposition_table>();
+    }
+    if (cfg.get_or<bool>("mcts.semantic_dedup", false)) {
+      semantics_ = std::make_shared<semantic_cache>(cfg.get_or<double>("mcts.semantic_tolerance", 1e-9),
+        cfg.get_or<bool>("mcts.protected_ops", false));
+    }
+    if (cfg.get_or<bool>("mcts.fit_constants", false)) {
+      fitter_ = std::make_shared<constant_fitter>(constant_fitter::from_config(cfg));
+    }
+    scorer_->configure(cfg);
+    leaf_picker_->configure(cfg);
+    loss_fn_->set_chunked_eval(cfg.get_or<int>("mcts.parallel_eval_threshold", 1 << 17),
+      cfg.get_or<int>("mcts.parallel_eval_chunk_size", 1 << 14));
+    loss_fn_->set_protected_ops(cfg.get_or<bool>("mcts.protected_ops", false));
+    virtual_loss_ = cfg.get_or<double>("mcts.virtual_loss", std::numeric_limits<double>::quiet_NaN());
+    int coroutine_simulations = cfg.get_or<int>("mcts.coroutine_simulations", 0);
+    if (coroutine_simulations > 0) {
+      set_coroutines(coroutine_simulations, std::make_shared<thread_pool>(
+        cfg.get_or<int>("mcts.coroutine_threads", 0)));
+    }
+  }
 
   /**
    * @brief Expansion, i.e., given a search node, attaches children nodes for all possible moves
@@ -517,13 +918,25 @@ namespace simulator
    * available slots for children to be attached. for each of the nodes found,
    * all possible actions are attached to curr and up-linked to the the node. curr may only
    * be expanded while there are still possible moves to be made. actions are only added when
-   * their addition doesnt lead to ASTs of greater depth than depth_limit_
+   * their addition doesnt lead to ASTs of greater depth than depth_limit_.
+   * actions the grammar doesn't admit are never attached, and
+   * actions which only lead to expressions equivalent to those of other
+   * actions are dropped by the action pruner, if any of its rules are on.
+   * the new children are given priors by set_priors(). with a transposition
+   * table, each new child is keyed by its AST and starts out with whatever
+   * the table knows about it.
+   *
+   * With progressive widening, the actions are instead kept pending on curr,
+   * ordered by their priors, and only as many are attached as widening_
+   * allows for curr's visit count. the rest are attached by widen() as
+   * curr's visit count grows
    *
    * @param curr the node to be expanded
-   * @return a boolean denoting whether or not the node was expanded
+   * @return a boolean denoting whether or not the node was expanded. a node
+   * the grammar admits no actions for isn't
    */
-  template <class Regressor>
-  bool simulator<Regressor>::add_actions(search_node* curr) {
+  template <class Regressor, class Policy>
+  bool simulator<Regressor, Policy>::add_actions(search_node* curr) {
     // find nodes above in the MCTS tree which need children in the AST sense
 
     std::vector<search_node*> targets = get_up_link_targets(curr);
@@ -539,75 +952,376 @@ namespace simulator
     if (parent_depth >= depth_limit_) {
       return false;
     }
+    std::map<search_node*, std::shared_ptr<AST>> search_to_ast;
+    std::map<AST*, AST*> parents;
+    if (grammar_.is_enabled()) {
+      map_parents(build_ast_upward(curr, search_to_ast).get(), parents);
+    }
     for (search_node* targ : targets) {
       // we're moving these nodes so have to get a new action set each iteration
       std::vector<std::unique_ptr<brick::AST::node>> 
         actions = action_factory_.get_set(max_child_arity);
-      
+      if (grammar_.is_enabled()) {
+        grammar_.filter(get_ancestors(search_to_ast[targ].get(), parents), actions);
+      }
+      if (pruner_.is_enabled()) {
+        pruner_.prune(curr, targ, actions);
+      }
+
       for (auto it = actions.begin(); it != actions.end();) {
-        curr->add_child(std::move(*it));
-        auto& child = curr->get_children().back();
-        child.set_parent(curr);
-        child.set_up_link(targ);
-        child.set_depth(curr->get_depth() + 1);
-        child.set_unconnected(
-            curr->get_unconnected() - 1 + child.get_ast_node()->num_children()
-        );
+        if (widening_.is_enabled()) {
+          curr->get_pending().push_back(search_node::pending_child{std::move(*it), targ, 1});
+        } else {
+          attach_action(curr, std::move(*it), targ);
+        }
         
         // we must erase these from the vector after they are moved otherwise
         // the memory gets freed when the vector goes out of scope
         it = actions.erase(it);
       }
     }
+    if (widening_.is_enabled()) {
+      auto& pending = curr->get_pending();
+      if (pending.empty()) {
+        return false;
+      }
+      std::vector<std::size_t> types;
+      for (auto& move : pending) {
+        types.push_back(move.ast_node->get_node_type());
+      }
+      auto priors = get_priors(curr, types);
+      for (std::size_t i = 0; i < pending.size(); i++) {
+        pending[i].p = priors[i];
+      }
+      // the best prior goes to the back, to be attached first. ties go to
+      // the earlier action, so that the workers of a distributed search,
+      // whose random generators differ, attach the same children in the
+      // same order
+      std::reverse(pending.begin(), pending.end());
+      std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) {
+        return a.p < b.p;
+      });
+      // children are never moved once attached, since nodes further down
+      // point to them
+      curr->get_children().reserve(pending.size());
+      while (curr->has_pending() && curr->get_children().size() < widening_.allowed(curr->get_n())) {
+        widen(curr);
+      }
+      return true;
+    }
+    if (curr->get_children().empty()) {
+      return false;
+    }
+    if (transpositions_) {
+      for (auto& child : curr->get_children()) {
+        child.set_state_key(hash_ast(*build_ast_upward(&child)));
+        transpositions_->pull(child);
+      }
+    }
+    set_priors(curr);
     return true;
   }
 
+  /**
+   * @brief attaches the best of a node's pending moves as a child, see
+   * progressive widening in add_actions()
+   * @param node a node with pending moves
+   * @return the new child
+   */
+  template <class Regressor, class Policy>
+  search_node* simulator<Regressor, Policy>::widen(search_node* node) {
+    auto move = std::move(node->get_pending().back());
+    node->get_pending().pop_back();
+    auto& child = attach_action(node, std::move(move.ast_node), move.up_link);
+    child.set_p(move.p);
+    if (transpositions_) {
+      child.set_state_key(hash_ast(*build_ast_upward(&child)));
+      transpositions_->pull(child);
+    }
+    node->set_widen_at(widening_.next_due(node->get_children().size()));
+    return &child;
+  }
+
+  /**
+   * @brief attaches all of a node's pending moves as children, however
+   * few visits it has. searches which must agree on a node's children,
+   * like the workers of a distributed search, call this on it
+   * @param node the node, which may have no pending moves
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::attach_pending(search_node* node) {
+    while (node->has_pending()) {
+      widen(node);
+    }
+  }
+
+  /**
+   * @brief brings every keyed node from leaf to the root up to date with
+   * the transposition table
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::pull_path(search_node* leaf) {
+    for (search_node* node = leaf; node; node = node->get_parent()) {
+      transpositions_->pull(*node);
+    }
+  }
+
+  /**
+   * @brief records the statistics of every keyed node from leaf to the root
+   * in the transposition table
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::push_path(search_node* leaf) {
+    for (search_node* node = leaf; node; node = node->get_parent()) {
+      transpositions_->push(*node);
+    }
+  }
+
+  /**
+   * @brief the reward of a rollout's complete AST. with a constant fitter,
+   * an AST the top N would admit gets its numbers fit to the dataset, and
+   * if that raises its reward, ast is replaced by the fitted AST. may be
+   * called from evaluator threads
+   * @param ast the AST, replaced when fitting helps
+   * @param key if not nullptr, receives the semantic key of the AST returned
+   * in ast, see get_reward()
+   * @param fit_passes if not nullptr, receives how many more times the
+   * dataset was evaluated to fit the AST's numbers and score the fitted
+   * AST, for get_num_evaluations()
+   * @return the AST's reward
+   */
+  template <class Regressor, class Policy>
+  double simulator<Regressor, Policy>::evaluate(std::shared_ptr<AST>& ast, std::size_t* key,
+      std::size_t* fit_passes) {
+    if (fit_passes) {
+      *fit_passes = 0;
+    }
+    double value = get_reward(ast, key);
+    if (!fitter_ || !priq_.admits(std::make_pair(ast, value))) {
+      return value;
+    }
+    std::size_t num_passes = 0;
+    auto fitted = fitter_->fit(*ast, ds_, &num_passes);
+    if (fit_passes) {
+      *fit_passes = fitted ? num_passes + 1 : num_passes;
+    }
+    if (!fitted) {
+      return value;
+    }
+    std::size_t fitted_key = 0;
+    double fitted_value = get_reward(fitted, key ? &fitted_key : nullptr);
+    if (fitted_value > value) {
+      ast = fitted;
+      value = fitted_value;
+      if (key) {
+        *key = fitted_key;
+      }
+    }
+    return value;
+  }
+
+  /**
+   * @brief pushes a rollout's AST to the top N and backpropagates its
+   * reward from leaf. when the semantic cache has seen the function the AST
+   * computes before, the rollout only adds a visit to the path: its reward
+   * has already been backed up through some path and its function is
+   * already in the top N, or wasn't good enough to be
+   * @param leaf the leaf the rollout started from
+   * @param ast the rollout's complete AST
+   * @param value the AST's reward
+   * @param key the AST's semantic key, see get_reward()
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::record_rollout(search_node* leaf, std::shared_ptr<AST> ast,
+      double value, std::size_t key) {
+    if (semantics_ && !semantics_->insert(key)) {
+      increase_visit_upward(1, leaf);
+      return;
+    }
+    priq_.push(std::make_pair(ast, value));
+    backprop(value, leaf, backup_);
+  }
+
+  /**
+   * @brief gives every child of a freshly expanded node its prior
+   *
+   * With a regressor and a scorer which uses priors, one inference on the
+   * node's state yields a policy over AST node types, and each child gets the policy entry of its type,
+   * normalized over the children. Without one, or when the policy gives the
+   * children no weight at all, the priors are uniform.
+   *
+   * @param node the expanded node
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_priors(search_node* node) {
+    auto& children = node->get_children();
+    std::vector<std::size_t> types;
+    for (auto& child : children) {
+      types.push_back(child.get_ast_node()->get_node_type());
+    }
+    auto priors = get_priors(node, types);
+    for (std::size_t i = 0; i < children.size(); i++) {
+      children[i].set_p(priors[i]);
+    }
+  }
+
+  /**
+   * @brief the priors of moves from a node, see set_priors()
+   * @param node the node the moves are made from
+   * @param types the AST node type of each move
+   * @return the prior of each move, summing to 1
+   */
+  template <class Regressor, class Policy>
+  std::vector<double> simulator<Regressor, Policy>::get_priors(search_node* node,
+      const std::vector<std::size_t>& types) {
+    std::vector<double> weights(types.size(), 0);
+    double total = 0;
+    if (regr_ && scorer_->uses_priors()) {
+      auto state = build_ast_upward(node)->to_string();
+      std::vector<double> policy;
+      if (broker_) {
+        auto future = broker_->submit(state);
+        broker_->flush();
+        policy = future.get().second;
+      } else {
+        policy = regr_->inference(state).second;
+      }
+      for (std::size_t i = 0; i < types.size(); i++) {
+        weights[i] = types[i] < policy.size() ? std::max(0.0, policy[types[i]]) : 0;
+        total += weights[i];
+      }
+    }
+    for (auto& weight : weights) {
+      weight = total > 0 ? weight / total : 1.0 / types.size();
+    }
+    return weights;
+  }
+
+
+  /**
+   * @brief selection and expansion, i.e. finds the node a simulation should
+   * evaluate
+   *
+   * A leaf node in the MCTS tree is chosen based on some heuristics. If the
+   * leaf has already been rolled out from, it is expanded and a random child
+   * of it is chosen instead. leaf pickers also stop at nodes due to be
+   * widened (see add_actions()), in which case the node's next pending move
+   * is attached and chosen.
+   *
+   * @param curr the node to start the leaf search from
+   * @return the node to evaluate, or nullptr if this simulation should be
+   * skipped, which is always the case once curr is solved
+   */
+  template <class Regressor, class Policy>
+  search_node* simulator<Regressor, Policy>::select(search_node* curr) {
+    search_node* leaf = leaf_picker_->pick(curr);
+    if (!leaf || leaf->is_solved()) {
+      return nullptr;
+    }
+    if (leaf->has_pending() && !leaf->is_leaf_node()) {
+      return widen(leaf);
+    }
+
+    if (leaf->is_visited()) {
+      if (leaf->is_dead_end()) {
+        inflate_visit_count(leaf, *scorer_);
+        return nullptr;
+      } else if (add_actions(leaf)) {
+        auto& children = leaf->get_children();
+        auto random = util::get_random_int(0, children.size() - 1, symreg::mt);
+        leaf = &(children[random]);
+      } else {
+        leaf->set_dead_end();
+      } 
+    }
+    return leaf;
+  }
+
   /**
    * @brief The simulation step involving node expansion and rollouts
    * 
    * This function iteratively does the following:
-   *  1) A leaf node in the MCTS tree is chosen based on some heuristics
-   *  2) If the leaf node has already been rolled out from, the leaf node
-   *     is expanded and we set the leaf node pointer to the first child 
-   *     added in the expansion
-   *  3) A random rollout is performed from the leaf node
-   *  4) The value of the rollout is backpropagated up the tree.
+   *  1) A leaf node in the MCTS tree is chosen and possibly expanded by select()
+   *  2) A random rollout is performed from the leaf node, or, when a regressor
+   *     is present, the regressor infers the leaf's value
+   *  3) The value of the rollout is backpropagated up the tree.
+   *
+   * When an inference broker is set, regressor evaluations are instead
+   * handled in waves by simulate_batched(). When pipelining is enabled,
+   * rollouts are handled by simulate_pipelined(). When coroutine simulation
+   * is enabled (and compiled in), both are handled by simulate_coroutines().
+   *
+   * A rollout from a leaf whose AST is already complete evaluates exactly
+   * that AST, so the leaf is marked solved (see mark_solved()). Leaf pickers
+   * skip solved subtrees, and simulation ends early once curr itself is
+   * solved. Regressor values aren't exact, so they never solve a node.
+   *
+   * With a transposition table, the sequential loop pulls the statistics
+   * of the path's states from the table before backpropagating and pushes
+   * them back afterwards, so equivalent nodes share them.
+   *
+   * With a semantic cache, every mode recognizes rollouts which compute a
+   * function an earlier rollout computed. they are counted, kept out of the
+   * top N and only add a visit to their path (see record_rollout()).
+   *
+   * Every mode polls the stop condition before selecting a leaf and stops
+   * selecting once it is met. Evaluations already in flight are finished
+   * and backpropagated, so the tree and the top N stay consistent.
    * 
-   * Design decision: in step 2, the first child is always chosen
+   * Design decision: in step 1, a random child of an expanded node is chosen
    */
-  template <class Regressor>
-  void simulator<Regressor>::simulate(search_node* curr, int num_sim) {
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::simulate(search_node* curr, int num_sim) {
     std::cout << "simulate..." << std::endl;
-    for (int i = 0; i < num_sim; i++) {
-      search_node* leaf = leaf_picker_->pick(curr);
+#ifdef SYMREG_HAS_COROUTINES
+    if (coroutine_simulations_ > 0) {
+      simulate_coroutines(curr, num_sim);
+      return;
+    }
+#endif
+    if (regr_ && broker_) {
+      simulate_batched(curr, num_sim);
+      return;
+    }
+    if (!regr_ && pipeline_evaluators_ > 0) {
+      simulate_pipelined(curr, num_sim);
+      return;
+    }
+    for (int i = 0; i < num_sim && !should_stop() && !curr->is_solved(); i++) {
+      search_node* leaf = select(curr);
       if (!leaf) {
         continue;
       }
 
-      if (leaf->is_visited()) {
-        if (leaf->is_dead_end()) {
-          inflate_visit_count(leaf, scorer_);
+      if (transpositions_) {
+        pull_path(leaf);
+        // an equivalent node may have been solved in the meantime
+        if (leaf->is_solved()) {
           continue;
-        } else if (add_actions(leaf)) {
-          auto& children = leaf->get_children();
-          auto random = util::get_random_int(0, children.size() - 1, symreg::mt);
-          leaf = &(children[random]);
-        } else {
-          leaf->set_dead_end();
-        } 
+        }
       }
-
       num_explored_++;
-      double value;
+      num_evaluations_++;
 
       if (regr_) {
-        value = regr_->inference("state goes here").first; 
-        backprop(value, leaf);
+        double value = regr_->inference(build_ast_upward(leaf)->to_string()).first; 
+        backprop(value, leaf, backup_);
+        if (transpositions_) {
+          push_path(leaf);
+        }
       } else {
-        auto rollout_ast = rollout(leaf, depth_limit_, action_factory_);
-        value = get_reward(rollout_ast);
-        priq_.push(std::make_pair(rollout_ast, value));
-        backprop(value, leaf);
+        auto rollout_ast = rollout(leaf, depth_limit_, action_factory_, &grammar_);
+        std::size_t key = 0;
+        std::size_t fit_passes = 0;
+        double value = evaluate(rollout_ast, &key, &fit_passes);
+        num_evaluations_ += fit_passes;
+        record_rollout(leaf, rollout_ast, value, key);
+        if (leaf->get_unconnected() == 0) {
+          mark_solved(leaf, value);
+        }
+        if (transpositions_) {
+          push_path(leaf);
+        }
         if (value > early_term_thresh_) {
           std::cout << "umm.." << std::endl;
           ast_within_thresh_ = rollout_ast;
@@ -617,13 +1331,375 @@ namespace simulator
     }
   }
 
+  /**
+   * @brief regressor driven simulation which overlaps many leaf evaluations
+   *
+   * Leaves are selected in waves of up to the broker's batch size. Each
+   * selected leaf receives a virtual loss along its path so the next
+   * selection in the wave is steered elsewhere, and its state is submitted
+   * to the broker. Once the wave is selected, the broker is flushed, the
+   * virtual losses are reverted and the inferred values are backpropagated
+   * in selection order. The broker may be shared with other simulators, in
+   * which case their requests are batched together.
+   *
+   * @param curr the node to start leaf searches from
+   * @param num_sim the number of simulations to run
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::simulate_batched(search_node* curr, int num_sim) {
+    using result_type = typename inference_broker<Regressor>::result_type;
+    std::size_t wave_size = broker_->get_batch_size();
+    int i = 0;
+    while (i < num_sim && !should_stop() && !curr->is_solved()) {
+      struct in_flight {
+        search_node* leaf;
+        double penalty;
+        std::future<result_type> result;
+      };
+      std::vector<in_flight> wave;
+      for (; i < num_sim && wave.size() < wave_size && !should_stop(); i++) {
+        search_node* leaf = select(curr);
+        if (!leaf) {
+          continue;
+        }
+        num_explored_++;
+        num_evaluations_++;
+        double penalty = get_virtual_loss(leaf);
+        apply_virtual_loss(leaf, penalty, backup_);
+        wave.push_back({leaf, penalty, broker_->submit(build_ast_upward(leaf)->to_string())});
+      }
+      broker_->flush();
+      for (auto& pending : wave) {
+        double value = pending.result.get().first;
+        revert_virtual_loss(pending.leaf, pending.penalty, backup_);
+        backprop(value, pending.leaf, backup_);
+      }
+    }
+  }
+
+  /**
+   * @brief rollout simulation split into concurrently running stages
+   *
+   * The calling thread is the selector: it selects and expands leaves,
+   * applies a virtual loss to their paths, builds their partial ASTs and
+   * hands them round robin to pipeline_evaluators_ evaluator threads through
+   * single-producer/single-consumer rings. Evaluators complete the rollouts
+   * and score them against the dataset, then hand the results back through
+   * a ring of their own. The calling thread is also the backprop stage: it
+   * applies results strictly in the order their leaves were selected, since
+   * only one thread may touch the tree. At most pipeline_depth_ jobs are in
+   * flight at once, so tree work and evaluation overlap.
+   *
+   * An exception thrown while evaluating a job travels back with it. No new
+   * jobs are issued after one fails, the pipeline is drained and the
+   * evaluators joined, and the first exception is rethrown on the calling
+   * thread. The same holds for exceptions thrown by the selector.
+   *
+   * @param curr the node to start leaf searches from
+   * @param num_sim the number of simulations to run
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::simulate_pipelined(search_node* curr, int num_sim) {
+    using clock = std::chrono::steady_clock;
+    struct job {
+      std::size_t seq = 0;
+      search_node* leaf = nullptr;
+      double penalty = 0;
+      std::shared_ptr<AST> ast;
+      double value = 0;
+      std::size_t key = 0;
+      std::size_t fit_passes = 0;
+      clock::time_point issued;
+      double eval_ns = 0;
+      std::exception_ptr error = nullptr;
+    };
+    auto elapsed_ns = [](clock::time_point since) {
+      return std::chrono::duration<double, std::nano>(clock::now() - since).count();
+    };
+
+    std::size_t depth = std::max<std::size_t>(pipeline_depth_, pipeline_evaluators_);
+    std::vector<std::unique_ptr<spsc_queue<job>>> to_eval;
+    std::vector<std::unique_ptr<spsc_queue<job>>> from_eval;
+    for (int k = 0; k < pipeline_evaluators_; k++) {
+      to_eval.push_back(std::make_unique<spsc_queue<job>>(depth));
+      from_eval.push_back(std::make_unique<spsc_queue<job>>(depth));
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> evaluators;
+    for (int k = 0; k < pipeline_evaluators_; k++) {
+      evaluators.emplace_back([this, k, &to_eval, &from_eval, &done, &elapsed_ns] {
+        job j;
+        while (true) {
+          if (!to_eval[k]->try_pop(j)) {
+            if (done.load(std::memory_order_acquire)) {
+              return;
+            }
+            std::this_thread::yield();
+            continue;
+          }
+          auto start = clock::now();
+          try {
+            j.ast = complete_ast(j.ast, depth_limit_, action_factory_, &grammar_);
+            j.value = evaluate(j.ast, &j.key, &j.fit_passes);
+          } catch (...) {
+            j.error = std::current_exception();
+          }
+          j.eval_ns = elapsed_ns(start);
+          while (!from_eval[k]->try_push(std::move(j))) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+
+    std::map<std::size_t, job> reorder;
+    std::size_t next_seq = 0;
+    std::size_t issued = 0;
+    std::size_t in_flight = 0;
+    int num_selected = 0;
+    int next_evaluator = 0;
+    bool stop = false;
+    std::exception_ptr error = nullptr;
+
+    try {
+      while ((!stop && num_selected < num_sim) || in_flight > 0) {
+        bool progressed = false;
+
+        // backprop stage
+        for (auto& ring : from_eval) {
+          job j;
+          while (ring->try_pop(j)) {
+            reorder.emplace(j.seq, std::move(j));
+          }
+        }
+        for (auto it = reorder.find(next_seq); it != reorder.end(); it = reorder.find(next_seq)) {
+          job& j = it->second;
+          auto start = clock::now();
+          pipeline_stats_.eval_ns += j.eval_ns;
+          pipeline_stats_.queue_ns += elapsed_ns(j.issued) - j.eval_ns;
+          revert_virtual_loss(j.leaf, j.penalty, backup_);
+          if (j.error) {
+            if (!error) {
+              error = j.error;
+            }
+            stop = true;
+          } else {
+            num_evaluations_ += j.fit_passes;
+            record_rollout(j.leaf, j.ast, j.value, j.key);
+            if (j.leaf->get_unconnected() == 0) {
+              mark_solved(j.leaf, j.value);
+            }
+            if (j.value > early_term_thresh_ && !ast_within_thresh_) {
+              ast_within_thresh_ = j.ast;
+              stop = true;
+            }
+          }
+          pipeline_stats_.backprop_ns += elapsed_ns(start);
+          pipeline_stats_.num_jobs++;
+          reorder.erase(it);
+          next_seq++;
+          in_flight--;
+          progressed = true;
+        }
+
+        // selection stage
+        if (!stop && num_selected < num_sim && in_flight < depth
+            && (should_stop() || curr->is_solved())) {
+          stop = true;
+        }
+        if (!stop && num_selected < num_sim && in_flight < depth) {
+          auto start = clock::now();
+          search_node* leaf = select(curr);
+          num_selected++;
+          progressed = true;
+          if (leaf) {
+            num_explored_++;
+            num_evaluations_++;
+            job j;
+            j.penalty = get_virtual_loss(leaf);
+            apply_virtual_loss(leaf, j.penalty, backup_);
+            j.seq = issued++;
+            j.leaf = leaf;
+            j.ast = build_ast_upward(leaf);
+            j.issued = clock::now();
+            pipeline_stats_.select_ns += elapsed_ns(start);
+            while (!to_eval[next_evaluator]->try_push(std::move(j))) {
+              std::this_thread::yield();
+            }
+            next_evaluator = (next_evaluator + 1) % pipeline_evaluators_;
+            in_flight++;
+          }
+        }
+
+        pipeline_stats_.num_samples++;
+        pipeline_stats_.occupancy_sum += in_flight;
+        pipeline_stats_.max_occupancy = std::max(pipeline_stats_.max_occupancy, in_flight);
+        if (!progressed) {
+          std::this_thread::yield();
+        }
+      }
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+      // evaluators block on full rings, so whatever is in flight is drained
+      in_flight -= reorder.size();
+      while (in_flight > 0) {
+        for (auto& ring : from_eval) {
+          job j;
+          while (ring->try_pop(j)) {
+            in_flight--;
+          }
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    done.store(true, std::memory_order_release);
+    for (auto& evaluator : evaluators) {
+      evaluator.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+#ifdef SYMREG_HAS_COROUTINES
+  /**
+   * @brief a single simulation written as a coroutine
+   *
+   * Selection, expansion and backpropagation run on whichever thread drives
+   * sched. The leaf's evaluation is the one suspension point: a regressor
+   * evaluation is submitted to the inference broker (or run on pool_ when
+   * there is no broker) and a rollout is completed and scored on pool_.
+   * While this coroutine is suspended the leaf's path carries a virtual
+   * loss, so other simulations are steered elsewhere.
+   *
+   * @param curr the node to start the leaf search from
+   * @param sched the scheduler which resumes this coroutine
+   */
+  template <class Regressor, class Policy>
+  sim_task simulator<Regressor, Policy>::simulation_step(search_node* curr, serial_scheduler& sched) {
+    search_node* leaf = select(curr);
+    if (!leaf) {
+      co_return;
+    }
+    num_explored_++;
+    num_evaluations_++;
+    double penalty = get_virtual_loss(leaf);
+    apply_virtual_loss(leaf, penalty, backup_);
+    std::shared_ptr<AST> partial = build_ast_upward(leaf);
+
+    // awaitables are named rather than awaited as temporaries: gcc mishandles
+    // the lifetime of temporaries holding captures across a suspension
+    if (regr_) {
+      typename inference_broker<Regressor>::result_type inferred;
+      if (broker_) {
+        auto inference = infer(*broker_, sched, partial->to_string());
+        inferred = co_await inference;
+      } else {
+        auto inference = offload(*pool_, sched, [this, partial] {
+          return regr_->inference(partial->to_string());
+        });
+        inferred = co_await inference;
+      }
+      revert_virtual_loss(leaf, penalty, backup_);
+      backprop(inferred.first, leaf, backup_);
+    } else {
+      auto evaluation = offload(*pool_, sched, [this, partial] {
+        auto ast = complete_ast(partial, depth_limit_, action_factory_, &grammar_);
+        std::size_t key = 0;
+        std::size_t fit_passes = 0;
+        double value = evaluate(ast, &key, &fit_passes);
+        return std::make_tuple(ast, value, key, fit_passes);
+      });
+      auto result = co_await evaluation;
+      auto& [ast, value, key, fit_passes] = result;
+      revert_virtual_loss(leaf, penalty, backup_);
+      num_evaluations_ += fit_passes;
+      record_rollout(leaf, ast, value, key);
+      if (leaf->get_unconnected() == 0) {
+        mark_solved(leaf, value);
+      }
+      if (value > early_term_thresh_ && !ast_within_thresh_) {
+        ast_within_thresh_ = ast;
+      }
+    }
+  }
+
+  /**
+   * @brief runs num_sim simulation coroutines, at most coroutine_simulations_
+   * of them suspended at once
+   *
+   * The calling thread drives the scheduler, so it is the only thread which
+   * ever touches the tree. New simulations are started whenever a slot is
+   * free; otherwise the caller waits for an evaluation to finish and resumes
+   * the coroutine which was waiting on it. When every slot is waiting on the
+   * inference broker it is flushed so their requests go out as one batch.
+   *
+   * @param curr the node to start leaf searches from
+   * @param num_sim the number of simulations to run
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::simulate_coroutines(search_node* curr, int num_sim) {
+    if (!pool_) {
+      pool_ = std::make_shared<thread_pool>();
+    }
+    serial_scheduler sched;
+    std::vector<sim_task> running;
+    std::exception_ptr error = nullptr;
+    int launched = 0;
+    // a failed simulation stops new ones from starting, but the others are
+    // still drained so nothing is left to resume into a dead scheduler
+    auto reap = [&running, &error] {
+      for (auto it = running.begin(); it != running.end();) {
+        if (it->done()) {
+          try {
+            it->rethrow_if_failed();
+          } catch (...) {
+            if (!error) {
+              error = std::current_exception();
+            }
+          }
+          it = running.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    };
+
+    while (true) {
+      while (!error && !ast_within_thresh_ && launched < num_sim
+          && running.size() < static_cast<std::size_t>(coroutine_simulations_)
+          && !should_stop() && !curr->is_solved()) {
+        running.push_back(simulation_step(curr, sched));
+        launched++;
+        running.back().start();
+        reap();
+      }
+      if (running.empty()) {
+        break;
+      }
+      if (broker_) {
+        broker_->flush();
+      }
+      sched.run_one();
+      reap();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+#endif
+
   /**
    * @brief checks whether an AST was encountered whose reward
    * was >= the early stopping threshold
    * @return true if a suitable AST was encountered, false otherwise
    */
-  template <class Regressor>
-  bool simulator<Regressor>::got_reward_within_thresh() {
+  template <class Regressor, class Policy>
+  bool simulator<Regressor, Policy>::got_reward_within_thresh() {
     return ast_within_thresh_.get();
   }
 
@@ -633,49 +1709,349 @@ namespace simulator
    * was encountered, returns a shared_pointer to this AST. If no such
    * AST has been seen, should return a nullptr
    */
-  template <class Regressor>
-  std::shared_ptr<AST> simulator<Regressor>::get_ast_within_thresh() {
+  template <class Regressor, class Policy>
+  std::shared_ptr<AST> simulator<Regressor, Policy>::get_ast_within_thresh() {
     return ast_within_thresh_;
   }
 
+  /**
+   * @brief routes this simulator's regressor evaluations through broker.
+   * passing the same broker to several simulators batches their requests
+   * together. passing nullptr restores one-at-a-time inference
+   * @param broker a shared pointer to an inference broker
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_inference_broker(
+      std::shared_ptr<inference_broker<Regressor>> broker) {
+    broker_ = broker;
+  }
+
+  template <class Regressor, class Policy>
+  std::shared_ptr<inference_broker<Regressor>> simulator<Regressor, Policy>::get_inference_broker() {
+    return broker_;
+  }
+
+  /**
+   * @brief turns pipelined rollout simulation on or off
+   * @param num_evaluators the number of evaluator threads. 0 disables pipelining
+   * @param depth the maximum number of simulations in flight at once
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_pipeline(int num_evaluators, std::size_t depth) {
+    pipeline_evaluators_ = num_evaluators;
+    pipeline_depth_ = depth;
+  }
+
+  /**
+   * @brief turns coroutine simulation on or off. has no effect unless
+   * symreg is built as C++20
+   * @param in_flight the maximum number of simulations suspended at once.
+   * 0 disables coroutine simulation
+   * @param pool the executor leaf evaluations are offloaded to. a pool sized
+   * to the hardware is created on first use if none is given
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_coroutines(int in_flight, std::shared_ptr<thread_pool> pool) {
+    coroutine_simulations_ = in_flight;
+    if (pool) {
+      pool_ = pool;
+    }
+  }
+
+  /**
+   * @brief sets when simulation should stop early, e.g. because a deadline
+   * has passed. a default constructed stop_condition never stops
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_stop_condition(stop_condition stop) {
+    stop_ = stop;
+  }
+
+  /**
+   * @brief stops simulation once this many leaves have been evaluated in
+   * total, counting from the last reset. leaves already in flight count
+   * towards the limit, so it is never exceeded
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_explore_limit(std::size_t limit) {
+    explore_limit_ = limit;
+  }
+
+  /**
+   * @brief stops simulation once the dataset has been evaluated this many
+   * times in total, counting from the last reset (see
+   * get_num_evaluations()). the passes constant fitting makes are only
+   * known once a leaf's evaluation is done, so the limit may be exceeded by
+   * the fitting of the last leaves
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_evaluation_limit(std::size_t limit) {
+    evaluation_limit_ = limit;
+  }
+
+  /**
+   * @brief sets how rewards are backed up the tree. should be set before
+   * the first simulation of a search, since q values already in the tree
+   * aren't recomputed
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_backup_rule(backup_rule rule) {
+    backup_ = rule;
+  }
+
+  template <class Regressor, class Policy>
+  const backup_rule& simulator<Regressor, Policy>::get_backup_rule() const {
+    return backup_;
+  }
+
+  /**
+   * @brief sets the reward of the virtual visits paths with an evaluation
+   * in flight get. NaN, the default, stands for virtual_loss_penalty()
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_virtual_loss(double penalty) {
+    virtual_loss_ = penalty;
+  }
+
+  /**
+   * @brief the penalty to apply a virtual loss to a leaf's path with
+   */
+  template <class Regressor, class Policy>
+  double simulator<Regressor, Policy>::get_virtual_loss(search_node* leaf) {
+    return std::isnan(virtual_loss_) ? virtual_loss_penalty(leaf, backup_) : virtual_loss_;
+  }
+
+  /**
+   * @brief sets the table through which equivalent search nodes share
+   * their statistics, or nullptr to turn transpositions off. statistics are
+   * shared by the sequential simulation loop; with pipelining, batching or
+   * coroutines, new nodes only start out with what the table already knows
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_transposition_table(std::shared_ptr<transposition_table> table) {
+    transpositions_ = table;
+  }
+
+  template <class Regressor, class Policy>
+  std::shared_ptr<transposition_table> simulator<Regressor, Policy>::get_transposition_table() {
+    return transpositions_;
+  }
+
+  /**
+   * @brief sets the rules by which redundant actions are dropped at expansion
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_action_pruner(action_pruner pruner) {
+    pruner_ = pruner;
+  }
+
+  /**
+   * @brief a getter for the action pruner, e.g. to see how many actions it dropped
+   */
+  template <class Regressor, class Policy>
+  const action_pruner& simulator<Regressor, Policy>::get_action_pruner() const {
+    return pruner_;
+  }
+
+  /**
+   * @brief sets the constraints expressions are kept to at expansion and
+   * during rollouts
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_grammar(grammar g) {
+    grammar_ = g;
+  }
+
+  template <class Regressor, class Policy>
+  const grammar& simulator<Regressor, Policy>::get_grammar() const {
+    return grammar_;
+  }
+
+  /**
+   * @brief sets how many of their moves expanded nodes get as children
+   * given their visit counts. only affects nodes expanded afterwards
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_widening_rule(widening_rule rule) {
+    widening_ = rule;
+  }
+
+  template <class Regressor, class Policy>
+  const widening_rule& simulator<Regressor, Policy>::get_widening_rule() const {
+    return widening_;
+  }
+
+  /**
+   * @brief sets the cache by which rollouts computing a function already
+   * evaluated are recognized, or nullptr to turn semantic deduplication off
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_semantic_cache(std::shared_ptr<semantic_cache> cache) {
+    semantics_ = cache;
+  }
+
+  template <class Regressor, class Policy>
+  std::shared_ptr<semantic_cache> simulator<Regressor, Policy>::get_semantic_cache() {
+    return semantics_;
+  }
+
+  /**
+   * @brief fits the numbers of promising rollouts with fitter, see
+   * evaluate(). nullptr turns fitting off
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::set_constant_fitter(std::shared_ptr<constant_fitter> fitter) {
+    fitter_ = fitter;
+  }
+
+  template <class Regressor, class Policy>
+  std::shared_ptr<constant_fitter> simulator<Regressor, Policy>::get_constant_fitter() {
+    return fitter_;
+  }
+
+  /**
+   * @brief how many rollouts computed a function some earlier rollout had
+   * already computed. always 0 without a semantic cache
+   */
+  template <class Regressor, class Policy>
+  std::size_t simulator<Regressor, Policy>::get_num_equivalent() const {
+    return semantics_ ? semantics_->get_num_equivalent() : 0;
+  }
+
+  /**
+   * @brief whether the stop condition is met or the explore or evaluation
+   * limit reached
+   */
+  template <class Regressor, class Policy>
+  bool simulator<Regressor, Policy>::should_stop() const {
+    return num_explored_ >= explore_limit_ || num_evaluations_ >= evaluation_limit_
+      || stop_.should_stop();
+  }
+
+  /**
+   * @brief a getter for the stage timings gathered by pipelined simulation
+   */
+  template <class Regressor, class Policy>
+  const pipeline_stats& simulator<Regressor, Policy>::get_pipeline_stats() const {
+    return pipeline_stats_;
+  }
+
   /**
    * @brief resets the state of the simulator, enabling it to be reused
    */
-  template <class Regressor>
-  void simulator<Regressor>::reset() {
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::reset() {
     ast_within_thresh_ = nullptr;
     num_explored_ = 0;
+    num_evaluations_ = 0;
+    pipeline_stats_ = pipeline_stats{};
+    priq_.clear();
+    if (transpositions_) {
+      transpositions_->clear();
+    }
+    if (semantics_) {
+      semantics_->clear();
+    }
   }
 
   /**
    * @brief puts all of the AST's in the priority queue in a vector and
-   * returns them
+   * returns them. the queue itself is left intact, so this may be called
+   * while other threads are still pushing to it
    * @return a vector of shared pointers to ASTs. these ASTs will been among
    * the top N highest rewarding ASTs encountered in simulation
    */
-  template <class Regressor>
-  std::vector<std::shared_ptr<AST>> simulator<Regressor>::dump_pri_q() {
+  template <class Regressor, class Policy>
+  std::vector<std::shared_ptr<AST>> simulator<Regressor, Policy>::dump_pri_q() {
     std::vector<std::shared_ptr<AST>> vec;
-    auto pair_vec = priq_.dump();
+    auto pair_vec = priq_.snapshot();
     for (auto& pair : pair_vec) {
       vec.push_back(pair.first);
     }
     return vec;
   } 
 
-  template <class Regressor>
-  std::size_t simulator<Regressor>::get_num_explored() const {
+  /**
+   * @brief like dump_pri_q(), but each AST is paired with its reward
+   */
+  template <class Regressor, class Policy>
+  std::vector<priq_elem_type> simulator<Regressor, Policy>::dump_scored_pri_q() {
+    return priq_.snapshot();
+  }
+
+  /**
+   * @brief raises the reward an AST must beat to enter the priority queue
+   * @param threshold the new admission threshold. lower values are ignored
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::raise_admission_threshold(double threshold) {
+    priq_.raise_threshold_to(threshold);
+  }
+
+  template <class Regressor, class Policy>
+  std::size_t simulator<Regressor, Policy>::get_num_explored() const {
     return num_explored_;
   }
 
-  template <class Regressor>
-  double simulator<Regressor>::get_reward(std::shared_ptr<AST> ast) {
-    return 1 - loss_fn_->loss(ds_, ast);
+  /**
+   * @brief how many times the dataset was evaluated since the last reset:
+   * once per explored leaf, by its rollout or in its stead by the regressor,
+   * plus every pass constant fitting made over the dataset and scoring the
+   * ASTs it fit. with evaluator threads, the fitting of leaves still in
+   * flight isn't counted yet
+   */
+  template <class Regressor, class Policy>
+  std::size_t simulator<Regressor, Policy>::get_num_evaluations() const {
+    return num_evaluations_;
+  }
+
+  /**
+   * @brief the reward of a complete AST, one minus its loss. may be called
+   * from evaluator threads
+   * @param ast the AST
+   * @param key if not nullptr, receives the AST's semantic key, hashed from
+   * the predictions the loss computed rather than by evaluating the AST
+   * again, or 0 without a semantic cache
+   */
+  template <class Regressor, class Policy>
+  double simulator<Regressor, Policy>::get_reward(std::shared_ptr<AST> ast, std::size_t* key) {
+    if (!key || !semantics_) {
+      if (key) {
+        *key = 0;
+      }
+      return 1 - loss_fn_->loss(ds_, ast);
+    }
+    std::vector<double> y_hat;
+    double reward = 1 - loss_fn_->loss(ds_, ast, &y_hat);
+    *key = semantics_->key(y_hat);
+    return reward;
+  }
+
+  /**
+   * @brief pushes an AST to the top N, unless the semantic cache has seen
+   * an equivalent AST
+   */
+  template <class Regressor, class Policy>
+  void simulator<Regressor, Policy>::push_priq(std::shared_ptr<AST> ast) {
+    std::size_t key = 0;
+    double reward = get_reward(ast, &key);
+    if (!semantics_ || semantics_->insert(key)) {
+      priq_.push(std::make_pair(ast, reward));
+    }
+  }
+
+  template <class Regressor, class Policy>
+  int simulator<Regressor, Policy>::get_depth_limit() const {
+    return depth_limit_;
   }
 
-  template <class Regressor>
-  void simulator<Regressor>::push_priq(std::shared_ptr<AST> ast) {
-    priq_.push(std::make_pair(ast, get_reward(ast)));
+  /**
+   * @brief randomly completes a partial AST in place, within this
+   * simulator's depth limit
+   */
+  template <class Regressor, class Policy>
+  std::shared_ptr<AST> simulator<Regressor, Policy>::complete(std::shared_ptr<AST> ast) {
+    return complete_ast(ast, depth_limit_, action_factory_, &grammar_);
   }
 
 } // simulator
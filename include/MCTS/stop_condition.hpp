@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief a flag which can be raised from any thread to stop a search.
+ * copies share the same flag, so keep one and hand a copy to the search
+ */
+class cancel_token {
+  private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+  public:
+    cancel_token();
+    void cancel();
+    bool is_cancelled() const;
+};
+
+inline cancel_token::cancel_token()
+  : cancelled_(std::make_shared<std::atomic<bool>>(false))
+{}
+
+inline void cancel_token::cancel() {
+  cancelled_->store(true, std::memory_order_relaxed);
+}
+
+inline bool cancel_token::is_cancelled() const {
+  return cancelled_->load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief when a search should give up: once a cancel token is raised, once
+ * a wall-clock deadline has passed, or both. a default constructed
+ * stop_condition never stops.
+ *
+ * should_stop() is polled between simulations, so it costs a relaxed load
+ * and, when there is a deadline, one read of the steady clock.
+ */
+class stop_condition {
+  public:
+    using clock = std::chrono::steady_clock;
+  private:
+    cancel_token token_;
+    clock::time_point deadline_;
+  public:
+    stop_condition();
+    stop_condition(cancel_token);
+    stop_condition(clock::time_point);
+    stop_condition(cancel_token, clock::time_point);
+    bool should_stop() const;
+    bool has_deadline() const;
+    clock::time_point get_deadline() const;
+    stop_condition with_deadline(clock::time_point) const;
+};
+
+inline stop_condition::stop_condition()
+  : stop_condition(cancel_token(), clock::time_point::max())
+{}
+
+inline stop_condition::stop_condition(cancel_token token)
+  : stop_condition(token, clock::time_point::max())
+{}
+
+inline stop_condition::stop_condition(clock::time_point deadline)
+  : stop_condition(cancel_token(), deadline)
+{}
+
+/**
+ * @brief stop condition constructor
+ * @param token stops the search once cancelled
+ * @param deadline stops the search once passed
+ */
+inline stop_condition::stop_condition(cancel_token token, clock::time_point deadline)
+  : token_(token), deadline_(deadline)
+{}
+
+inline bool stop_condition::should_stop() const {
+  if (token_.is_cancelled()) {
+    return true;
+  }
+  return has_deadline() && clock::now() >= deadline_;
+}
+
+inline bool stop_condition::has_deadline() const {
+  return deadline_ != clock::time_point::max();
+}
+
+inline stop_condition::clock::time_point stop_condition::get_deadline() const {
+  return deadline_;
+}
+
+/**
+ * @brief a stop condition sharing this one's cancel token whose deadline is
+ * the earlier of this one's and deadline
+ */
+inline stop_condition stop_condition::with_deadline(clock::time_point deadline) const {
+  return stop_condition(token_, std::min(deadline_, deadline));
+}
+
+}
+}
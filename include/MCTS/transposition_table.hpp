@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+#include "brick.hpp"
+#include "MCTS/search_node.hpp"
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief mixes v into the hash h
+ */
+inline std::size_t hash_combine(std::size_t h, std::size_t v) {
+  return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+/**
+ * @brief a canonical hash of a (possibly partial) AST. two ASTs hash the
+ * same when they have the same nodes in the same places, however the
+ * search got to them: which slot was filled first leaves no trace
+ * @param ast the AST to hash
+ */
+inline std::size_t hash_ast(brick::AST::AST& ast) {
+  auto& node = ast.get_node();
+  std::size_t h = std::hash<std::string>{}(node->to_string());
+  h = hash_combine(h, node->get_node_type());
+  h = hash_combine(h, ast.get_children().size());
+  for (auto& child : ast.get_children()) {
+    h = hash_combine(h, hash_ast(*child));
+  }
+  return h;
+}
+
+/**
+ * @brief statistics shared between search nodes which encode the same
+ * partial AST
+ *
+ * The up-links let the same partial AST be reached through different
+ * orders of moves, each with its own search node. Each of those nodes is
+ * keyed by the hash of its AST (see search_node::get_state_key()). Before
+ * a simulation is backpropagated through a keyed node, the node pulls the
+ * statistics of its state from the table, and afterwards pushes them back.
+ * Equivalent nodes thus share their visits, values and solved status, as
+ * if they were one node in a DAG, although each only catches up with the
+ * others when it is next touched. A node created for a state the table
+ * already knows starts out with the state's statistics.
+ */
+class transposition_table {
+  public:
+    struct entry {
+      int n = 0;
+      double q = 0;
+      double mean_q = 0;
+      double max_q = -std::numeric_limits<double>::infinity();
+      bool solved = false;
+      double solved_value = 0;
+    };
+  private:
+    std::unordered_map<std::size_t, entry> entries_;
+    std::size_t num_hits_ = 0;
+  public:
+    bool pull(search_node&);
+    void push(const search_node&);
+    const entry* find(std::size_t) const;
+    std::size_t size() const;
+    std::size_t get_num_hits() const;
+    void clear();
+};
+
+/**
+ * @brief brings a keyed node up to date with its state. nothing happens
+ * unless other nodes of the same state have added visits the node hasn't
+ * seen, or solved the state
+ * @param node the node to update
+ * @return whether the node was updated
+ */
+inline bool transposition_table::pull(search_node& node) {
+  auto it = entries_.find(node.get_state_key());
+  if (!node.get_state_key() || it == entries_.end()) {
+    return false;
+  }
+  const entry& e = it->second;
+  if (e.n <= node.get_n() && (!e.solved || node.is_solved())) {
+    return false;
+  }
+  node.set_n(e.n);
+  node.set_q(e.q);
+  node.set_mean_q(e.mean_q);
+  node.set_max_q(e.max_q);
+  if (e.solved) {
+    node.set_solved(true, e.solved_value);
+  }
+  num_hits_++;
+  return true;
+}
+
+/**
+ * @brief records a keyed node's statistics as those of its state
+ */
+inline void transposition_table::push(const search_node& node) {
+  if (!node.get_state_key()) {
+    return;
+  }
+  entry& e = entries_[node.get_state_key()];
+  e.n = node.get_n();
+  e.q = node.get_q();
+  e.mean_q = node.get_mean_q();
+  e.max_q = node.get_max_q();
+  e.solved = node.is_solved();
+  e.solved_value = node.get_solved_value();
+}
+
+/**
+ * @brief the statistics of a state, or nullptr if the state is unknown
+ */
+inline const transposition_table::entry* transposition_table::find(std::size_t key) const {
+  auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : &it->second;
+}
+
+inline std::size_t transposition_table::size() const {
+  return entries_.size();
+}
+
+/**
+ * @brief how many times a node caught up with statistics gathered by an
+ * equivalent node
+ */
+inline std::size_t transposition_table::get_num_hits() const {
+  return num_hits_;
+}
+
+inline void transposition_table::clear() {
+  entries_.clear();
+  num_hits_ = 0;
+}
+
+}
+}
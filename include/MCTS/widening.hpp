@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include "util.hpp"
+
+namespace symreg
+{
+namespace MCTS
+{
+
+/**
+ * @brief progressive widening: how many of its moves a node gets as
+ * children, given how often it has been visited.
+ *
+ * A node visited n times has max(1, floor(k * n^alpha)) children, or all
+ * of its moves if it has fewer. The remaining moves are kept pending on
+ * the node (see search_node::get_pending()), best prior first, and only
+ * attached once the node has been visited often enough. With k = 0,
+ * widening is off and every move is attached on expansion.
+ */
+struct widening_rule {
+  double k = 0;
+  double alpha = .5;
+  bool is_enabled() const;
+  std::size_t allowed(int) const;
+  int next_due(std::size_t) const;
+  static widening_rule from_config(util::config&);
+};
+
+inline bool widening_rule::is_enabled() const {
+  return k > 0;
+}
+
+/**
+ * @brief how many children a node visited n times may have
+ * @param n the node's visit count
+ */
+inline std::size_t widening_rule::allowed(int n) const {
+  double width = k * std::pow(std::max(n, 1), alpha);
+  return std::max<std::size_t>(1, static_cast<std::size_t>(width));
+}
+
+/**
+ * @brief the visit count from which on a node with num_children children
+ * may have one more
+ * @param num_children how many children the node has
+ */
+inline int widening_rule::next_due(std::size_t num_children) const {
+  int n = static_cast<int>(std::ceil(std::pow((num_children + 1) / k, 1 / alpha)));
+  n = std::max(n, 1);
+  // correct for rounding in pow
+  while (allowed(n) <= num_children) {
+    n++;
+  }
+  while (n > 1 && allowed(n - 1) > num_children) {
+    n--;
+  }
+  return n;
+}
+
+/**
+ * @brief reads mcts.widening_k and mcts.widening_alpha. widening is off by
+ * default
+ */
+inline widening_rule widening_rule::from_config(util::config& cfg) {
+  widening_rule rule{cfg.get_or<double>("mcts.widening_k", 0),
+    cfg.get_or<double>("mcts.widening_alpha", .5)};
+  if (rule.k < 0 || rule.alpha <= 0) {
+    std::cerr << "Error: widening_k must be at least 0 and widening_alpha greater than 0" << std::endl;
+    throw "InvalidWideningException";
+  }
+  return rule;
+}
+
+}
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fixed_size_priority_queue.hpp"
+
+namespace symreg
+{
+
+/**
+ * @brief returns a small integer uniquely identifying the calling thread.
+ * slots are handed out in the order threads first ask for one
+ */
+inline std::size_t this_thread_slot() {
+  static std::atomic<std::size_t> next_slot(0);
+  thread_local std::size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+  return slot;
+}
+
+/**
+ * @brief a top N priority queue which many threads may push to at once
+ *
+ * Every pushing thread is mapped onto its own shard, a bounded
+ * fixed_priority_queue guarded by a mutex which only that thread and
+ * snapshot()/clear() ever take, so pushes don't contend with each other.
+ * Whenever a shard is full, its worst key is published to an atomic
+ * admission threshold: if some shard already holds N elements better than
+ * a candidate, the candidate can't be among the global top N, so push()
+ * rejects it with a single relaxed load before touching any shard.
+ *
+ * Key must map an element to a double such that cmp(a, b) iff key(a) > key(b),
+ * i.e. larger keys are better.
+ */
+template <typename T, typename Cmp, typename Sign, typename Key>
+class concurrent_priority_queue {
+  private:
+    struct alignas(64) shard {
+      std::mutex mtx;
+      fixed_priority_queue<T, Cmp, Sign> priq;
+      shard(Cmp, Sign, int);
+      shard(const fixed_priority_queue<T, Cmp, Sign>&);
+    };
+    Cmp cmp_;
+    Sign sign_;
+    Key key_;
+    int N_;
+    std::vector<std::unique_ptr<shard>> shards_;
+    std::atomic<double> threshold_;
+    void raise_threshold(double);
+  public:
+    concurrent_priority_queue(Cmp, Sign, Key, int, std::size_t = 0);
+    concurrent_priority_queue(const concurrent_priority_queue&);
+    void push(T);
+    bool admits(const T&) const;
+    double get_threshold() const;
+    void raise_threshold_to(double);
+    std::vector<T> snapshot() const;
+    void clear();
+    std::size_t capacity() const;
+};
+
+template <class T, class Cmp, class Sign, class Key>
+concurrent_priority_queue<T, Cmp, Sign, Key>::shard::shard(Cmp cmp, Sign sign, int N)
+  : priq(cmp, sign, N)
+{}
+
+template <class T, class Cmp, class Sign, class Key>
+concurrent_priority_queue<T, Cmp, Sign, Key>::shard::shard(
+    const fixed_priority_queue<T, Cmp, Sign>& priq)
+  : priq(priq)
+{}
+
+/**
+ * @brief concurrent priority queue constructor
+ * @param cmp a lambda (returning a bool) for comparing two elements of type T
+ * @param sign a lambda which returns a signature of element type T. no two
+ * elements with the same signature are held by a shard, nor by a snapshot
+ * @param key a lambda mapping an element to a double, larger being better
+ * @param N the maximum number of elements reported by snapshot()
+ * @param num_shards how many per thread buffers to keep. defaults to the
+ * hardware concurrency. threads beyond this count share shards.
+ */
+template <class T, class Cmp, class Sign, class Key>
+concurrent_priority_queue<T, Cmp, Sign, Key>::concurrent_priority_queue(
+    Cmp cmp, Sign sign, Key key, int N, std::size_t num_shards)
+  : cmp_(cmp), sign_(sign), key_(key), N_(N),
+    threshold_(-std::numeric_limits<double>::infinity())
+{
+  if (!num_shards) {
+    num_shards = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (std::size_t i = 0; i < num_shards; i++) {
+    shards_.push_back(std::make_unique<shard>(cmp, sign, N));
+  }
+}
+
+/**
+ * @brief concurrent priority queue copy constructor. each shard of other
+ * is locked while it is copied
+ * @param other the queue to copy from
+ */
+template <class T, class Cmp, class Sign, class Key>
+concurrent_priority_queue<T, Cmp, Sign, Key>::concurrent_priority_queue(
+    const concurrent_priority_queue& other)
+  : cmp_(other.cmp_), sign_(other.sign_), key_(other.key_), N_(other.N_),
+    threshold_(other.threshold_.load(std::memory_order_relaxed))
+{
+  for (auto& s : other.shards_) {
+    std::lock_guard<std::mutex> lock(s->mtx);
+    shards_.push_back(std::make_unique<shard>(s->priq));
+  }
+}
+
+/**
+ * @brief lifts the admission threshold to val if val is larger
+ * @param val a candidate threshold
+ */
+template <class T, class Cmp, class Sign, class Key>
+void concurrent_priority_queue<T, Cmp, Sign, Key>::raise_threshold(double val) {
+  double cur = threshold_.load(std::memory_order_relaxed);
+  while (val > cur &&
+      !threshold_.compare_exchange_weak(cur, val, std::memory_order_relaxed)) {}
+}
+
+/**
+ * @brief attempts to add an element to the calling thread's shard
+ * @param t element to be added to queue
+ */
+template <class T, class Cmp, class Sign, class Key>
+void concurrent_priority_queue<T, Cmp, Sign, Key>::push(T t) {
+  if (!admits(t)) {
+    return;
+  }
+  shard& s = *shards_[this_thread_slot() % shards_.size()];
+  std::lock_guard<std::mutex> lock(s.mtx);
+  s.priq.push(std::move(t));
+  if (s.priq.full()) {
+    raise_threshold(key_(s.priq.top()));
+  }
+}
+
+/**
+ * @brief the cheap pre-insertion filter used by push()
+ * @param t a candidate element
+ * @return false if t can't possibly be among the top N
+ */
+template <class T, class Cmp, class Sign, class Key>
+bool concurrent_priority_queue<T, Cmp, Sign, Key>::admits(const T& t) const {
+  return key_(t) > threshold_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief a getter for the current admission threshold. elements whose
+ * key is not above it are dropped by push()
+ */
+template <class T, class Cmp, class Sign, class Key>
+double concurrent_priority_queue<T, Cmp, Sign, Key>::get_threshold() const {
+  return threshold_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief lifts the admission threshold from outside, e.g. when another
+ * search already knows N elements at least this good
+ * @param val the new threshold, ignored if lower than the current one
+ */
+template <class T, class Cmp, class Sign, class Key>
+void concurrent_priority_queue<T, Cmp, Sign, Key>::raise_threshold_to(double val) {
+  raise_threshold(val);
+}
+
+/**
+ * @brief merges the shards into the global top N without modifying them
+ *
+ * Each shard is locked only long enough to copy it, so producers keep
+ * running while the merge itself happens.
+ *
+ * @return the top N elements, ordered as fixed_priority_queue::dump() orders
+ * them (worst first, best last)
+ */
+template <class T, class Cmp, class Sign, class Key>
+std::vector<T> concurrent_priority_queue<T, Cmp, Sign, Key>::snapshot() const {
+  fixed_priority_queue<T, Cmp, Sign> merged(cmp_, sign_, N_);
+  for (auto& s : shards_) {
+    std::vector<T> local;
+    {
+      std::lock_guard<std::mutex> lock(s->mtx);
+      local = s->priq.snapshot();
+    }
+    for (auto& elem : local) {
+      merged.push(std::move(elem));
+    }
+  }
+  return merged.dump();
+}
+
+/**
+ * @brief empties every shard and resets the admission threshold
+ */
+template <class T, class Cmp, class Sign, class Key>
+void concurrent_priority_queue<T, Cmp, Sign, Key>::clear() {
+  for (auto& s : shards_) {
+    std::lock_guard<std::mutex> lock(s->mtx);
+    s->priq.clear();
+  }
+  threshold_.store(-std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+}
+
+/**
+ * @brief a getter for N, the maximum number of elements in a snapshot
+ */
+template <class T, class Cmp, class Sign, class Key>
+std::size_t concurrent_priority_queue<T, Cmp, Sign, Key>::capacity() const {
+  return N_;
+}
+
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dlib/optimization.h>
+
+#include "dataset.hpp"
+#include "expression.hpp"
+#include "util.hpp"
+
+namespace symreg
+{
+
+/**
+ * @brief fits the numbers of an expression to a dataset
+ *
+ * The only constants a search can build are the integers of the action set
+ * and arithmetic combinations of them, so it spends whole subtrees on
+ * constants like (5+(1/4)). Instead, a candidate's numbers are treated as
+ * free parameters and fit to minimize the squared error on the dataset,
+ * either with Levenberg-Marquardt ("lm") or BFGS ("bfgs") from dlib. Both
+ * are given exact gradients of the compiled expression (see
+ * expression::eval_dual()) and at most max_iterations iterations. With
+ * protected_ops, expressions are fit with protected semantics, like the
+ * loss function evaluates them. Every iteration evaluates the expression
+ * over the whole dataset at least once, so fit() can report how many
+ * passes it made, for searches which budget their evaluations.
+ */
+class constant_fitter {
+  private:
+    using AST = brick::AST::AST;
+    using column_vector = dlib::matrix<double, 0, 1>;
+    std::string method_;
+    int max_iterations_;
+    double min_delta_;
+    bool protected_ops_;
+    std::size_t fit_lm(expression&, const dataset&) const;
+    std::size_t fit_bfgs(expression&, const dataset&) const;
+  public:
+    constant_fitter(const std::string& = "lm", int = 20, double = 1e-8, bool = false);
+    static constant_fitter from_config(util::config&);
+    const std::string& get_method() const;
+    int get_max_iterations() const;
+    bool fit(expression&, const dataset&, std::size_t* = nullptr) const;
+    std::shared_ptr<AST> fit(AST&, const dataset&, std::size_t* = nullptr) const;
+};
+
+/**
+ * @param method "lm" or "bfgs"
+ * @param max_iterations the iteration budget per candidate
+ * @param min_delta fitting stops once an iteration improves the squared
+ * error by less than this
+ * @param protected_ops whether to evaluate with protected semantics
+ */
+inline constant_fitter::constant_fitter(const std::string& method, int max_iterations, double min_delta,
+    bool protected_ops)
+  : method_(method),
+    max_iterations_(max_iterations),
+    min_delta_(min_delta),
+    protected_ops_(protected_ops)
+{
+  if (method_ != "lm" && method_ != "bfgs") {
+    std::cerr << "Error: unknown constant fitting method [" << method_ << "], expected lm or bfgs" << std::endl;
+    throw "InvalidFittingMethodException";
+  }
+}
+
+/**
+ * @brief reads mcts.fit_method, mcts.fit_iterations and mcts.protected_ops
+ */
+inline constant_fitter constant_fitter::from_config(util::config& cfg) {
+  return constant_fitter(cfg.get_or<std::string>("mcts.fit_method", "lm"),
+    cfg.get_or<int>("mcts.fit_iterations", 20), 1e-8,
+    cfg.get_or<bool>("mcts.protected_ops", false));
+}
+
+inline const std::string& constant_fitter::get_method() const {
+  return method_;
+}
+
+inline int constant_fitter::get_max_iterations() const {
+  return max_iterations_;
+}
+
+namespace detail
+{
+  inline std::vector<double> to_vector(const dlib::matrix<double, 0, 1>& m) {
+    std::vector<double> v(m.size());
+    for (long i = 0; i < m.size(); i++) {
+      v[i] = m(i);
+    }
+    return v;
+  }
+
+  /**
+   * @brief an expression's dual columns on a dataset (see
+   * expression::eval_dual()), recomputed only when the parameters change.
+   * dlib asks for residuals and derivatives one sample at a time, but with
+   * the same parameters for a whole pass over the samples
+   */
+  class column_cache {
+    private:
+      expression& expr_;
+      const dataset& ds_;
+      dual_columns columns_;
+      bool valid_;
+      std::size_t num_passes_;
+    public:
+      column_cache(expression& expr, const dataset& ds)
+        : expr_(expr), ds_(ds), valid_(false), num_passes_(0)
+      {}
+      const dual_columns& at(const dlib::matrix<double, 0, 1>& params) {
+        auto p = to_vector(params);
+        if (!valid_ || p != expr_.get_params()) {
+          expr_.set_params(p);
+          columns_ = expr_.eval_dual(ds_.x);
+          valid_ = true;
+          num_passes_++;
+        }
+        return columns_;
+      }
+      std::size_t get_num_passes() const {
+        return num_passes_;
+      }
+  };
+}
+
+inline std::size_t constant_fitter::fit_lm(expression& expr, const dataset& ds) const {
+  detail::column_cache cache(expr, ds);
+  std::vector<std::size_t> samples(ds.x.size());
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    samples[i] = i;
+  }
+  auto residual = [&](std::size_t i, const column_vector& params) {
+    return cache.at(params).value[i] - ds.y[i];
+  };
+  auto derivative = [&](std::size_t i, const column_vector& params) {
+    auto& d_params = cache.at(params).d_params;
+    column_vector der(d_params.size());
+    for (std::size_t j = 0; j < d_params.size(); j++) {
+      der(j) = d_params[j][i];
+    }
+    return der;
+  };
+  column_vector params(expr.num_params());
+  for (std::size_t i = 0; i < expr.num_params(); i++) {
+    params(i) = expr.get_params()[i];
+  }
+  dlib::solve_least_squares_lm(dlib::objective_delta_stop_strategy(min_delta_, max_iterations_),
+    residual, derivative, samples, params);
+  expr.set_params(detail::to_vector(params));
+  return cache.get_num_passes();
+}
+
+inline std::size_t constant_fitter::fit_bfgs(expression& expr, const dataset& ds) const {
+  detail::column_cache cache(expr, ds);
+  auto squared_error = [&](const column_vector& params) {
+    auto& y_hat = cache.at(params).value;
+    double sum = 0;
+    for (std::size_t i = 0; i < y_hat.size(); i++) {
+      sum += (y_hat[i] - ds.y[i]) * (y_hat[i] - ds.y[i]);
+    }
+    return sum;
+  };
+  auto gradient = [&](const column_vector& params) {
+    auto& columns = cache.at(params);
+    column_vector der(params.size());
+    for (std::size_t j = 0; j < columns.d_params.size(); j++) {
+      double sum = 0;
+      for (std::size_t i = 0; i < columns.value.size(); i++) {
+        sum += 2 * (columns.value[i] - ds.y[i]) * columns.d_params[j][i];
+      }
+      der(j) = sum;
+    }
+    return der;
+  };
+  column_vector params(expr.num_params());
+  for (std::size_t i = 0; i < expr.num_params(); i++) {
+    params(i) = expr.get_params()[i];
+  }
+  dlib::find_min(dlib::bfgs_search_strategy(),
+    dlib::objective_delta_stop_strategy(min_delta_, max_iterations_),
+    squared_error, gradient, params, 0);
+  expr.set_params(detail::to_vector(params));
+  return cache.get_num_passes();
+}
+
+/**
+ * @brief fits an expression's parameters to a dataset in place. when the
+ * fit diverges, the parameters are left as they were
+ * @param num_passes if not nullptr, receives how many times the expression
+ * was evaluated over the whole dataset
+ * @return whether the parameters were changed
+ */
+inline bool constant_fitter::fit(expression& expr, const dataset& ds, std::size_t* num_passes) const {
+  if (num_passes) {
+    *num_passes = 0;
+  }
+  if (!expr.num_params() || ds.x.empty()) {
+    return false;
+  }
+  auto before = expr.get_params();
+  std::size_t passes = method_ == "lm" ? fit_lm(expr, ds) : fit_bfgs(expr, ds);
+  if (num_passes) {
+    *num_passes = passes;
+  }
+  for (double param : expr.get_params()) {
+    if (!std::isfinite(param)) {
+      expr.set_params(before);
+      return false;
+    }
+  }
+  return expr.get_params() != before;
+}
+
+/**
+ * @brief fits the numbers of a complete AST to a dataset
+ * @param num_passes if not nullptr, receives how many times the AST was
+ * evaluated over the whole dataset
+ * @return a copy of the AST with fitted numbers, or nullptr if the AST has
+ * no numbers or fitting didn't change them
+ */
+inline std::shared_ptr<brick::AST::AST> constant_fitter::fit(AST& ast, const dataset& ds,
+    std::size_t* num_passes) const {
+  expression expr(ast, protected_ops_);
+  if (!fit(expr, ds, num_passes)) {
+    return nullptr;
+  }
+  return expr.to_ast(ast);
+}
+
+}
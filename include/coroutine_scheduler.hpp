@@ -0,0 +1,217 @@
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define SYMREG_HAS_COROUTINES 1
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "inference_broker.hpp"
+#include "thread_pool.hpp"
+
+namespace symreg
+{
+
+/**
+ * @brief the return type of a coroutine which runs one unit of work, e.g.
+ * a single MCTS simulation. it starts suspended and is started with start().
+ * the task owns the coroutine frame and destroys it when it goes away
+ */
+class sim_task {
+  public:
+    struct promise_type {
+      std::exception_ptr error;
+      sim_task get_return_object() {
+        return sim_task(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { error = std::current_exception(); }
+    };
+  private:
+    std::coroutine_handle<promise_type> handle_;
+    explicit sim_task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  public:
+    sim_task(sim_task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    sim_task& operator=(sim_task&& other) noexcept {
+      if (this != &other) {
+        if (handle_) {
+          handle_.destroy();
+        }
+        handle_ = std::exchange(other.handle_, nullptr);
+      }
+      return *this;
+    }
+    sim_task(const sim_task&) = delete;
+    sim_task& operator=(const sim_task&) = delete;
+    ~sim_task() {
+      if (handle_) {
+        handle_.destroy();
+      }
+    }
+
+    /**
+     * @brief runs the coroutine on the calling thread up to its first
+     * suspension point (or to completion)
+     */
+    void start() { handle_.resume(); }
+
+    bool done() const { return handle_.done(); }
+
+    /**
+     * @brief rethrows whatever escaped the coroutine body, if anything
+     */
+    void rethrow_if_failed() const {
+      if (handle_.promise().error) {
+        std::rethrow_exception(handle_.promise().error);
+      }
+    }
+};
+
+/**
+ * @brief resumes suspended coroutines on exactly one thread
+ *
+ * Work which a coroutine offloads elsewhere (a thread pool, an inference
+ * broker) does not resume the coroutine itself. Instead the coroutine's
+ * handle is posted here, and whichever thread drives the scheduler with
+ * run_one() resumes it. Code between suspension points therefore never runs
+ * concurrently, which is what lets simulation coroutines mutate the MCTS
+ * tree without locks.
+ */
+class serial_scheduler {
+  private:
+    std::deque<std::coroutine_handle<>> ready_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+  public:
+    void post(std::coroutine_handle<>);
+    void run_one();
+};
+
+/**
+ * @brief marks a suspended coroutine as ready to resume. safe to call
+ * from any thread
+ * @param handle the coroutine to resume
+ */
+inline void serial_scheduler::post(std::coroutine_handle<> handle) {
+  // notified under the lock: once the handle is resumed the scheduler may
+  // be destroyed, so nothing of it may be touched after unlocking
+  std::lock_guard<std::mutex> lock(mtx_);
+  ready_.push_back(handle);
+  cv_.notify_one();
+}
+
+/**
+ * @brief waits for a coroutine to become ready and resumes it on the
+ * calling thread
+ */
+inline void serial_scheduler::run_one() {
+  std::coroutine_handle<> handle;
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this] { return !ready_.empty(); });
+    handle = ready_.front();
+    ready_.pop_front();
+  }
+  handle.resume();
+}
+
+/**
+ * @brief an awaitable which runs a callable on a thread pool and resumes
+ * the awaiting coroutine through a serial_scheduler once it has finished.
+ * the callable's result (or exception) is handed back by co_await
+ */
+template <class F>
+class offload_awaitable {
+  private:
+    using result_type = std::invoke_result_t<F>;
+    thread_pool& pool_;
+    serial_scheduler& sched_;
+    F f_;
+    std::optional<result_type> result_;
+    std::exception_ptr error_;
+  public:
+    offload_awaitable(thread_pool& pool, serial_scheduler& sched, F f)
+      : pool_(pool), sched_(sched), f_(std::move(f)) {}
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      pool_.post([this, handle] {
+        try {
+          result_.emplace(f_());
+        } catch (...) {
+          error_ = std::current_exception();
+        }
+        sched_.post(handle);
+      });
+    }
+    result_type await_resume() {
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+      return std::move(*result_);
+    }
+};
+
+/**
+ * @brief co_await offload(pool, sched, f) runs f on pool without blocking
+ * the scheduler thread
+ */
+template <class F>
+offload_awaitable<F> offload(thread_pool& pool, serial_scheduler& sched, F f) {
+  return offload_awaitable<F>(pool, sched, std::move(f));
+}
+
+/**
+ * @brief an awaitable which submits a state to an inference broker and
+ * resumes the awaiting coroutine through a serial_scheduler once the
+ * state's batch has been evaluated
+ */
+template <class Regressor, class State>
+class inference_awaitable {
+  private:
+    using broker_type = inference_broker<Regressor, State>;
+    using result_type = typename broker_type::result_type;
+    broker_type& broker_;
+    serial_scheduler& sched_;
+    State state_;
+    result_type result_;
+    std::exception_ptr error_;
+  public:
+    inference_awaitable(broker_type& broker, serial_scheduler& sched, State state)
+      : broker_(broker), sched_(sched), state_(std::move(state)) {}
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      broker_.submit(std::move(state_), [this, handle](std::exception_ptr error, result_type result) {
+        error_ = error;
+        result_ = std::move(result);
+        sched_.post(handle);
+      });
+    }
+    result_type await_resume() {
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+      return std::move(result_);
+    }
+};
+
+/**
+ * @brief co_await infer(broker, sched, state) batches the state's
+ * evaluation with those of other suspended coroutines
+ */
+template <class Regressor, class State>
+inference_awaitable<Regressor, State> infer(
+    inference_broker<Regressor, State>& broker, serial_scheduler& sched, State state) {
+  return inference_awaitable<Regressor, State>(broker, sched, std::move(state));
+}
+
+}
+
+#endif
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "fixed_size_priority_queue.hpp"
+#include "util.hpp"
+#include "distributed/socket.hpp"
+#include "distributed/wire.hpp"
+
+namespace symreg
+{
+namespace distributed
+{
+
+struct candidate_cmp {
+  bool operator()(const candidate& lhs, const candidate& rhs) const {
+    return lhs.reward > rhs.reward;
+  }
+};
+
+struct candidate_sign {
+  std::string operator()(const candidate& cand) const {
+    return cand.expr;
+  }
+};
+
+using candidate_queue = fixed_priority_queue<candidate, candidate_cmp, candidate_sign>;
+
+/**
+ * @brief picks the move the workers should commit to from their aggregated
+ * root statistics. mirrors MCTS::choose_move(): the most visited child wins,
+ * and terminals whose value is below terminal_thresh are only considered
+ * when nothing else is left. ties go to the lowest index
+ * @return the index of the chosen child, or -1 if there are no children
+ */
+inline long choose_move(const std::vector<child_stats>& children, double terminal_thresh) {
+  long best = -1;
+  long best_weak = -1;
+  for (std::size_t i = 0; i < children.size(); i++) {
+    auto& child = children[i];
+    if (child.terminal && child.q < terminal_thresh) {
+      if (best_weak < 0 || child.n > children[best_weak].n) {
+        best_weak = i;
+      }
+    } else if (best < 0 || child.n > children[best].n) {
+      best = i;
+    }
+  }
+  return best >= 0 ? best : best_weak;
+}
+
+/**
+ * @brief hands search work out to worker processes and aggregates what
+ * they find
+ *
+ * Every worker holds its own tree and plays the same game. In each round
+ * the coordinator asks every worker to simulate from the current move:
+ * in root mode each worker searches the whole move (root parallelism),
+ * in subtree mode the children of the move are split between the workers.
+ * Workers report the statistics of the move's children and their top N
+ * candidates. The coordinator sums the statistics, picks the move everyone
+ * commits to, merges the candidates into a global top N and broadcasts
+ * the global admission threshold, i.e. the reward a candidate has to beat
+ * to still make the global top N.
+ */
+class coordinator {
+  private:
+    listener listener_;
+    std::size_t num_workers_;
+    bool subtree_;
+    double terminal_thresh_;
+    std::vector<connection> workers_;
+    candidate_queue top_n_;
+    std::vector<child_stats> root_stats_;
+    std::uint64_t num_explored_;
+    int num_moves_;
+    bool found_within_thresh_;
+    std::vector<report_msg> collect_reports();
+    void merge(const std::vector<report_msg>&);
+  public:
+    coordinator(const std::string&, std::size_t, int, bool = false, double = .999);
+    coordinator(util::config&);
+    const std::string& get_address() const;
+    void accept_workers();
+    void run();
+    double get_threshold() const;
+    std::vector<candidate> get_top_n() const;
+    const std::vector<child_stats>& get_root_stats() const;
+    std::uint64_t get_num_explored() const;
+    int get_num_moves() const;
+    bool got_reward_within_thresh() const;
+};
+
+/**
+ * @brief coordinator constructor. starts listening right away, so workers
+ * may connect before accept_workers() is called
+ * @param address where to listen, see socket.hpp
+ * @param num_workers the number of workers to wait for
+ * @param top_N the size of the global top N
+ * @param subtree whether to split each move's children between workers
+ * rather than have every worker search the whole move
+ * @param terminal_thresh see MCTS::choose_move()
+ */
+inline coordinator::coordinator(const std::string& address, std::size_t num_workers,
+    int top_N, bool subtree, double terminal_thresh)
+  : listener_(address),
+    num_workers_(std::max<std::size_t>(1, num_workers)),
+    subtree_(subtree),
+    terminal_thresh_(terminal_thresh),
+    top_n_(candidate_cmp(), candidate_sign(), top_N),
+    num_explored_(0),
+    num_moves_(0),
+    found_within_thresh_(false)
+{}
+
+/**
+ * @brief .toml configurable coordinator constructor. reads
+ * distributed.address, distributed.num_workers, distributed.mode and
+ * mcts.top_N
+ */
+inline coordinator::coordinator(util::config& cfg)
+  : coordinator(cfg.get<std::string>("distributed.address"),
+      cfg.get<int>("distributed.num_workers"),
+      cfg.get<int>("mcts.top_N"),
+      cfg.get_or<std::string>("distributed.mode", "root") == "subtree")
+{}
+
+/**
+ * @brief the address workers should connect to. when listening on TCP port
+ * 0 this includes the port which was actually picked
+ */
+inline const std::string& coordinator::get_address() const {
+  return listener_.get_address();
+}
+
+/**
+ * @brief blocks until every worker has connected and said hello
+ */
+inline void coordinator::accept_workers() {
+  std::vector<std::uint8_t> payload;
+  while (workers_.size() < num_workers_) {
+    connection conn = listener_.accept();
+    if (conn.receive(payload) != message_type::hello) {
+      std::cerr << "Error: expected hello from worker" << std::endl;
+      throw "ProtocolException";
+    }
+    workers_.push_back(std::move(conn));
+  }
+}
+
+/**
+ * @brief receives one report from every worker
+ */
+inline std::vector<report_msg> coordinator::collect_reports() {
+  std::vector<report_msg> reports(workers_.size());
+  std::vector<std::uint8_t> payload;
+  for (std::size_t i = 0; i < workers_.size(); i++) {
+    if (workers_[i].receive(payload) != message_type::report) {
+      std::cerr << "Error: expected report from worker " << i << std::endl;
+      throw "ProtocolException";
+    }
+    reader in(payload);
+    decode(in, reports[i]);
+  }
+  return reports;
+}
+
+/**
+ * @brief folds a round of reports into the aggregated root statistics, the
+ * global top N and the exploration count
+ */
+inline void coordinator::merge(const std::vector<report_msg>& reports) {
+  root_stats_.clear();
+  num_explored_ = 0;
+  for (auto& report : reports) {
+    if (root_stats_.empty()) {
+      root_stats_.resize(report.children.size());
+    } else if (!report.children.empty() && report.children.size() != root_stats_.size()) {
+      std::cerr << "Error: workers disagree on the children of the current move" << std::endl;
+      throw "ProtocolException";
+    }
+    for (std::size_t i = 0; i < report.children.size(); i++) {
+      auto& agg = root_stats_[i];
+      auto& child = report.children[i];
+      if (agg.n + child.n > 0) {
+        agg.q = (agg.q * agg.n + child.q * child.n) / (agg.n + child.n);
+      }
+      agg.n += child.n;
+      agg.terminal = child.terminal;
+    }
+    for (auto& cand : report.candidates) {
+      top_n_.push(cand);
+    }
+    num_explored_ += report.num_explored;
+    found_within_thresh_ = found_within_thresh_ || report.found_within_thresh;
+  }
+}
+
+/**
+ * @brief plays a whole game with the workers, then tells them to stop
+ *
+ * Each round, every worker simulates and reports. The game is over once a
+ * worker has found an AST within the early termination threshold, or the
+ * current move can't be searched any further. Otherwise the move with the
+ * most aggregated visits is broadcast and the next round begins. Workers
+ * send a final report after being stopped, whose candidates are merged too.
+ */
+inline void coordinator::run() {
+  accept_workers();
+  while (true) {
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      round_msg round;
+      round.partition = subtree_ ? i : 0;
+      round.num_partitions = subtree_ ? workers_.size() : 1;
+      round.threshold = get_threshold();
+      workers_[i].send(message_type::round, round);
+    }
+    auto reports = collect_reports();
+    merge(reports);
+
+    bool game_over = false;
+    for (auto& report : reports) {
+      game_over = game_over || report.game_over;
+    }
+    if (found_within_thresh_ || game_over) {
+      break;
+    }
+    long choice = choose_move(root_stats_, terminal_thresh_);
+    if (choice < 0) {
+      break;
+    }
+    move_msg move;
+    move.child = choice;
+    move.threshold = get_threshold();
+    for (auto& worker : workers_) {
+      worker.send(message_type::move, move);
+    }
+    num_moves_++;
+  }
+
+  for (auto& worker : workers_) {
+    worker.send(message_type::stop, writer());
+  }
+  auto reports = collect_reports();
+  std::uint64_t num_explored = 0;
+  for (auto& report : reports) {
+    for (auto& cand : report.candidates) {
+      top_n_.push(cand);
+    }
+    num_explored += report.num_explored;
+  }
+  num_explored_ = num_explored;
+  workers_.clear();
+}
+
+/**
+ * @brief the reward a candidate must beat to enter the global top N. until
+ * the top N is full, anything gets in
+ */
+inline double coordinator::get_threshold() const {
+  if (!top_n_.full()) {
+    return -std::numeric_limits<double>::infinity();
+  }
+  return top_n_.top().reward;
+}
+
+/**
+ * @brief the global top N candidates, worst first and best last
+ */
+inline std::vector<candidate> coordinator::get_top_n() const {
+  return top_n_.snapshot();
+}
+
+/**
+ * @brief the aggregated statistics of the children of the last move
+ * searched
+ */
+inline const std::vector<child_stats>& coordinator::get_root_stats() const {
+  return root_stats_;
+}
+
+/**
+ * @brief the number of ASTs explored by all workers combined
+ */
+inline std::uint64_t coordinator::get_num_explored() const {
+  return num_explored_;
+}
+
+inline int coordinator::get_num_moves() const {
+  return num_moves_;
+}
+
+inline bool coordinator::got_reward_within_thresh() const {
+  return found_within_thresh_;
+}
+
+}
+}
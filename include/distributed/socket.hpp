@@ -0,0 +1,353 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "distributed/wire.hpp"
+
+namespace symreg
+{
+namespace distributed
+{
+
+/**
+ * Addresses are either "host:port" for TCP, e.g. "127.0.0.1:7070", or
+ * "unix:path" for a Unix domain socket, e.g. "unix:/tmp/symreg.sock".
+ * Listening on port 0 picks a free port.
+ */
+const std::string unix_prefix = "unix:";
+
+inline bool is_unix_address(const std::string& address) {
+  return address.compare(0, unix_prefix.size(), unix_prefix) == 0;
+}
+
+inline void socket_error(const std::string& what, const std::string& address) {
+  std::cerr << "Error: " << what << " [" << address << "]: " << std::strerror(errno) << std::endl;
+  throw "SocketException";
+}
+
+/**
+ * @brief splits a TCP address into host and port
+ */
+inline std::pair<std::string, std::string> split_host_port(const std::string& address) {
+  auto colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    std::cerr << "Error: expected host:port, got [" << address << "]" << std::endl;
+    throw "SocketException";
+  }
+  return std::make_pair(address.substr(0, colon), address.substr(colon + 1));
+}
+
+/**
+ * @brief fills a sockaddr_un for a "unix:path" address
+ */
+inline sockaddr_un unix_sockaddr(const std::string& address) {
+  std::string path = address.substr(unix_prefix.size());
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "Error: unix socket path too long [" << path << "]" << std::endl;
+    throw "SocketException";
+  }
+  std::strcpy(addr.sun_path, path.c_str());
+  return addr;
+}
+
+/**
+ * @brief a connected stream socket which exchanges framed messages
+ */
+class connection {
+  private:
+    int fd_;
+    void send_all(const std::uint8_t*, std::size_t);
+    bool recv_all(std::uint8_t*, std::size_t);
+  public:
+    explicit connection(int = -1);
+    connection(connection&&) noexcept;
+    connection& operator=(connection&&) noexcept;
+    connection(const connection&) = delete;
+    connection& operator=(const connection&) = delete;
+    ~connection();
+    void send(message_type, const writer&);
+    template <class Message>
+    void send(message_type, const Message&);
+    message_type receive(std::vector<std::uint8_t>&);
+    void close();
+};
+
+inline connection::connection(int fd)
+  : fd_(fd)
+{}
+
+inline connection::connection(connection&& other) noexcept
+  : fd_(std::exchange(other.fd_, -1))
+{}
+
+inline connection& connection::operator=(connection&& other) noexcept {
+  if (this != &other) {
+    close();
+    fd_ = std::exchange(other.fd_, -1);
+  }
+  return *this;
+}
+
+inline connection::~connection() {
+  close();
+}
+
+inline void connection::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+inline void connection::send_all(const std::uint8_t* data, std::size_t size) {
+  while (size) {
+    ssize_t sent = ::send(fd_, data, size, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      socket_error("send failed", std::to_string(fd_));
+    }
+    data += sent;
+    size -= sent;
+  }
+}
+
+/**
+ * @return false if the peer closed the connection before size bytes arrived
+ */
+inline bool connection::recv_all(std::uint8_t* data, std::size_t size) {
+  while (size) {
+    ssize_t got = ::recv(fd_, data, size, 0);
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      socket_error("recv failed", std::to_string(fd_));
+    }
+    if (got == 0) {
+      return false;
+    }
+    data += got;
+    size -= got;
+  }
+  return true;
+}
+
+/**
+ * @brief sends a single frame
+ * @param type the type of the message
+ * @param payload the encoded message
+ */
+inline void connection::send(message_type type, const writer& payload) {
+  auto& bytes = payload.bytes();
+  std::uint32_t size = bytes.size() + 1;
+  std::vector<std::uint8_t> frame;
+  frame.reserve(size + 4);
+  for (int i = 0; i < 4; i++) {
+    frame.push_back(static_cast<std::uint8_t>(size >> (8 * i)));
+  }
+  frame.push_back(static_cast<std::uint8_t>(type));
+  frame.insert(frame.end(), bytes.begin(), bytes.end());
+  send_all(frame.data(), frame.size());
+}
+
+/**
+ * @brief encodes msg and sends it as a single frame
+ */
+template <class Message>
+void connection::send(message_type type, const Message& msg) {
+  writer out;
+  encode(out, msg);
+  send(type, out);
+}
+
+/**
+ * @brief blocks until a whole frame has arrived
+ * @param payload where the frame's payload is stored
+ * @return the type of the message received
+ */
+inline message_type connection::receive(std::vector<std::uint8_t>& payload) {
+  std::uint8_t header[5];
+  if (!recv_all(header, sizeof(header))) {
+    std::cerr << "Error: connection closed by peer" << std::endl;
+    throw "SocketException";
+  }
+  std::uint32_t size = 0;
+  for (int i = 0; i < 4; i++) {
+    size |= static_cast<std::uint32_t>(header[i]) << (8 * i);
+  }
+  if (size == 0) {
+    std::cerr << "Error: empty frame" << std::endl;
+    throw "WireFormatException";
+  }
+  payload.resize(size - 1);
+  if (!recv_all(payload.data(), payload.size())) {
+    std::cerr << "Error: connection closed by peer" << std::endl;
+    throw "SocketException";
+  }
+  return static_cast<message_type>(header[4]);
+}
+
+/**
+ * @brief a listening socket which coordinators accept workers on
+ */
+class listener {
+  private:
+    int fd_;
+    std::string address_;
+  public:
+    explicit listener(const std::string&);
+    listener(const listener&) = delete;
+    listener& operator=(const listener&) = delete;
+    ~listener();
+    connection accept();
+    const std::string& get_address() const;
+};
+
+/**
+ * @brief binds and listens on address. for TCP on port 0, get_address()
+ * afterwards reports the port which was picked
+ * @param address where to listen
+ */
+inline listener::listener(const std::string& address)
+  : fd_(-1), address_(address)
+{
+  if (is_unix_address(address)) {
+    sockaddr_un addr = unix_sockaddr(address);
+    ::unlink(addr.sun_path);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0 || ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+      socket_error("couldn't bind", address);
+    }
+  } else {
+    auto host_port = split_host_port(address);
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* info = nullptr;
+    if (::getaddrinfo(host_port.first.c_str(), host_port.second.c_str(), &hints, &info) != 0) {
+      socket_error("couldn't resolve", address);
+    }
+    fd_ = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    int yes = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    int bound = fd_ < 0 ? -1 : ::bind(fd_, info->ai_addr, info->ai_addrlen);
+    ::freeaddrinfo(info);
+    if (bound < 0) {
+      socket_error("couldn't bind", address);
+    }
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    address_ = host_port.first + ":" + std::to_string(ntohs(addr.sin_port));
+  }
+  if (::listen(fd_, SOMAXCONN) < 0) {
+    socket_error("couldn't listen", address);
+  }
+}
+
+inline listener::~listener() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  if (is_unix_address(address_)) {
+    ::unlink(address_.substr(unix_prefix.size()).c_str());
+  }
+}
+
+/**
+ * @brief blocks until a peer connects
+ */
+inline connection listener::accept() {
+  while (true) {
+    int fd = ::accept(fd_, nullptr, nullptr);
+    if (fd >= 0) {
+      if (!is_unix_address(address_)) {
+        int yes = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+      }
+      return connection(fd);
+    }
+    if (errno != EINTR) {
+      socket_error("accept failed", address_);
+    }
+  }
+}
+
+inline const std::string& listener::get_address() const {
+  return address_;
+}
+
+/**
+ * @brief connects to a listener, retrying for a while since workers may be
+ * started before their coordinator
+ * @param address where the listener is
+ * @param timeout how long to keep retrying for
+ * @return the connection
+ */
+inline connection connect(const std::string& address,
+    std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    int fd = -1;
+    int connected = -1;
+    if (is_unix_address(address)) {
+      sockaddr_un addr = unix_sockaddr(address);
+      fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (fd >= 0) {
+        connected = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+      }
+    } else {
+      auto host_port = split_host_port(address);
+      addrinfo hints;
+      std::memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+      addrinfo* info = nullptr;
+      if (::getaddrinfo(host_port.first.c_str(), host_port.second.c_str(), &hints, &info) != 0) {
+        socket_error("couldn't resolve", address);
+      }
+      fd = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+      if (fd >= 0) {
+        connected = ::connect(fd, info->ai_addr, info->ai_addrlen);
+        int yes = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+      }
+      ::freeaddrinfo(info);
+    }
+    if (connected == 0) {
+      return connection(fd);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      socket_error("couldn't connect", address);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
+
+}
+}
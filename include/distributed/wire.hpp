@@ -0,0 +1,271 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace symreg
+{
+namespace distributed
+{
+
+/**
+ * The wire format between a coordinator and its workers.
+ *
+ * Every message is a frame: a 4 byte little endian length, a 1 byte
+ * message_type and then the payload. Inside payloads, counts and indices
+ * are LEB128 varints, doubles are 8 little endian bytes and strings are a
+ * varint length followed by their bytes.
+ */
+enum class message_type : std::uint8_t {
+  hello = 1,  // worker -> coordinator, once after connecting
+  round = 2,  // coordinator -> worker, run one round of simulations
+  report = 3, // worker -> coordinator, the outcome of a round
+  move = 4,   // coordinator -> worker, commit to a child of the current node
+  stop = 5    // coordinator -> worker, finish up and send a final report
+};
+
+/**
+ * @brief appends values to a byte buffer in the wire format
+ */
+class writer {
+  private:
+    std::vector<std::uint8_t> buf_;
+  public:
+    void put_u8(std::uint8_t);
+    void put_varint(std::uint64_t);
+    void put_f64(double);
+    void put_string(const std::string&);
+    const std::vector<std::uint8_t>& bytes() const;
+};
+
+inline void writer::put_u8(std::uint8_t val) {
+  buf_.push_back(val);
+}
+
+/**
+ * @brief writes val 7 bits at a time, low bits first. the high bit of each
+ * byte says whether another byte follows
+ */
+inline void writer::put_varint(std::uint64_t val) {
+  while (val >= 0x80) {
+    buf_.push_back(static_cast<std::uint8_t>(val) | 0x80);
+    val >>= 7;
+  }
+  buf_.push_back(static_cast<std::uint8_t>(val));
+}
+
+inline void writer::put_f64(double val) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+  for (int i = 0; i < 8; i++) {
+    buf_.push_back(static_cast<std::uint8_t>(bits >> (8 * i)));
+  }
+}
+
+inline void writer::put_string(const std::string& str) {
+  put_varint(str.size());
+  buf_.insert(buf_.end(), str.begin(), str.end());
+}
+
+inline const std::vector<std::uint8_t>& writer::bytes() const {
+  return buf_;
+}
+
+/**
+ * @brief reads values written by a writer back out of a byte buffer. reading
+ * past the end of the buffer throws
+ */
+class reader {
+  private:
+    const std::vector<std::uint8_t>& buf_;
+    std::size_t pos_;
+    void require(std::size_t) const;
+  public:
+    explicit reader(const std::vector<std::uint8_t>&);
+    std::uint8_t get_u8();
+    std::uint64_t get_varint();
+    double get_f64();
+    std::string get_string();
+    std::size_t get_count();
+    bool at_end() const;
+};
+
+inline reader::reader(const std::vector<std::uint8_t>& buf)
+  : buf_(buf), pos_(0)
+{}
+
+inline void reader::require(std::size_t num_bytes) const {
+  if (buf_.size() - pos_ < num_bytes) {
+    std::cerr << "Error: truncated message" << std::endl;
+    throw "WireFormatException";
+  }
+}
+
+inline std::uint8_t reader::get_u8() {
+  require(1);
+  return buf_[pos_++];
+}
+
+inline std::uint64_t reader::get_varint() {
+  std::uint64_t val = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    std::uint8_t byte = get_u8();
+    val |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return val;
+    }
+  }
+  std::cerr << "Error: malformed varint" << std::endl;
+  throw "WireFormatException";
+}
+
+inline double reader::get_f64() {
+  require(8);
+  std::uint64_t bits = 0;
+  for (int i = 0; i < 8; i++) {
+    bits |= static_cast<std::uint64_t>(buf_[pos_++]) << (8 * i);
+  }
+  double val;
+  std::memcpy(&val, &bits, sizeof(val));
+  return val;
+}
+
+inline std::string reader::get_string() {
+  std::size_t size = get_count();
+  std::string str(buf_.begin() + pos_, buf_.begin() + pos_ + size);
+  pos_ += size;
+  return str;
+}
+
+/**
+ * @brief reads the length of a sequence. every element takes at least one
+ * byte, so a length longer than what's left of the buffer is rejected before
+ * anything is allocated for it
+ */
+inline std::size_t reader::get_count() {
+  std::uint64_t count = get_varint();
+  require(count);
+  return count;
+}
+
+inline bool reader::at_end() const {
+  return pos_ == buf_.size();
+}
+
+// MESSAGES
+
+struct hello_msg {
+  std::uint64_t worker_id = 0;
+};
+
+/**
+ * @brief asks a worker to simulate from its current node. in subtree mode
+ * the worker only simulates below the children whose index is congruent to
+ * partition modulo num_partitions. threshold is the reward a candidate must
+ * beat to enter the coordinator's top N
+ */
+struct round_msg {
+  std::uint64_t partition = 0;
+  std::uint64_t num_partitions = 1;
+  double threshold = 0;
+};
+
+/**
+ * @brief the statistics of one child of a worker's current node
+ */
+struct child_stats {
+  std::uint64_t n = 0;
+  double q = 0;
+  bool terminal = false;
+};
+
+/**
+ * @brief a candidate expression and its reward
+ */
+struct candidate {
+  std::string expr;
+  double reward = 0;
+};
+
+struct report_msg {
+  std::uint64_t num_explored = 0;
+  bool found_within_thresh = false;
+  bool game_over = false;
+  std::vector<child_stats> children;
+  std::vector<candidate> candidates;
+};
+
+struct move_msg {
+  std::uint64_t child = 0;
+  double threshold = 0;
+};
+
+inline void encode(writer& out, const hello_msg& msg) {
+  out.put_varint(msg.worker_id);
+}
+
+inline void decode(reader& in, hello_msg& msg) {
+  msg.worker_id = in.get_varint();
+}
+
+inline void encode(writer& out, const round_msg& msg) {
+  out.put_varint(msg.partition);
+  out.put_varint(msg.num_partitions);
+  out.put_f64(msg.threshold);
+}
+
+inline void decode(reader& in, round_msg& msg) {
+  msg.partition = in.get_varint();
+  msg.num_partitions = in.get_varint();
+  msg.threshold = in.get_f64();
+}
+
+inline void encode(writer& out, const report_msg& msg) {
+  out.put_varint(msg.num_explored);
+  out.put_u8(msg.found_within_thresh | (msg.game_over << 1));
+  out.put_varint(msg.children.size());
+  for (auto& child : msg.children) {
+    out.put_varint(child.n);
+    out.put_f64(child.q);
+    out.put_u8(child.terminal);
+  }
+  out.put_varint(msg.candidates.size());
+  for (auto& cand : msg.candidates) {
+    out.put_string(cand.expr);
+    out.put_f64(cand.reward);
+  }
+}
+
+inline void decode(reader& in, report_msg& msg) {
+  msg.num_explored = in.get_varint();
+  std::uint8_t flags = in.get_u8();
+  msg.found_within_thresh = flags & 1;
+  msg.game_over = flags & 2;
+  msg.children.resize(in.get_count());
+  for (auto& child : msg.children) {
+    child.n = in.get_varint();
+    child.q = in.get_f64();
+    child.terminal = in.get_u8();
+  }
+  msg.candidates.resize(in.get_count());
+  for (auto& cand : msg.candidates) {
+    cand.expr = in.get_string();
+    cand.reward = in.get_f64();
+  }
+}
+
+inline void encode(writer& out, const move_msg& msg) {
+  out.put_varint(msg.child);
+  out.put_f64(msg.threshold);
+}
+
+inline void decode(reader& in, move_msg& msg) {
+  msg.child = in.get_varint();
+  msg.threshold = in.get_f64();
+}
+
+}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "MCTS/MCTS.hpp"
+#include "distributed/socket.hpp"
+#include "distributed/wire.hpp"
+
+namespace symreg
+{
+namespace distributed
+{
+
+/**
+ * @brief runs the search work a coordinator hands out on a local MCTS
+ */
+template <class Regressor = symreg::DNN, class Policy = MCTS::dynamic_policy>
+class worker {
+  private:
+    MCTS::MCTS<Regressor, Policy>& mcts_;
+    connection conn_;
+    void report();
+  public:
+    worker(MCTS::MCTS<Regressor, Policy>&, const std::string&);
+    void run();
+};
+
+/**
+ * @brief worker constructor. connects to the coordinator and says hello
+ * @param mcts the search to run rounds on. it should be configured exactly
+ * like every other worker's, so that all of them agree on the actions
+ * available at each move
+ * @param address where the coordinator listens
+ */
+template <class Regressor, class Policy>
+worker<Regressor, Policy>::worker(MCTS::MCTS<Regressor, Policy>& mcts, const std::string& address)
+  : mcts_(mcts), conn_(connect(address))
+{
+  hello_msg hello;
+  hello.worker_id = ::getpid();
+  conn_.send(message_type::hello, hello);
+}
+
+/**
+ * @brief sends the statistics of the current move's children and the local
+ * top N to the coordinator
+ */
+template <class Regressor, class Policy>
+void worker<Regressor, Policy>::report() {
+  report_msg msg;
+  msg.num_explored = mcts_.get_num_explored();
+  msg.found_within_thresh = mcts_.got_reward_within_thresh();
+  msg.game_over = mcts_.game_over();
+  for (auto& child : mcts_.get_current_node().get_children()) {
+    child_stats stats;
+    stats.n = std::max(0, child.get_n());
+    stats.q = child.get_q();
+    stats.terminal = child.get_ast_node()->is_terminal();
+    msg.children.push_back(stats);
+  }
+  for (auto& scored : mcts_.get_scored_top_n_asts()) {
+    msg.candidates.push_back(candidate{scored.first->to_string(), scored.second});
+  }
+  conn_.send(message_type::report, msg);
+}
+
+/**
+ * @brief serves the coordinator until it says stop
+ *
+ * a round runs the local search's simulations for the current move and
+ * reports back; a move commits to the child the coordinator chose; stop
+ * finishes the game and sends one last report.
+ */
+template <class Regressor, class Policy>
+void worker<Regressor, Policy>::run() {
+  // workers are often forked from one parent, which would leave all of them
+  // with the same random sequence and hence the same tree
+  symreg::mt.seed(std::random_device{}());
+  std::vector<std::uint8_t> payload;
+  while (true) {
+    message_type type = conn_.receive(payload);
+    reader in(payload);
+    if (type == message_type::round) {
+      round_msg round;
+      decode(in, round);
+      mcts_.raise_admission_threshold(round.threshold);
+      if (!mcts_.game_over()) {
+        mcts_.simulate(round.partition, round.num_partitions);
+      }
+      report();
+    } else if (type == message_type::move) {
+      move_msg move;
+      decode(in, move);
+      mcts_.raise_admission_threshold(move.threshold);
+      if (!mcts_.make_move(static_cast<std::size_t>(move.child))) {
+        std::cerr << "Error: coordinator chose a move which doesn't exist" << std::endl;
+        throw "ProtocolException";
+      }
+    } else if (type == message_type::stop) {
+      mcts_.finish();
+      report();
+      return;
+    } else {
+      std::cerr << "Error: unexpected message from coordinator" << std::endl;
+      throw "ProtocolException";
+    }
+  }
+}
+
+}
+}
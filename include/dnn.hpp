@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <mutex>
 #include <numeric>
 #include "util.hpp"
 #include <dlib/dnn.h>
@@ -13,12 +14,15 @@ class DNN {
   private:
     int policy_dim_;
     std::mt19937 mt_;
+    std::mutex mtx_;
     std::vector<double> random_prob_dist(int);
     double random_prob();
   public:
     DNN(int);
     template <class State>
     std::pair<double, std::vector<double>> inference(State&&); 
+    template <class State>
+    std::vector<std::pair<double, std::vector<double>>> inference_batch(const std::vector<State>&);
     void train(training_examples&);
 };
 
@@ -43,13 +47,36 @@ double DNN::random_prob() {
   return util::get_random_int(0, 1000, mt_) / 1000; 
 }
 
+/**
+ * @brief infers the value and policy of a state. may be called by
+ * several searches at once
+ */
 template <class State>
 std::pair<double, std::vector<double>> DNN::inference(State&& state) {
+  std::lock_guard<std::mutex> lock(mtx_);
   // TODO: real inference
   return std::make_pair(random_prob(), random_prob_dist(policy_dim_));
 }
 
+/**
+ * @brief infers the value and policy of many states in one call
+ * @param states the states to evaluate
+ * @return one (value, policy) pair per state, in the order given
+ */
+template <class State>
+std::vector<std::pair<double, std::vector<double>>> DNN::inference_batch(const std::vector<State>& states) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::vector<std::pair<double, std::vector<double>>> results;
+  results.reserve(states.size());
+  for (std::size_t i = 0; i < states.size(); i++) {
+    // TODO: real inference
+    results.push_back(std::make_pair(random_prob(), random_prob_dist(policy_dim_)));
+  }
+  return results;
+}
+
 void DNN::train(training_examples& examples) {
+  std::lock_guard<std::mutex> lock(mtx_);
   // TODO: actually train
 }
 
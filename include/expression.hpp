@@ -0,0 +1,786 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "brick.hpp"
+#include "vector_math.hpp"
+
+namespace symreg
+{
+
+/**
+ * @brief the operations an expression is compiled to
+ */
+enum class opcode {
+  constant,
+  variable,
+  negate,
+  add,
+  sub,
+  mul,
+  div,
+  pow,
+  sin,
+  cos,
+  exp,
+  log,
+  sqrt,
+  literal,
+  powi,
+  store,
+  load
+};
+
+/**
+ * @brief the opcode of the function named name, e.g. "sin"
+ * @return whether there is one
+ */
+inline bool function_opcode(const std::string& name, opcode& op) {
+  if (name == "sin") {
+    op = opcode::sin;
+  } else if (name == "cos") {
+    op = opcode::cos;
+  } else if (name == "exp") {
+    op = opcode::exp;
+  } else if (name == "log") {
+    op = opcode::log;
+  } else if (name == "sqrt") {
+    op = opcode::sqrt;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline bool is_function(opcode op) {
+  return op == opcode::sin || op == opcode::cos || op == opcode::exp
+    || op == opcode::log || op == opcode::sqrt;
+}
+
+/**
+ * @brief protected semantics (see expression): divisors and logarithm
+ * arguments smaller than this in magnitude count as 0
+ */
+constexpr double protected_epsilon = 1e-12;
+
+/**
+ * @brief protected semantics: powers and exponentials are clamped to
+ * [-protected_limit, protected_limit]
+ */
+constexpr double protected_limit = 1e100;
+
+namespace detail
+{
+  inline double clamp_protected(double x) {
+    return std::min(std::max(x, -protected_limit), protected_limit);
+  }
+
+  inline bool is_odd_integer(double x) {
+    double half = .5 * x;
+    return x == std::floor(x) && half != std::floor(half);
+  }
+
+  /**
+   * @brief a^b of a protected pow, i.e. |a|^b with a's sign where b is an odd
+   * integer, so that it agrees with std::pow wherever that is defined
+   */
+  inline double signed_pow(double a, double b) {
+    double m = std::pow(std::abs(a), b);
+    return a < 0 && is_odd_integer(b) ? -m : m;
+  }
+}
+
+/**
+ * @brief applies a function opcode to n values in place
+ * @param protect whether to use protected semantics: exp is clamped,
+ * log and sqrt are taken of the magnitude, and log(0) is 0
+ */
+inline void apply_function(opcode op, double* x, std::size_t n, bool protect = false) {
+  if (protect && op == opcode::log) {
+    for (std::size_t i = 0; i < n; i++) {
+      double m = std::abs(x[i]);
+      x[i] = m < protected_epsilon ? 1 : m;
+    }
+  } else if (protect && op == opcode::sqrt) {
+    for (std::size_t i = 0; i < n; i++) {
+      x[i] = std::abs(x[i]);
+    }
+  }
+  switch (op) {
+    case opcode::sin: vmath::sin(x, x, n); break;
+    case opcode::cos: vmath::cos(x, x, n); break;
+    case opcode::exp: vmath::exp(x, x, n); break;
+    case opcode::log: vmath::log(x, x, n); break;
+    case opcode::sqrt: vmath::sqrt(x, x, n); break;
+    default: break;
+  }
+  if (protect && op == opcode::exp) {
+    for (std::size_t i = 0; i < n; i++) {
+      x[i] = std::min(x[i], protected_limit);
+    }
+  }
+}
+
+/**
+ * @brief applies a binary opcode to n pairs of values, a[i] = a[i] op b[i]
+ * @param protect whether to use protected semantics: dividing by 0 gives 1,
+ * and pow is signed_pow() clamped to protected_limit. a protected division
+ * overwrites b
+ */
+inline void apply_operator(opcode op, double* a, double* b, std::size_t n, bool protect = false) {
+  switch (op) {
+    case opcode::add: for (std::size_t i = 0; i < n; i++) a[i] += b[i]; break;
+    case opcode::sub: for (std::size_t i = 0; i < n; i++) a[i] -= b[i]; break;
+    case opcode::mul: for (std::size_t i = 0; i < n; i++) a[i] *= b[i]; break;
+    case opcode::div:
+      if (!protect) {
+        for (std::size_t i = 0; i < n; i++) a[i] /= b[i];
+        break;
+      }
+      // 0 divisors make the pair 1/1. selecting after the division instead
+      // would let the compiler branch around it, as divisions may trap
+      for (std::size_t i = 0; i < n; i++) {
+        bool zero = std::abs(b[i]) < protected_epsilon;
+        a[i] = zero ? 1 : a[i];
+        b[i] = zero ? 1 : b[i];
+      }
+      for (std::size_t i = 0; i < n; i++) a[i] /= b[i];
+      break;
+    case opcode::pow:
+      if (!protect) {
+        for (std::size_t i = 0; i < n; i++) a[i] = std::pow(a[i], b[i]);
+        break;
+      }
+      for (std::size_t i = 0; i < n; i++) {
+        a[i] = detail::clamp_protected(detail::signed_pow(a[i], b[i]));
+      }
+      break;
+    default: break;
+  }
+}
+
+/**
+ * @brief raises n values to an integral power in place, with a chain of
+ * multiplications by repeated squaring instead of pow
+ * @param scratch n values of scratch space
+ * @param exponent the power, an integer
+ * @param protect whether to clamp to protected_limit, like a protected pow
+ */
+inline void apply_powi(double* a, double* scratch, double exponent, std::size_t n, bool protect = false) {
+  auto e = static_cast<unsigned long>(std::abs(exponent));
+  if (e == 2) {
+    for (std::size_t i = 0; i < n; i++) a[i] *= a[i];
+  } else if (e == 3) {
+    for (std::size_t i = 0; i < n; i++) a[i] *= a[i] * a[i];
+  } else {
+    std::copy(a, a + n, scratch);
+    std::fill(a, a + n, 1.0);
+    while (e) {
+      if (e & 1) {
+        for (std::size_t i = 0; i < n; i++) a[i] *= scratch[i];
+      }
+      e >>= 1;
+      if (e) {
+        for (std::size_t i = 0; i < n; i++) scratch[i] *= scratch[i];
+      }
+    }
+  }
+  if (exponent < 0) {
+    for (std::size_t i = 0; i < n; i++) a[i] = 1 / a[i];
+  }
+  if (protect) {
+    for (std::size_t i = 0; i < n; i++) a[i] = detail::clamp_protected(a[i]);
+  }
+}
+
+/**
+ * @brief one step of a compiled expression. arg is the index of a constant
+ * among the expression's parameters, of a literal (or of the literal
+ * exponent of powi) or of a stored column
+ */
+struct instruction {
+  opcode op;
+  std::size_t arg;
+};
+
+/**
+ * @brief an expression's values at a column of points and their partial
+ * derivatives there. d_params holds one column per parameter, and is empty
+ * unless asked for
+ */
+struct dual_columns {
+  std::vector<double> value;
+  std::vector<double> d_x;
+  std::vector<std::vector<double>> d_params;
+};
+
+/**
+ * @brief a complete AST compiled to a flat stack program
+ *
+ * Instructions are in postfix order, so evaluation is a single pass without
+ * recursion or virtual calls. Every number in the AST becomes a parameter,
+ * in the order the numbers are met walking the AST depth first, which can be
+ * read and changed without recompiling, e.g. to fit constants to a dataset.
+ * Posits compile to nothing. eval_dual() gives exact derivatives in forward
+ * mode. Functions are evaluated with the kernels of vmath.
+ *
+ * optimize() has eval() run a simplified copy of the program, rebuilt
+ * whenever the parameters change: constant-only subtrees are folded into
+ * literals, powers with small integral exponents become multiplication
+ * chains (see apply_powi()) and a power of x that occurs more than once is
+ * computed once. eval_dual() and the parameters keep seeing every number.
+ *
+ * An expression compiled with protected semantics can't divide by 0 or
+ * overflow in pow or exp (see apply_operator() and apply_function()), so
+ * its predictions only turn infinite or NaN when products or sums
+ * overflow. The guards are selects rather than branches, so the loops over
+ * a column stay vectorizable.
+ */
+class expression {
+  private:
+    using AST = brick::AST::AST;
+    std::vector<instruction> code_;
+    std::vector<double> params_;
+    std::vector<instruction> optimized_;
+    std::vector<double> literals_;
+    std::size_t num_stored_ = 0;
+    bool is_optimized_ = false;
+    std::size_t stack_size_;
+    bool protected_;
+    std::size_t compile(AST&);
+    void reduce();
+    void share_powers();
+    std::shared_ptr<AST> substitute(AST&, std::size_t&) const;
+  public:
+    explicit expression(AST&, bool = false);
+    std::size_t num_params() const;
+    bool is_protected() const;
+    const std::vector<double>& get_params() const;
+    void set_params(const std::vector<double>&);
+    void optimize();
+    bool is_optimized() const;
+    const std::vector<instruction>& get_program() const;
+    double eval(double) const;
+    void eval(const std::vector<double>&, std::vector<double>&) const;
+    dual_columns eval_dual(const std::vector<double>&, bool = true) const;
+    std::shared_ptr<AST> to_ast(AST&) const;
+};
+
+/**
+ * @brief compiles a complete AST. throws "UnsupportedNodeException" on
+ * nodes which have no instruction
+ * @param ast the AST
+ * @param protected_ops whether to evaluate with protected semantics
+ */
+inline expression::expression(AST& ast, bool protected_ops)
+  : stack_size_(compile(ast)),
+    protected_(protected_ops)
+{}
+
+/**
+ * @brief appends the instructions of an AST to the program
+ * @return the stack depth evaluating the AST needs
+ */
+inline std::size_t expression::compile(AST& ast) {
+  auto& node = *ast.get_node();
+  auto& children = ast.get_children();
+  opcode op;
+  std::size_t depth = 0;
+  for (std::size_t i = 0; i < children.size(); i++) {
+    depth = std::max(depth, i + compile(*children[i]));
+  }
+  if (node.is_number()) {
+    code_.push_back({opcode::constant, params_.size()});
+    params_.push_back(std::stod(node.to_string()));
+    return 1;
+  } else if (node.is_id()) {
+    code_.push_back({opcode::variable, 0});
+    return 1;
+  } else if (node.is_posit()) {
+    return depth;
+  } else if (node.is_negate()) {
+    code_.push_back({opcode::negate, 0});
+  } else if (node.is_addition()) {
+    code_.push_back({opcode::add, 0});
+  } else if (node.is_subtraction()) {
+    code_.push_back({opcode::sub, 0});
+  } else if (node.is_multiplication()) {
+    code_.push_back({opcode::mul, 0});
+  } else if (node.is_division()) {
+    code_.push_back({opcode::div, 0});
+  } else if (node.is_exponentiation()) {
+    code_.push_back({opcode::pow, 0});
+  } else if (node.num_children() == 1 && function_opcode(node.to_string(), op)) {
+    code_.push_back({op, 0});
+  } else {
+    std::cerr << "Error: can't compile [" << node.to_string() << "] nodes" << std::endl;
+    throw "UnsupportedNodeException";
+  }
+  return depth;
+}
+
+inline std::size_t expression::num_params() const {
+  return params_.size();
+}
+
+inline bool expression::is_protected() const {
+  return protected_;
+}
+
+inline const std::vector<double>& expression::get_params() const {
+  return params_;
+}
+
+/**
+ * @brief replaces the values of the expression's constants
+ * @param params one value per constant, see num_params()
+ */
+inline void expression::set_params(const std::vector<double>& params) {
+  params_ = params;
+  if (is_optimized_) {
+    reduce();
+  }
+}
+
+/**
+ * @brief simplifies the program eval() runs, see expression
+ */
+inline void expression::optimize() {
+  is_optimized_ = true;
+  reduce();
+}
+
+inline bool expression::is_optimized() const {
+  return is_optimized_;
+}
+
+/**
+ * @brief the instructions eval() runs
+ */
+inline const std::vector<instruction>& expression::get_program() const {
+  return is_optimized_ ? optimized_ : code_;
+}
+
+/**
+ * @brief the largest exponent pows are strength reduced for
+ */
+constexpr double max_reduced_power = 64;
+
+/**
+ * @brief builds the optimized program from the parameterized one. each
+ * instruction's operands are tracked on a stack, which knows the value of
+ * constant ones and where in the program they start, so that folding a
+ * subtree truncates the program there and appends a single literal
+ */
+inline void expression::reduce() {
+  struct operand {
+    std::size_t begin;
+    bool constant;
+    double value;
+  };
+  std::vector<operand> stack;
+  optimized_.clear();
+  literals_.clear();
+  auto push_literal = [&](std::size_t begin, double value) {
+    optimized_.resize(begin);
+    optimized_.push_back({opcode::literal, literals_.size()});
+    literals_.push_back(value);
+    stack.push_back({begin, true, value});
+  };
+  for (auto& ins : code_) {
+    if (ins.op == opcode::constant) {
+      push_literal(optimized_.size(), params_[ins.arg]);
+      continue;
+    }
+    if (ins.op == opcode::variable) {
+      stack.push_back({optimized_.size(), false, 0});
+      optimized_.push_back(ins);
+      continue;
+    }
+    if (ins.op == opcode::negate || is_function(ins.op)) {
+      auto a = stack.back();
+      if (!a.constant) {
+        optimized_.push_back(ins);
+        continue;
+      }
+      stack.pop_back();
+      double value = -a.value;
+      if (ins.op != opcode::negate) {
+        value = a.value;
+        apply_function(ins.op, &value, 1, protected_);
+      }
+      push_literal(a.begin, value);
+      continue;
+    }
+    auto b = stack.back();
+    stack.pop_back();
+    auto a = stack.back();
+    stack.pop_back();
+    if (a.constant && b.constant) {
+      double value = a.value;
+      apply_operator(ins.op, &value, &b.value, 1, protected_);
+      push_literal(a.begin, value);
+      continue;
+    }
+    if (ins.op == opcode::pow && b.constant && b.value == std::floor(b.value)
+        && std::abs(b.value) <= max_reduced_power) {
+      // the exponent's literal becomes powi's operand
+      optimized_.back().op = opcode::powi;
+    } else {
+      optimized_.push_back(ins);
+    }
+    stack.push_back({a.begin, false, 0});
+  }
+  share_powers();
+}
+
+/**
+ * @brief stores the first of several equal powers of x and loads it in
+ * place of the others
+ */
+inline void expression::share_powers() {
+  auto power_at = [&](std::size_t i) {
+    return i + 1 < optimized_.size() && optimized_[i].op == opcode::variable
+      && optimized_[i + 1].op == opcode::powi;
+  };
+  std::vector<double> powers;
+  std::vector<std::size_t> counts;
+  for (std::size_t i = 0; i < optimized_.size(); i++) {
+    if (!power_at(i)) {
+      continue;
+    }
+    double power = literals_[optimized_[i + 1].arg];
+    auto it = std::find(powers.begin(), powers.end(), power);
+    if (it == powers.end()) {
+      powers.push_back(power);
+      counts.push_back(1);
+    } else {
+      counts[it - powers.begin()]++;
+    }
+  }
+  num_stored_ = 0;
+  std::vector<std::size_t> slots(powers.size());
+  std::vector<bool> stored(powers.size(), false);
+  for (std::size_t j = 0; j < powers.size(); j++) {
+    slots[j] = counts[j] > 1 ? num_stored_++ : 0;
+  }
+  if (!num_stored_) {
+    return;
+  }
+  std::vector<instruction> shared;
+  for (std::size_t i = 0; i < optimized_.size(); i++) {
+    if (!power_at(i)) {
+      shared.push_back(optimized_[i]);
+      continue;
+    }
+    std::size_t j = std::find(powers.begin(), powers.end(), literals_[optimized_[i + 1].arg]) - powers.begin();
+    if (counts[j] < 2) {
+      shared.push_back(optimized_[i]);
+    } else if (!stored[j]) {
+      shared.push_back(optimized_[i]);
+      shared.push_back(optimized_[i + 1]);
+      shared.push_back({opcode::store, slots[j]});
+      stored[j] = true;
+      i++;
+    } else {
+      shared.push_back({opcode::load, slots[j]});
+      i++;
+    }
+  }
+  optimized_ = std::move(shared);
+}
+
+/**
+ * @brief evaluates the expression at one point, the same way as a column
+ */
+inline double expression::eval(double x) const {
+  std::vector<double> y_hat;
+  eval(std::vector<double>{x}, y_hat);
+  return y_hat[0];
+}
+
+/**
+ * @brief evaluates the expression at every point of x. each instruction is
+ * applied to a whole column of points at a time
+ * @param x the points
+ * @param y_hat filled with the expression's value at each point
+ */
+inline void expression::eval(const std::vector<double>& x, std::vector<double>& y_hat) const {
+  std::size_t n = x.size();
+  std::vector<std::vector<double>> stack(stack_size_, std::vector<double>(n));
+  std::vector<std::vector<double>> stored(num_stored_);
+  std::vector<double> scratch;
+  std::size_t top = 0;
+  for (auto& ins : get_program()) {
+    if (ins.op == opcode::constant || ins.op == opcode::literal) {
+      double value = ins.op == opcode::constant ? params_[ins.arg] : literals_[ins.arg];
+      std::fill(stack[top].begin(), stack[top].end(), value);
+      top++;
+      continue;
+    }
+    if (ins.op == opcode::variable) {
+      stack[top++] = x;
+      continue;
+    }
+    if (ins.op == opcode::store) {
+      stored[ins.arg] = stack[top - 1];
+      continue;
+    }
+    if (ins.op == opcode::load) {
+      stack[top++] = stored[ins.arg];
+      continue;
+    }
+    if (ins.op == opcode::powi) {
+      scratch.resize(n);
+      apply_powi(stack[top - 1].data(), scratch.data(), literals_[ins.arg], n, protected_);
+      continue;
+    }
+    if (ins.op == opcode::negate) {
+      auto& a = stack[top - 1];
+      for (std::size_t i = 0; i < n; i++) {
+        a[i] = -a[i];
+      }
+      continue;
+    }
+    if (is_function(ins.op)) {
+      apply_function(ins.op, stack[top - 1].data(), n, protected_);
+      continue;
+    }
+    top--;
+    apply_operator(ins.op, stack[top - 1].data(), stack[top].data(), n, protected_);
+  }
+  y_hat = std::move(stack[0]);
+}
+
+/**
+ * @brief evaluates the expression at every point of x in dual numbers, i.e.
+ * along with its exact partial derivatives with respect to x and, if
+ * wanted, to each parameter. like eval(), each instruction is applied to
+ * whole columns: every stack slot holds a column of values and one column
+ * of tangents per variable, so all derivatives cost about one more pass
+ * each, without a second evaluation or finite differences. the derivative
+ * of a^b with respect to b is taken as 0 where a isn't positive (where a is
+ * 0, with protected semantics). values protected semantics replace by a
+ * constant have derivatives 0. the parameterized program is evaluated, even
+ * if the expression is optimized
+ * @param x the points
+ * @param wrt_params whether to differentiate with respect to the parameters
+ */
+inline dual_columns expression::eval_dual(const std::vector<double>& x, bool wrt_params) const {
+  std::size_t n = x.size();
+  std::size_t num_tangents = 1 + (wrt_params ? params_.size() : 0);
+  // per slot: the values, then d/dx, then d/dparam for each parameter
+  std::vector<std::vector<std::vector<double>>> stack(stack_size_,
+    std::vector<std::vector<double>>(1 + num_tangents, std::vector<double>(n)));
+  std::vector<double> wa(n);
+  std::vector<double> wb(n);
+  std::size_t top = 0;
+  for (auto& ins : code_) {
+    if (ins.op == opcode::constant || ins.op == opcode::variable) {
+      auto& out = stack[top++];
+      for (std::size_t k = 0; k <= num_tangents; k++) {
+        double fill = 0;
+        if (k == 0) {
+          fill = ins.op == opcode::constant ? params_[ins.arg] : 0;
+        } else if (k == 1) {
+          fill = ins.op == opcode::variable;
+        } else {
+          fill = ins.op == opcode::constant && k - 2 == ins.arg;
+        }
+        std::fill(out[k].begin(), out[k].end(), fill);
+      }
+      if (ins.op == opcode::variable) {
+        out[0] = x;
+      }
+      continue;
+    }
+    if (ins.op == opcode::negate) {
+      for (auto& column : stack[top - 1]) {
+        for (std::size_t i = 0; i < n; i++) {
+          column[i] = -column[i];
+        }
+      }
+      continue;
+    }
+    if (is_function(ins.op)) {
+      auto& a = stack[top - 1];
+      auto& va = a[0];
+      // d f(a) = wa * da
+      switch (ins.op) {
+        case opcode::sin:
+          vmath::cos(va.data(), wa.data(), n);
+          vmath::sin(va.data(), va.data(), n);
+          break;
+        case opcode::cos:
+          vmath::sin(va.data(), wa.data(), n);
+          for (std::size_t i = 0; i < n; i++) {
+            wa[i] = -wa[i];
+          }
+          vmath::cos(va.data(), va.data(), n);
+          break;
+        case opcode::exp:
+          apply_function(ins.op, va.data(), n, protected_);
+          for (std::size_t i = 0; i < n; i++) {
+            wa[i] = va[i] < protected_limit || !protected_ ? va[i] : 0;
+          }
+          break;
+        case opcode::log:
+          // d log|a| = da / a, too
+          for (std::size_t i = 0; i < n; i++) {
+            double m = protected_ && std::abs(va[i]) < protected_epsilon ? 0 : 1;
+            wa[i] = m / (va[i] + (1 - m));
+          }
+          apply_function(ins.op, va.data(), n, protected_);
+          break;
+        case opcode::sqrt:
+          for (std::size_t i = 0; i < n; i++) {
+            wb[i] = protected_ && va[i] < 0 ? -.5 : .5;
+          }
+          apply_function(ins.op, va.data(), n, protected_);
+          for (std::size_t i = 0; i < n; i++) {
+            wa[i] = wb[i] / va[i];
+          }
+          break;
+        default: break;
+      }
+      for (std::size_t k = 1; k <= num_tangents; k++) {
+        auto& da = a[k];
+        for (std::size_t i = 0; i < n; i++) {
+          double ua = da[i] != 0 ? wa[i] : 0;
+          da[i] = ua * da[i];
+        }
+      }
+      continue;
+    }
+    top--;
+    auto& a = stack[top - 1];
+    auto& b = stack[top];
+    auto& va = a[0];
+    auto& vb = b[0];
+    // d(a op b) = wa * da + wb * db
+    switch (ins.op) {
+      case opcode::add:
+        for (std::size_t i = 0; i < n; i++) {
+          wa[i] = 1;
+          wb[i] = 1;
+          va[i] += vb[i];
+        }
+        break;
+      case opcode::sub:
+        for (std::size_t i = 0; i < n; i++) {
+          wa[i] = 1;
+          wb[i] = -1;
+          va[i] -= vb[i];
+        }
+        break;
+      case opcode::mul:
+        for (std::size_t i = 0; i < n; i++) {
+          wa[i] = vb[i];
+          wb[i] = va[i];
+          va[i] *= vb[i];
+        }
+        break;
+      case opcode::div:
+        if (protected_) {
+          // a divisor of 0 gives a constant 1, see apply_operator(). wa
+          // holds the mask in between
+          for (std::size_t i = 0; i < n; i++) {
+            bool zero = std::abs(vb[i]) < protected_epsilon;
+            wa[i] = zero ? 0 : 1;
+            va[i] = zero ? 1 : va[i];
+            vb[i] = zero ? 1 : vb[i];
+          }
+          for (std::size_t i = 0; i < n; i++) {
+            double q = va[i] / vb[i];
+            wb[i] = -q / vb[i] * wa[i];
+            wa[i] /= vb[i];
+            va[i] = q;
+          }
+          break;
+        }
+        for (std::size_t i = 0; i < n; i++) {
+          wa[i] = 1 / vb[i];
+          wb[i] = -va[i] / (vb[i] * vb[i]);
+          va[i] /= vb[i];
+        }
+        break;
+      case opcode::pow:
+        if (protected_) {
+          // d|a|^b/da = -b|a|^(b-1) for negative a, unless |a|^b takes a's sign.
+          // clamped powers are constant
+          for (std::size_t i = 0; i < n; i++) {
+            double value = detail::signed_pow(va[i], vb[i]);
+            double sign = va[i] < 0 && !detail::is_odd_integer(vb[i]) ? -1 : 1;
+            double d_a = sign * vb[i] * std::pow(std::abs(va[i]), vb[i] - 1);
+            double d_b = value * std::log(std::abs(va[i]));
+            bool clamped = !(std::abs(value) <= protected_limit);
+            wa[i] = clamped ? 0 : d_a;
+            wb[i] = clamped || va[i] == 0 ? 0 : d_b;
+            va[i] = detail::clamp_protected(value);
+          }
+          break;
+        }
+        for (std::size_t i = 0; i < n; i++) {
+          double value = std::pow(va[i], vb[i]);
+          wa[i] = vb[i] * std::pow(va[i], vb[i] - 1);
+          wb[i] = va[i] > 0 ? value * std::log(va[i]) : 0;
+          va[i] = value;
+        }
+        break;
+      default: break;
+    }
+    // variables an operand doesn't depend on mustn't pick up infinite
+    // weights. the weights are masked rather than the products, so that the
+    // loop has no branches
+    for (std::size_t k = 1; k <= num_tangents; k++) {
+      auto& da = a[k];
+      auto& db = b[k];
+      for (std::size_t i = 0; i < n; i++) {
+        double ua = da[i] != 0 ? wa[i] : 0;
+        double ub = db[i] != 0 ? wb[i] : 0;
+        da[i] = ua * da[i] + ub * db[i];
+      }
+    }
+  }
+  dual_columns out;
+  auto& result = stack[0];
+  out.value = std::move(result[0]);
+  out.d_x = std::move(result[1]);
+  for (std::size_t k = 2; k <= num_tangents; k++) {
+    out.d_params.push_back(std::move(result[k]));
+  }
+  return out;
+}
+
+/**
+ * @brief copies the AST the expression was compiled from, with its numbers
+ * replaced by the expression's parameters
+ * @param ast the AST the expression was compiled from
+ */
+inline std::shared_ptr<brick::AST::AST> expression::to_ast(AST& ast) const {
+  std::size_t next = 0;
+  return substitute(ast, next);
+}
+
+inline std::shared_ptr<brick::AST::AST> expression::substitute(AST& ast, std::size_t& next) const {
+  auto& node = *ast.get_node();
+  std::unique_ptr<brick::AST::node> copy;
+  if (node.is_number()) {
+    copy = std::make_unique<brick::AST::number_node>(params_[next++]);
+  } else {
+    copy = std::unique_ptr<brick::AST::node>(node.clone());
+  }
+  auto out = std::make_shared<AST>(std::move(copy));
+  for (auto& child : ast.get_children()) {
+    out->add_child(substitute(*child, next));
+  }
+  return out;
+}
+
+}
@@ -23,6 +23,13 @@ class fixed_priority_queue {
     fixed_priority_queue(Cmp, Sign, int); 
     void push(T); 
     std::vector<T> dump();
+    std::vector<T> snapshot() const;
+    const T& top() const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+    bool full() const;
+    bool empty() const;
+    void clear();
 };
 
 /**
@@ -75,7 +82,77 @@ std::vector<T> fixed_priority_queue<T, Cmp, Sign>::dump() {
     priq_.pop();
     i++;
   }
+  signs_.clear();
   return vec;
 }
 
+/**
+ * @brief converts a copy of the queue into an array, leaving the
+ * queue itself untouched
+ * @return the elements of the queue ordered as dump() would order them
+ */
+template <class T, class Cmp, class Sign>
+std::vector<T> fixed_priority_queue<T, Cmp, Sign>::snapshot() const {
+  auto copy = priq_;
+  std::vector<T> vec;
+  vec.reserve(copy.size());
+  while (!copy.empty()) {
+    vec.push_back(copy.top());
+    copy.pop();
+  }
+  return vec;
+}
+
+/**
+ * @brief a getter for the element which would be evicted next, i.e.
+ * the worst element currently held according to Cmp
+ * @return a const reference to the top of the underlying heap
+ */
+template <class T, class Cmp, class Sign>
+const T& fixed_priority_queue<T, Cmp, Sign>::top() const {
+  return priq_.top();
+}
+
+/**
+ * @brief a getter for the number of elements currently held
+ */
+template <class T, class Cmp, class Sign>
+std::size_t fixed_priority_queue<T, Cmp, Sign>::size() const {
+  return priq_.size();
+}
+
+/**
+ * @brief a getter for N, the maximum number of elements held
+ */
+template <class T, class Cmp, class Sign>
+std::size_t fixed_priority_queue<T, Cmp, Sign>::capacity() const {
+  return N_;
+}
+
+/**
+ * @brief tells whether the queue holds N elements, in which case
+ * pushes must beat top() to be admitted
+ */
+template <class T, class Cmp, class Sign>
+bool fixed_priority_queue<T, Cmp, Sign>::full() const {
+  return priq_.size() >= N_;
+}
+
+template <class T, class Cmp, class Sign>
+bool fixed_priority_queue<T, Cmp, Sign>::empty() const {
+  return priq_.empty();
+}
+
+/**
+ * @brief removes all elements (and their signatures) from the queue
+ */
+template <class T, class Cmp, class Sign>
+void fixed_priority_queue<T, Cmp, Sign>::clear() {
+  // comparators are often lambdas, which aren't copy assignable
+  while (!priq_.empty()) {
+    priq_.pop();
+  }
+  signs_.clear();
+}
+
 }
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace symreg
+{
+
+/**
+ * @brief collects regressor inference requests from any number of
+ * simulations and evaluates them in batches
+ *
+ * Requests are queued by submit(). A dispatcher thread hands the regressor
+ * a batch via Regressor::inference_batch as soon as batch_size requests are
+ * pending, or once the oldest pending request has waited timeout, or when
+ * flush() is called. Each result is routed back through the future which
+ * submit() returned, or through the callback given to submit().
+ */
+template <class Regressor, class State = std::string>
+class inference_broker {
+  public:
+    using result_type = std::pair<double, std::vector<double>>;
+    using callback_type = std::function<void(std::exception_ptr, result_type)>;
+  private:
+    using clock = std::chrono::steady_clock;
+    struct request {
+      State state;
+      callback_type done;
+    };
+    Regressor* regr_;
+    std::size_t batch_size_;
+    std::chrono::microseconds timeout_;
+    std::vector<request> pending_;
+    clock::time_point oldest_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool flushing_;
+    bool stopping_;
+    std::size_t num_batches_;
+    std::size_t num_requests_;
+    std::thread dispatcher_;
+    void dispatch();
+    void run_batch(std::vector<request>&);
+  public:
+    inference_broker(Regressor*, std::size_t, std::chrono::microseconds);
+    inference_broker(const inference_broker&) = delete;
+    inference_broker& operator=(const inference_broker&) = delete;
+    ~inference_broker();
+    std::future<result_type> submit(State);
+    void submit(State, callback_type);
+    void flush();
+    std::size_t get_batch_size() const;
+    std::size_t get_num_batches();
+    std::size_t get_num_requests();
+};
+
+/**
+ * @brief inference broker constructor. starts the dispatcher thread
+ * @param regr the regressor which evaluates batches
+ * @param batch_size the number of pending requests which triggers a batch
+ * @param timeout the longest a request waits for its batch to fill up
+ */
+template <class Regressor, class State>
+inference_broker<Regressor, State>::inference_broker(Regressor* regr,
+    std::size_t batch_size, std::chrono::microseconds timeout)
+  : regr_(regr),
+    batch_size_(std::max<std::size_t>(1, batch_size)),
+    timeout_(timeout),
+    flushing_(false),
+    stopping_(false),
+    num_batches_(0),
+    num_requests_(0),
+    dispatcher_([this] { dispatch(); })
+{}
+
+/**
+ * @brief inference broker destructor. pending requests are still evaluated
+ * before the dispatcher is joined
+ */
+template <class Regressor, class State>
+inference_broker<Regressor, State>::~inference_broker() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  dispatcher_.join();
+}
+
+/**
+ * @brief the dispatcher loop: waits for a full batch, a timeout, a flush or
+ * shutdown and then evaluates up to batch_size_ pending requests
+ */
+template <class Regressor, class State>
+void inference_broker<Regressor, State>::dispatch() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+    cv_.wait_until(lock, oldest_ + timeout_, [this] {
+      return stopping_ || flushing_ || pending_.size() >= batch_size_;
+    });
+    std::size_t n = std::min(batch_size_, pending_.size());
+    std::vector<request> batch;
+    batch.reserve(n);
+    std::move(pending_.begin(), pending_.begin() + n, std::back_inserter(batch));
+    pending_.erase(pending_.begin(), pending_.begin() + n);
+    oldest_ = clock::now();
+    if (pending_.empty()) {
+      flushing_ = false;
+    }
+    lock.unlock();
+    run_batch(batch);
+    lock.lock();
+  }
+}
+
+/**
+ * @brief evaluates a batch and fulfils the promises of its requests
+ * @param batch the requests to evaluate
+ */
+template <class Regressor, class State>
+void inference_broker<Regressor, State>::run_batch(std::vector<request>& batch) {
+  std::vector<State> states;
+  states.reserve(batch.size());
+  for (auto& req : batch) {
+    states.push_back(std::move(req.state));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    num_batches_++;
+    num_requests_ += batch.size();
+  }
+  std::vector<result_type> results;
+  std::exception_ptr error = nullptr;
+  try {
+    results = regr_->inference_batch(states);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    batch[i].done(error, error ? result_type() : std::move(results[i]));
+  }
+}
+
+/**
+ * @brief queues a state for evaluation
+ * @param state the state to evaluate
+ * @return a future which becomes ready once the state's batch is evaluated
+ */
+template <class Regressor, class State>
+std::future<typename inference_broker<Regressor, State>::result_type>
+inference_broker<Regressor, State>::submit(State state) {
+  auto promise = std::make_shared<std::promise<result_type>>();
+  auto fut = promise->get_future();
+  submit(std::move(state), [promise](std::exception_ptr error, result_type result) {
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value(std::move(result));
+    }
+  });
+  return fut;
+}
+
+/**
+ * @brief queues a state for evaluation without blocking anyone on a future
+ * @param state the state to evaluate
+ * @param done called on the dispatcher thread with the state's result, or
+ * with the exception thrown while evaluating its batch
+ */
+template <class Regressor, class State>
+void inference_broker<Regressor, State>::submit(State state, callback_type done) {
+  bool notify;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (pending_.empty()) {
+      oldest_ = clock::now();
+    }
+    pending_.push_back(request{std::move(state), std::move(done)});
+    notify = pending_.size() == 1 || pending_.size() >= batch_size_;
+  }
+  if (notify) {
+    cv_.notify_all();
+  }
+}
+
+/**
+ * @brief asks the dispatcher to evaluate everything pending right away
+ * rather than waiting for a full batch. useful when the caller knows no
+ * more requests are coming, e.g. at the end of a wave of simulations
+ */
+template <class Regressor, class State>
+void inference_broker<Regressor, State>::flush() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (pending_.empty()) {
+      return;
+    }
+    flushing_ = true;
+  }
+  cv_.notify_all();
+}
+
+template <class Regressor, class State>
+std::size_t inference_broker<Regressor, State>::get_batch_size() const {
+  return batch_size_;
+}
+
+/**
+ * @brief a getter for the number of inference_batch calls made so far
+ */
+template <class Regressor, class State>
+std::size_t inference_broker<Regressor, State>::get_num_batches() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return num_batches_;
+}
+
+/**
+ * @brief a getter for the number of requests evaluated so far
+ */
+template <class Regressor, class State>
+std::size_t inference_broker<Regressor, State>::get_num_requests() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return num_requests_;
+}
+
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <limits>
 
+#include "expression.hpp"
+#include "thread_pool.hpp"
+#include "util.hpp"
+
 namespace symreg
 {
 namespace loss_fn
@@ -9,14 +14,50 @@ namespace loss_fn
 
 using ast_ptr = std::shared_ptr<brick::AST::AST>;
 
+/**
+ * @brief the pool chunked loss evaluations run on, unless a loss is given
+ * one of its own. it's only created once a large dataset is evaluated
+ */
+thread_pool& evaluation_pool() {
+  static thread_pool pool;
+  return pool;
+}
+
 /**
  * @brief a loss function interface. determines the
  * goodness of fit of an AST to a dataset
+ *
+ * datasets with at least parallel_threshold_ points are evaluated in chunks
+ * of chunk_size_ points on a thread pool. each loss reduces every chunk to
+ * the partial sums (or minima, maxima) it needs and then combines those in
+ * chunk order, so the result doesn't depend on the number of threads.
+ *
+ * A loss can hand the predictions it computed back to the caller, which
+ * saves evaluating the AST again, e.g. to key it in a semantic cache.
+ *
+ * ASTs may be evaluated with protected semantics (see expression). Either
+ * way, predictions are checked for infinities and NaNs in one pass before
+ * they're reduced, and a loss with any gets its maximum right away.
  */
 class loss_fn {
+  protected:
+    std::size_t parallel_threshold_ = 1 << 17;
+    std::size_t chunk_size_ = 1 << 14;
+    thread_pool* pool_ = nullptr;
+    bool protected_ops_ = false;
+    bool use_chunks(const dataset&) const;
+    template <class F>
+    auto evaluate_chunks(const dataset&, F);
+    expression compile(ast_ptr&) const;
+    static std::vector<double> predict(const expression&, const dataset&, std::size_t, std::size_t,
+      std::vector<double>* = nullptr);
+    static bool all_finite(const std::vector<double>&);
   public:
     void limit_loss(double&, const double&);
-    virtual double loss(dataset& ds, ast_ptr& ast) = 0;
+    virtual void set_chunked_eval(std::size_t, std::size_t, thread_pool* = nullptr);
+    virtual void set_protected_ops(bool);
+    bool get_protected_ops() const;
+    virtual double loss(dataset& ds, ast_ptr& ast, std::vector<double>* predictions = nullptr) = 0;
 };
 
 void loss_fn::limit_loss(double& loss, const double& max_loss) {
@@ -25,16 +66,104 @@ void loss_fn::limit_loss(double& loss, const double& max_loss) {
   }
 }
 
+/**
+ * @brief configures chunked evaluation
+ * @param threshold the dataset size from which on datasets are evaluated in
+ * chunks. 0 disables chunked evaluation
+ * @param chunk_size the number of points per chunk
+ * @param pool the pool to evaluate on. nullptr means evaluation_pool()
+ */
+void loss_fn::set_chunked_eval(std::size_t threshold, std::size_t chunk_size, thread_pool* pool) {
+  parallel_threshold_ = threshold;
+  chunk_size_ = std::max<std::size_t>(1, chunk_size);
+  pool_ = pool;
+}
+
+/**
+ * @brief whether ASTs are evaluated with protected semantics
+ */
+void loss_fn::set_protected_ops(bool protected_ops) {
+  protected_ops_ = protected_ops;
+}
+
+bool loss_fn::get_protected_ops() const {
+  return protected_ops_;
+}
+
+bool loss_fn::use_chunks(const dataset& ds) const {
+  return parallel_threshold_ && ds.x.size() >= parallel_threshold_;
+}
+
+/**
+ * @brief maps f(begin, end) over the chunks of ds
+ * @return f's result for each chunk, in chunk order
+ */
+template <class F>
+auto loss_fn::evaluate_chunks(const dataset& ds, F f) {
+  return map_chunks(pool_ ? *pool_ : evaluation_pool(), ds.x.size(), chunk_size_, f);
+}
+
+/**
+ * @brief compiles an AST with the loss's semantics, optimized since only
+ * its predictions are needed
+ */
+expression loss_fn::compile(ast_ptr& ast) const {
+  expression expr(*ast, protected_ops_);
+  expr.optimize();
+  return expr;
+}
+
+/**
+ * @brief a compiled AST's predictions for the points [begin, end) of a
+ * dataset, evaluated a column at a time
+ * @param out if not nullptr, a column as long as the dataset which the
+ * predictions are copied into, at [begin, end). chunks may copy theirs
+ * concurrently
+ */
+std::vector<double> loss_fn::predict(const expression& expr, const dataset& ds,
+    std::size_t begin, std::size_t end, std::vector<double>* out) {
+  std::vector<double> x(ds.x.begin() + begin, ds.x.begin() + end);
+  std::vector<double> y_hat;
+  expr.eval(x, y_hat);
+  if (out) {
+    std::copy(y_hat.begin(), y_hat.end(), out->begin() + begin);
+  }
+  return y_hat;
+}
+
+/**
+ * @brief whether no value is infinite or NaN. x - x is 0 exactly for finite
+ * x, so the check is a branch-free, vectorizable pass
+ */
+bool loss_fn::all_finite(const std::vector<double>& values) {
+  bool finite = true;
+  for (std::size_t i = 0; i < values.size(); i++) {
+    finite &= values[i] - values[i] == 0;
+  }
+  return finite;
+}
+
+/**
+ * @brief adds up per chunk partial sums in chunk order
+ */
+double sum_partials(const std::vector<double>& partials) {
+  double sum = 0;
+  for (double partial : partials) {
+    sum += partial;
+  }
+  return sum;
+}
+
 
 /**
  * @brief mean squared error
  */ 
-class MAE : public loss_fn {
+class MAE final : public loss_fn {
   private:
     constexpr static double max_loss_ = 1e100;
   public:
     double loss(std::vector<double>&, std::vector<double>&);
-    double loss(dataset&, ast_ptr&); 
+    double loss(dataset&, ast_ptr&, std::vector<double>* = nullptr);
 };
 
 double MAE::loss(std::vector<double>& a, std::vector<double>& b) {
@@ -53,26 +182,47 @@ double MAE::loss(std::vector<double>& a, std::vector<double>& b) {
  * @param ds a reference to a datset
  * @param ast a complete ast which will be used
  * to evaluate dataset.x points
+ * @param predictions if not nullptr, receives the AST's predictions
  * @return the mean squared error
  */
-double MAE::loss(dataset& ds, ast_ptr& ast) {
+double MAE::loss(dataset& ds, ast_ptr& ast, std::vector<double>* predictions) {
+  expression expr = compile(ast);
+  if (predictions) {
+    predictions->resize(ds.x.size());
+  }
+  if (use_chunks(ds)) {
+    double sum = sum_partials(evaluate_chunks(ds, [&](std::size_t begin, std::size_t end) {
+      auto y_hat = predict(expr, ds, begin, end, predictions);
+      if (!all_finite(y_hat)) {
+        return std::numeric_limits<double>::infinity();
+      }
+      double partial = 0;
+      for (std::size_t i = begin; i < end; i++) {
+        partial += std::abs(ds.y[i] - y_hat[i - begin]);
+      }
+      return partial;
+    }));
+    auto res = sum / ds.x.size();
+    limit_loss(res, max_loss_);
+    return res;
+  }
   std::vector<double>& a = ds.y;
-  std::vector<double> b;
-  for (std::size_t i = 0; i < ds.x.size(); i++) {
-    b.push_back(ast->eval(ds.x[i]));
-  } 
+  std::vector<double> b = predict(expr, ds, 0, ds.x.size(), predictions);
+  if (!all_finite(b)) {
+    return max_loss_;
+  }
   return loss(a, b);
 }
 
 /**
  * @brief mean squared error
  */ 
-class MSE : public loss_fn {
+class MSE final : public loss_fn {
   private:
     constexpr static double max_loss_ = 1e100;
   public:
     double loss(std::vector<double>&, std::vector<double>&);
-    double loss(dataset&, ast_ptr&); 
+    double loss(dataset&, ast_ptr&, std::vector<double>* = nullptr);
 };
 
 double MSE::loss(std::vector<double>& a, std::vector<double>& b) {
@@ -91,39 +241,111 @@ double MSE::loss(std::vector<double>& a, std::vector<double>& b) {
  * @param ds a reference to a datset
  * @param ast a complete ast which will be used
  * to evaluate dataset.x points
+ * @param predictions if not nullptr, receives the AST's predictions
  * @return the mean squared error
  */
-double MSE::loss(dataset& ds, ast_ptr& ast) {
+double MSE::loss(dataset& ds, ast_ptr& ast, std::vector<double>* predictions) {
+  expression expr = compile(ast);
+  if (predictions) {
+    predictions->resize(ds.x.size());
+  }
+  if (use_chunks(ds)) {
+    double sum = sum_partials(evaluate_chunks(ds, [&](std::size_t begin, std::size_t end) {
+      auto y_hat = predict(expr, ds, begin, end, predictions);
+      if (!all_finite(y_hat)) {
+        return std::numeric_limits<double>::infinity();
+      }
+      double partial = 0;
+      for (std::size_t i = begin; i < end; i++) {
+        partial += std::pow(ds.y[i] - y_hat[i - begin], 2);
+      }
+      return partial;
+    }));
+    auto res = sum / ds.x.size();
+    limit_loss(res, max_loss_);
+    return res;
+  }
   std::vector<double>& a = ds.y;
-  std::vector<double> b;
-  for (std::size_t i = 0; i < ds.x.size(); i++) {
-    b.push_back(ast->eval(ds.x[i]));
-  } 
+  std::vector<double> b = predict(expr, ds, 0, ds.x.size(), predictions);
+  if (!all_finite(b)) {
+    return max_loss_;
+  }
   return loss(a, b);
 }
 
 /**
  * @brief normalized root mean squared deviation
  */
-class NRMSD : public loss_fn {
+class NRMSD final : public loss_fn {
   private:
     constexpr static double max_loss_ = 1e100;
     MSE mse_;
   public:
-    double loss(dataset&, ast_ptr&);
+    void set_chunked_eval(std::size_t, std::size_t, thread_pool* = nullptr) override;
+    void set_protected_ops(bool) override;
+    double loss(dataset&, ast_ptr&, std::vector<double>* = nullptr);
     double loss(std::vector<double>&, std::vector<double>&);
 };
 
+void NRMSD::set_chunked_eval(std::size_t threshold, std::size_t chunk_size, thread_pool* pool) {
+  loss_fn::set_chunked_eval(threshold, chunk_size, pool);
+  mse_.set_chunked_eval(threshold, chunk_size, pool);
+}
+
+void NRMSD::set_protected_ops(bool protected_ops) {
+  loss_fn::set_protected_ops(protected_ops);
+  mse_.set_protected_ops(protected_ops);
+}
+
 /**
  * @brief calculates the normalized root mean squared 
  * deviation of a dataset evaluated across an AST.
  * @param ds a reference to a datset
  * @param ast a complete ast which will be used
  * to evaluate dataset.x points
+ * @param predictions if not nullptr, receives the AST's predictions
  * @return the NRMSD 
  */
-double NRMSD::loss(dataset& ds, ast_ptr& ast) {
-  double RMSD = sqrt(mse_.loss(ds, ast));
+double NRMSD::loss(dataset& ds, ast_ptr& ast, std::vector<double>* predictions) {
+  if (use_chunks(ds)) {
+    struct partial {
+      double sum_sq = 0;
+      double min = std::numeric_limits<double>::infinity();
+      double max = -std::numeric_limits<double>::infinity();
+    };
+    partial total;
+    expression expr = compile(ast);
+    if (predictions) {
+      predictions->resize(ds.x.size());
+    }
+    for (auto& p : evaluate_chunks(ds, [&](std::size_t begin, std::size_t end) {
+      auto y_hat = predict(expr, ds, begin, end, predictions);
+      partial p;
+      // the range of y covers every chunk, whatever the predictions are
+      for (std::size_t i = begin; i < end; i++) {
+        p.min = std::min(p.min, ds.y[i]);
+        p.max = std::max(p.max, ds.y[i]);
+      }
+      if (!all_finite(y_hat)) {
+        p.sum_sq = std::numeric_limits<double>::infinity();
+        return p;
+      }
+      for (std::size_t i = begin; i < end; i++) {
+        p.sum_sq += std::pow(ds.y[i] - y_hat[i - begin], 2);
+      }
+      return p;
+    })) {
+      total.sum_sq += p.sum_sq;
+      total.min = std::min(total.min, p.min);
+      total.max = std::max(total.max, p.max);
+    }
+    double mse = total.sum_sq / ds.x.size();
+    limit_loss(mse, max_loss_);
+    double res = sqrt(mse) / (total.max - total.min);
+    limit_loss(res, max_loss_);
+    return res;
+  }
+  double RMSD = sqrt(mse_.loss(ds, ast, predictions));
   double min = *std::min_element(ds.y.begin(), ds.y.end());
   double max = *std::max_element(ds.y.begin(), ds.y.end());
   double res = RMSD / (max - min);
@@ -143,11 +365,11 @@ double NRMSD::loss(std::vector<double>& y, std::vector<double>& y_hat) {
 /**
  * @brief mean absolute percentage error
  */
-class MAPE : public loss_fn {
+class MAPE final : public loss_fn {
   private:
     constexpr static double max_loss_ = 1;
   public:
-    double loss(dataset&, ast_ptr&); 
+    double loss(dataset&, ast_ptr&, std::vector<double>* = nullptr);
     double loss(std::vector<double>&, std::vector<double>&);
 };
 
@@ -157,17 +379,36 @@ class MAPE : public loss_fn {
  * @param ds a reference to a datset
  * @param ast a complete ast which will be used
  * to evaluate dataset.x points
+ * @param predictions if not nullptr, receives the AST's predictions
  * @return the MAPE 
  */
-double MAPE::loss(dataset& ds, ast_ptr& ast) {
-  double sum = 0;
-  for (std::size_t i = 0; i < ds.x.size(); i++) {
-    double y_hat = ast->eval(ds.x[i]);
-    sum += (y_hat + ds.y[i] == 0) ? 0 : std::abs((ds.y[i] - y_hat) / (ds.y[i] + y_hat)); 
+double MAPE::loss(dataset& ds, ast_ptr& ast, std::vector<double>* predictions) {
+  expression expr = compile(ast);
+  if (predictions) {
+    predictions->resize(ds.x.size());
   }
-  double res = sum /= ds.x.size();
-  limit_loss(res, max_loss_);
-  return res;
+  if (use_chunks(ds)) {
+    double sum = sum_partials(evaluate_chunks(ds, [&](std::size_t begin, std::size_t end) {
+      auto chunk = predict(expr, ds, begin, end, predictions);
+      if (!all_finite(chunk)) {
+        return std::numeric_limits<double>::infinity();
+      }
+      double partial = 0;
+      for (std::size_t i = begin; i < end; i++) {
+        double y_hat = chunk[i - begin];
+        partial += (y_hat + ds.y[i] == 0) ? 0 : std::abs((ds.y[i] - y_hat) / (ds.y[i] + y_hat));
+      }
+      return partial;
+    }));
+    double res = sum / ds.x.size();
+    limit_loss(res, max_loss_);
+    return res;
+  }
+  std::vector<double> y_hat = predict(expr, ds, 0, ds.x.size(), predictions);
+  if (!all_finite(y_hat)) {
+    return max_loss_;
+  }
+  return loss(ds.y, y_hat);
 }
 
 double MAPE::loss(std::vector<double>& y, std::vector<double>& y_hat) {
@@ -181,22 +422,41 @@ double MAPE::loss(std::vector<double>& y, std::vector<double>& y_hat) {
   return res;
 }
 
-class colling : public loss_fn {
+class colling final : public loss_fn {
   private:
     NRMSD nrmsd_;
     constexpr static double max_loss_ = 1e100;
   public:
-    double loss(dataset&, ast_ptr&);
+    double loss(dataset&, ast_ptr&, std::vector<double>* = nullptr);
 };
 
-double colling::loss(dataset& ds, ast_ptr& ast) {
+/**
+ * @brief half the NRMSD of the predictions, half the NRMSD of their slopes.
+ * the slopes of the data and of the predictions are both forward
+ * differences, so an exact fit has no loss whatever its curvature
+ * @param predictions if not nullptr, receives the AST's predictions
+ */
+double colling::loss(dataset& ds, ast_ptr& ast, std::vector<double>* predictions) {
   std::vector<double>& y = ds.y;
   std::vector<double>& x = ds.x;
-  int step_size = x[1] - x[0]; 
+  double step_size = x[1] - x[0];
   std::vector<double> d_y = util::numerical_derivative(y, step_size);
+  expression expr = compile(ast);
+  if (predictions) {
+    predictions->resize(ds.x.size());
+  }
   std::vector<double> y_hat;
-  for (std::size_t i = 0; i < x.size(); i++) {
-    y_hat.push_back(ast->eval(x[i]));
+  if (use_chunks(ds)) {
+    for (auto& chunk : evaluate_chunks(ds, [&](std::size_t begin, std::size_t end) {
+      return predict(expr, ds, begin, end, predictions);
+    })) {
+      y_hat.insert(y_hat.end(), chunk.begin(), chunk.end());
+    }
+  } else {
+    y_hat = predict(expr, ds, 0, x.size(), predictions);
+  }
+  if (!all_finite(y_hat)) {
+    return max_loss_;
   }
   std::vector<double> d_y_hat = util::numerical_derivative(y_hat, step_size);
   auto l = .5 * nrmsd_.loss(y, y_hat) + .5 * nrmsd_.loss(d_y, d_y_hat);
@@ -204,28 +464,42 @@ double colling::loss(dataset& ds, ast_ptr& ast) {
   return l;
 };
 /**
- * @brief given a string representation of a loss function,
- * returns a shared pointer to a corresponding function instance
+ * @brief calls f with the type_tag of the loss function named loss_fn_str
  * @param loss_fn_str a string representation of a loss function.
  * for example, "MSE"
- * @return a shared pointer to a loss function
+ * @param f a generic callable
+ * @return whatever f returns
  */
-std::shared_ptr<loss_fn> get(std::string loss_fn_str) {
+template <class F>
+decltype(auto) dispatch(const std::string& loss_fn_str, F&& f) {
   if (loss_fn_str == "MSE") {
-    return std::make_shared<MSE>();
+    return f(util::type_tag<MSE>{});
   } else if (loss_fn_str == "NRMSD") {
-    return std::make_shared<NRMSD>();
+    return f(util::type_tag<NRMSD>{});
   } else if (loss_fn_str == "MAPE") {
-    return std::make_shared<MAPE>();
+    return f(util::type_tag<MAPE>{});
   } else if (loss_fn_str == "MASE") {
-    return std::make_shared<MAE>();
+    return f(util::type_tag<MAE>{});
   } else if (loss_fn_str == "colling") {
-    return std::make_shared<colling>(); 
+    return f(util::type_tag<colling>{});
   } else {
-    return std::make_shared<MAPE>();
+    return f(util::type_tag<MAPE>{});
   }
 }
 
+/**
+ * @brief given a string representation of a loss function,
+ * returns a shared pointer to a corresponding function instance
+ * @param loss_fn_str a string representation of a loss function.
+ * for example, "MSE"
+ * @return a shared pointer to a loss function
+ */
+std::shared_ptr<loss_fn> get(std::string loss_fn_str) {
+  return dispatch(loss_fn_str, [](auto tag) -> std::shared_ptr<loss_fn> {
+    return std::make_shared<typename decltype(tag)::type>();
+  });
+}
+
 } // loss
 } // symreg
 
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace symreg
+{
+
+/**
+ * @brief parses a Linux cpulist such as "0-3,8,10-11" into cpu ids
+ * @param list the cpulist
+ * @return the cpu ids listed, in the order listed
+ */
+inline std::vector<int> parse_cpulist(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+    if (range.empty()) {
+      continue;
+    }
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+/**
+ * @brief which cpus belong to which NUMA node
+ *
+ * Read from /sys/devices/system/node when it's there. Otherwise, and on
+ * machines with a single node, every cpu is considered to be on node 0 and
+ * the placement helpers below do nothing.
+ */
+class numa_topology {
+  private:
+    std::vector<std::vector<int>> node_cpus_;
+  public:
+    numa_topology();
+    explicit numa_topology(const std::string&);
+    std::size_t num_nodes() const;
+    bool is_numa() const;
+    const std::vector<int>& cpus_of(std::size_t) const;
+    std::size_t node_of_cpu(int) const;
+    std::size_t current_node() const;
+};
+
+/**
+ * @brief detects the topology of this machine
+ */
+inline numa_topology::numa_topology()
+  : numa_topology("/sys/devices/system/node")
+{}
+
+/**
+ * @brief reads the topology from a sysfs style directory
+ * @param sysfs_root a directory holding node0/cpulist, node1/cpulist, ...
+ */
+inline numa_topology::numa_topology(const std::string& sysfs_root) {
+  for (std::size_t node = 0; ; node++) {
+    std::ifstream in(sysfs_root + "/node" + std::to_string(node) + "/cpulist");
+    if (!in) {
+      break;
+    }
+    std::string list;
+    std::getline(in, list);
+    node_cpus_.push_back(parse_cpulist(list));
+  }
+  if (node_cpus_.empty()) {
+    node_cpus_.emplace_back();
+    for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) {
+      node_cpus_.back().push_back(cpu);
+    }
+  }
+}
+
+inline std::size_t numa_topology::num_nodes() const {
+  return node_cpus_.size();
+}
+
+/**
+ * @brief whether there is more than one node, i.e. whether placement matters
+ */
+inline bool numa_topology::is_numa() const {
+  return node_cpus_.size() > 1;
+}
+
+inline const std::vector<int>& numa_topology::cpus_of(std::size_t node) const {
+  return node_cpus_[node % node_cpus_.size()];
+}
+
+/**
+ * @brief the node a cpu belongs to. unknown cpus map to node 0
+ */
+inline std::size_t numa_topology::node_of_cpu(int cpu) const {
+  for (std::size_t node = 0; node < node_cpus_.size(); node++) {
+    if (std::find(node_cpus_[node].begin(), node_cpus_[node].end(), cpu) != node_cpus_[node].end()) {
+      return node;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief the node the calling thread is running on right now
+ */
+inline std::size_t numa_topology::current_node() const {
+  if (!is_numa()) {
+    return 0;
+  }
+  return node_of_cpu(sched_getcpu());
+}
+
+/**
+ * @brief restricts the calling thread to the cpus of one node. memory the
+ * thread touches first afterwards is then allocated on that node by the
+ * kernel's default first-touch policy
+ * @param topo the machine's topology
+ * @param node the node to pin to
+ * @return whether the thread was pinned. always false on single node machines
+ */
+inline bool pin_this_thread_to_node(const numa_topology& topo, std::size_t node) {
+  if (!topo.is_numa()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : topo.cpus_of(node)) {
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/**
+ * @brief one read-only copy of a T per NUMA node
+ *
+ * Each copy is made by a thread pinned to its node, so first-touch places
+ * it in that node's memory. Threads pinned to a node should read their
+ * node's copy. On single node machines there's just the one copy.
+ */
+template <class T>
+class node_replicas {
+  private:
+    const numa_topology& topo_;
+    std::vector<std::unique_ptr<T>> replicas_;
+  public:
+    node_replicas(const T&, const numa_topology&);
+    const T& get(std::size_t) const;
+    T& get(std::size_t);
+    T& local();
+    std::size_t size() const;
+};
+
+/**
+ * @brief node replicas constructor
+ * @param original what to copy onto every node
+ * @param topo the machine's topology. must outlive the replicas
+ */
+template <class T>
+node_replicas<T>::node_replicas(const T& original, const numa_topology& topo)
+  : topo_(topo), replicas_(topo.num_nodes())
+{
+  if (!topo.is_numa()) {
+    replicas_[0] = std::make_unique<T>(original);
+    return;
+  }
+  std::vector<std::thread> copiers;
+  for (std::size_t node = 0; node < replicas_.size(); node++) {
+    copiers.emplace_back([this, &original, node] {
+      pin_this_thread_to_node(topo_, node);
+      replicas_[node] = std::make_unique<T>(original);
+    });
+  }
+  for (auto& copier : copiers) {
+    copier.join();
+  }
+}
+
+template <class T>
+const T& node_replicas<T>::get(std::size_t node) const {
+  return *replicas_[node % replicas_.size()];
+}
+
+template <class T>
+T& node_replicas<T>::get(std::size_t node) {
+  return *replicas_[node % replicas_.size()];
+}
+
+/**
+ * @brief the copy on the node the calling thread is running on
+ */
+template <class T>
+T& node_replicas<T>::local() {
+  return get(topo_.current_node());
+}
+
+template <class T>
+std::size_t node_replicas<T>::size() const {
+  return replicas_.size();
+}
+
+}
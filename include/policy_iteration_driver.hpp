@@ -1,5 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "numa.hpp"
+#include "thread_pool.hpp"
 #include "training_example.hpp"
 
 namespace symreg
@@ -7,35 +17,215 @@ namespace symreg
 
 template <class NeuralNet, class TreeSearch>
 class policy_iteration_driver {
+  public:
+    using search_factory = std::function<std::unique_ptr<TreeSearch>()>;
+    using node_search_factory = std::function<std::unique_ptr<TreeSearch>(std::size_t)>;
   private:
     NeuralNet& nn_;
-    TreeSearch& mcts_;
+    std::vector<std::unique_ptr<TreeSearch>> owned_;
+    std::vector<TreeSearch*> searches_;
+    const numa_topology* topo_ = nullptr;
+    std::vector<std::size_t> nodes_;
     int num_iterations_ = 10;
     int num_episodes_ = 10;
     training_examples examples_;
+    std::mutex examples_mtx_;
+    void run_episode(TreeSearch&);
   public:
     policy_iteration_driver(NeuralNet&, TreeSearch&);
+    policy_iteration_driver(NeuralNet&, search_factory, int);
+    policy_iteration_driver(NeuralNet&, node_search_factory, int, const numa_topology&);
     void iterate();
+    void set_num_iterations(int);
+    void set_num_episodes(int);
+    int get_num_workers() const;
+    std::size_t get_node_of_worker(int) const;
+    const training_examples& get_training_examples() const;
 };
 
+/**
+ * @brief policy iteration driver constructor which plays every episode
+ * on the one tree search it is given
+ * @param nn the regressor being trained
+ * @param mcts the tree search which plays episodes
+ */
 template <class NeuralNet, class TreeSearch>
-policy_iteration_driver<NeuralNet, TreeSearch>::policy_iteration_driver(NeuralNet& nn, TreeSearch& mcts) 
-  : nn_(nn), mcts_(mcts)
+policy_iteration_driver<NeuralNet, TreeSearch>::policy_iteration_driver(NeuralNet& nn, TreeSearch& mcts)
+  : nn_(nn), searches_{&mcts}
 {}
 
+/**
+ * @brief policy iteration driver constructor which plays episodes concurrently
+ *
+ * num_workers independent tree searches are built with the factory. they
+ * should all share nn as their regressor; the driver collects the training
+ * examples they produce into one set.
+ *
+ * @param nn the regressor being trained
+ * @param factory builds one tree search per worker
+ * @param num_workers the number of episodes played at once
+ */
+template <class NeuralNet, class TreeSearch>
+policy_iteration_driver<NeuralNet, TreeSearch>::policy_iteration_driver(
+    NeuralNet& nn, search_factory factory, int num_workers)
+  : nn_(nn)
+{
+  for (int i = 0; i < std::max(1, num_workers); i++) {
+    owned_.push_back(factory());
+    searches_.push_back(owned_.back().get());
+  }
+}
+
+/**
+ * @brief policy iteration driver constructor which plays episodes
+ * concurrently, placing each worker on a NUMA node
+ *
+ * workers are spread round robin over the nodes. each worker's tree search
+ * is built, and its episodes are played, by a thread pinned to its node, so
+ * the search's tree is allocated in that node's memory. the factory is told
+ * which node the search is for, e.g. to hand it that node's dataset replica
+ * from a node_replicas. on single node machines nothing is pinned. an
+ * exception the factory throws is rethrown here once its thread is joined.
+ *
+ * @param nn the regressor being trained
+ * @param factory builds the tree search for a worker on the given node
+ * @param num_workers the number of episodes played at once
+ * @param topo the machine's topology. must outlive the driver
+ */
+template <class NeuralNet, class TreeSearch>
+policy_iteration_driver<NeuralNet, TreeSearch>::policy_iteration_driver(
+    NeuralNet& nn, node_search_factory factory, int num_workers, const numa_topology& topo)
+  : nn_(nn), topo_(&topo)
+{
+  for (int i = 0; i < std::max(1, num_workers); i++) {
+    std::size_t node = i % topo.num_nodes();
+    std::exception_ptr error;
+    std::thread builder([this, &factory, &error, node] {
+      try {
+        pin_this_thread_to_node(*topo_, node);
+        owned_.push_back(factory(node));
+      } catch (...) {
+        error = std::current_exception();
+      }
+    });
+    builder.join();
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    searches_.push_back(owned_.back().get());
+    nodes_.push_back(node);
+  }
+}
+
+/**
+ * @brief plays a single episode and adds its examples to the shared set
+ * @param mcts the tree search to play the episode on
+ */
+template <class NeuralNet, class TreeSearch>
+void policy_iteration_driver<NeuralNet, TreeSearch>::run_episode(TreeSearch& mcts) {
+  mcts.reset();
+  mcts.iterate();
+  auto new_examples = mcts.get_training_examples();
+  auto result = mcts.get_result()->to_string();
+  std::lock_guard<std::mutex> lock(examples_mtx_);
+  std::cout << result << std::endl;
+  examples_.insert(examples_.end(), new_examples.begin(), new_examples.end());
+}
+
+/**
+ * @brief runs num_iterations_ rounds of self play followed by training
+ *
+ * each round plays num_episodes_ episodes. with more than one worker,
+ * each worker pulls episodes off a shared counter and plays them on its
+ * own tree search, so episodes run concurrently. workers placed on NUMA
+ * nodes run on threads pinned to their node. when an episode throws, no
+ * further episodes are started and the first exception is rethrown once
+ * every worker has returned.
+ */
 template <class NeuralNet, class TreeSearch>
 void policy_iteration_driver<NeuralNet, TreeSearch>::iterate() {
+  std::unique_ptr<thread_pool> pool;
+  if (searches_.size() > 1) {
+    pool = std::make_unique<thread_pool>(searches_.size());
+  }
   for (int i = 0; i < num_iterations_; i++) {
-    for (int j = 0; j < num_episodes_; j++) {
-      mcts_.reset();
-      mcts_.iterate();
-      auto new_examples = mcts_.get_training_examples();
-      std::cout << mcts_.get_result()->to_string() << std::endl;
-      examples_.insert(examples_.end(), new_examples.begin(), new_examples.end()); 
+    if (!pool) {
+      for (int j = 0; j < num_episodes_; j++) {
+        run_episode(*searches_.front());
+      }
+    } else {
+      std::atomic<int> next_episode(0);
+      std::vector<std::future<void>> done;
+      for (std::size_t k = 0; k < searches_.size(); k++) {
+        TreeSearch* mcts = searches_[k];
+        done.push_back(pool->submit([this, k, mcts, &next_episode] {
+          if (topo_) {
+            pin_this_thread_to_node(*topo_, nodes_[k]);
+          }
+          try {
+            while (next_episode.fetch_add(1) < num_episodes_) {
+              run_episode(*mcts);
+            }
+          } catch (...) {
+            // the other workers stop after their current episode
+            next_episode = num_episodes_;
+            throw;
+          }
+        }));
+      }
+      // every worker refers to next_episode, so all of them are waited for
+      // before an episode's exception is rethrown
+      std::exception_ptr error;
+      for (auto& fut : done) {
+        try {
+          fut.get();
+        } catch (...) {
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+      }
+      if (error) {
+        std::rethrow_exception(error);
+      }
     }
     nn_.train(examples_);
   }
 }
 
+template <class NeuralNet, class TreeSearch>
+void policy_iteration_driver<NeuralNet, TreeSearch>::set_num_iterations(int num_iterations) {
+  num_iterations_ = num_iterations;
+}
+
+template <class NeuralNet, class TreeSearch>
+void policy_iteration_driver<NeuralNet, TreeSearch>::set_num_episodes(int num_episodes) {
+  num_episodes_ = num_episodes;
+}
+
+/**
+ * @brief a getter for the number of episodes played concurrently
+ */
+template <class NeuralNet, class TreeSearch>
+int policy_iteration_driver<NeuralNet, TreeSearch>::get_num_workers() const {
+  return searches_.size();
 }
 
+/**
+ * @brief the NUMA node a worker was placed on. always 0 unless the driver
+ * was given a topology
+ */
+template <class NeuralNet, class TreeSearch>
+std::size_t policy_iteration_driver<NeuralNet, TreeSearch>::get_node_of_worker(int worker) const {
+  return nodes_.empty() ? 0 : nodes_[worker];
+}
+
+/**
+ * @brief a getter for every training example gathered so far
+ */
+template <class NeuralNet, class TreeSearch>
+const training_examples& policy_iteration_driver<NeuralNet, TreeSearch>::get_training_examples() const {
+  return examples_;
+}
+
+}
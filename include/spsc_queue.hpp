@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+namespace symreg
+{
+
+/**
+ * @brief a bounded, lock-free ring buffer connecting exactly one
+ * producer thread to exactly one consumer thread
+ */
+template <class T>
+class spsc_queue {
+  private:
+    std::vector<T> buf_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> head_;
+    alignas(64) std::atomic<std::size_t> tail_;
+  public:
+    explicit spsc_queue(std::size_t);
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+    bool try_push(T&&);
+    bool try_pop(T&);
+    std::size_t size() const;
+    bool empty() const;
+    std::size_t capacity() const;
+};
+
+/**
+ * @brief spsc queue constructor
+ * @param capacity the minimum number of elements the queue can hold. it is
+ * rounded up to a power of two
+ */
+template <class T>
+spsc_queue<T>::spsc_queue(std::size_t capacity)
+  : head_(0), tail_(0)
+{
+  std::size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  buf_.resize(size);
+  mask_ = size - 1;
+}
+
+/**
+ * @brief producer side: moves elem into the queue if there is room
+ * @param elem the element to enqueue
+ * @return false if the queue was full, in which case elem is untouched
+ */
+template <class T>
+bool spsc_queue<T>::try_push(T&& elem) {
+  std::size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) == buf_.size()) {
+    return false;
+  }
+  buf_[tail & mask_] = std::move(elem);
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+/**
+ * @brief consumer side: moves the oldest element out of the queue
+ * @param elem where the element is moved to
+ * @return false if the queue was empty
+ */
+template <class T>
+bool spsc_queue<T>::try_pop(T& elem) {
+  std::size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  elem = std::move(buf_[head & mask_]);
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+/**
+ * @brief the number of elements in the queue. only exact when called
+ * from the producer or consumer while the other side is idle
+ */
+template <class T>
+std::size_t spsc_queue<T>::size() const {
+  return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+}
+
+template <class T>
+bool spsc_queue<T>::empty() const {
+  return size() == 0;
+}
+
+template <class T>
+std::size_t spsc_queue<T>::capacity() const {
+  return buf_.size();
+}
+
+}
@@ -5,12 +5,20 @@
 namespace symreg
 {
 static std::random_device rd;
-static std::mt19937 mt(rd());
+// one engine per thread so that searches may run concurrently
+static thread_local std::mt19937 mt(std::random_device{}());
 } // symreg
 
+#include "concurrent_priority_queue.hpp"
+#include "constant_fitter.hpp"
 #include "dataset.hpp"
+#include "expression.hpp"
 #include "fixed_size_priority_queue.hpp"
 #include "dnn.hpp"
+#include "distributed/coordinator.hpp"
+#include "distributed/worker.hpp"
+#include "numa.hpp"
 #include "policy_iteration_driver.hpp"
+#include "thread_pool.hpp"
 #include "MCTS/MCTS.hpp"
 #include "MCTS/search_node.hpp"
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace symreg
+{
+
+/**
+ * @brief a fixed size pool of worker threads which run posted tasks
+ * in FIFO order. this is the executor parallel parts of symreg
+ * schedule their work on.
+ */
+class thread_pool {
+  private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stopping_;
+    void work();
+  public:
+    explicit thread_pool(std::size_t = 0);
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    ~thread_pool();
+    void post(std::function<void()>);
+    template <class F>
+    std::future<std::invoke_result_t<F>> submit(F&&);
+    std::size_t size() const;
+};
+
+/**
+ * @brief thread pool constructor. spawns the worker threads immediately
+ * @param num_threads the number of workers. defaults to the hardware
+ * concurrency
+ */
+inline thread_pool::thread_pool(std::size_t num_threads)
+  : stopping_(false)
+{
+  if (!num_threads) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (std::size_t i = 0; i < num_threads; i++) {
+    workers_.emplace_back([this] { work(); });
+  }
+}
+
+/**
+ * @brief thread pool destructor. tasks already posted are finished before
+ * the workers are joined
+ */
+inline thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+/**
+ * @brief the loop each worker runs: pop a task, run it, repeat until the
+ * pool is stopping and there's nothing left to do
+ */
+inline void thread_pool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+/**
+ * @brief queues a task for execution by some worker
+ * @param task the callable to run
+ */
+inline void thread_pool::post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    tasks_.push(std::move(task));
+  }
+  cv_.notify_one();
+}
+
+/**
+ * @brief queues a task and hands back a future for its result. exceptions
+ * thrown by the task are rethrown by future::get()
+ * @param f the callable to run
+ * @return a future which becomes ready once f has run
+ */
+template <class F>
+std::future<std::invoke_result_t<F>> thread_pool::submit(F&& f) {
+  using result_type = std::invoke_result_t<F>;
+  auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(f));
+  auto fut = task->get_future();
+  post([task] { (*task)(); });
+  return fut;
+}
+
+/**
+ * @brief a getter for the number of worker threads
+ */
+inline std::size_t thread_pool::size() const {
+  return workers_.size();
+}
+
+/**
+ * @brief splits [0, n) into chunks of chunk_size and maps f over them on a
+ * thread pool
+ *
+ * The calling thread works through chunks too, alongside up to pool.size()
+ * helper tasks, and claims whatever the helpers haven't started. So this
+ * never waits on the pool to get around to it, and may safely be called
+ * from one of the pool's own tasks. Chunk boundaries only depend on n and
+ * chunk_size and the results come back in chunk order, so reducing them in
+ * order gives the same answer however many threads took part.
+ *
+ * @param pool the pool to borrow helpers from
+ * @param n the number of items
+ * @param chunk_size the number of items per chunk (the last may be shorter)
+ * @param f called as f(begin, end) for each chunk
+ * @return f's result for every chunk, in chunk order
+ */
+template <class F>
+std::vector<std::invoke_result_t<F&, std::size_t, std::size_t>>
+map_chunks(thread_pool& pool, std::size_t n, std::size_t chunk_size, F f) {
+  using result_type = std::invoke_result_t<F&, std::size_t, std::size_t>;
+  struct progress {
+    std::atomic<std::size_t> next{0};
+    std::size_t num_done = 0;
+    std::exception_ptr error;
+    std::mutex mtx;
+    std::condition_variable cv;
+  };
+  chunk_size = std::max<std::size_t>(1, chunk_size);
+  std::size_t num_chunks = (n + chunk_size - 1) / chunk_size;
+  std::vector<result_type> results(num_chunks);
+  if (!num_chunks) {
+    return results;
+  }
+
+  // helpers which start after every chunk was claimed touch nothing but
+  // prog, which they keep alive themselves
+  auto prog = std::make_shared<progress>();
+  auto work = [prog, num_chunks, n, chunk_size, &results, &f] {
+    std::size_t chunk;
+    while ((chunk = prog->next.fetch_add(1)) < num_chunks) {
+      std::exception_ptr error;
+      try {
+        results[chunk] = f(chunk * chunk_size, std::min(n, (chunk + 1) * chunk_size));
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(prog->mtx);
+      if (error && !prog->error) {
+        prog->error = error;
+      }
+      if (++prog->num_done == num_chunks) {
+        prog->cv.notify_all();
+      }
+    }
+  };
+  for (std::size_t i = 0; i < std::min(pool.size(), num_chunks - 1); i++) {
+    pool.post(work);
+  }
+  work();
+
+  std::unique_lock<std::mutex> lock(prog->mtx);
+  prog->cv.wait(lock, [&] { return prog->num_done == num_chunks; });
+  if (prog->error) {
+    std::rethrow_exception(prog->error);
+  }
+  return results;
+}
+
+}
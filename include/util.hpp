@@ -9,15 +9,30 @@ namespace symreg
 namespace util
 {
 
+/**
+ * @brief forward differences of evenly spaced samples
+ * @param vec the samples
+ * @param step_size the distance between neighbouring samples
+ * @return one difference quotient per pair of neighbours
+ */
 template <class T>
 std::vector<T> numerical_derivative(std::vector<T>& vec, double step_size) {
   std::vector<T> deriv;
-  for (int i = 0; i < vec.size() - 1; i++) {
-    deriv.push_back(vec[i + 1] - vec[i] / step_size); 
+  for (std::size_t i = 0; i + 1 < vec.size(); i++) {
+    deriv.push_back((vec[i + 1] - vec[i]) / step_size);
   }
   return deriv;
 }
 
+/**
+ * @brief stands in for a type, so that a type chosen at runtime can be
+ * passed to a generic lambda
+ */
+template <class T>
+struct type_tag {
+  using type = T;
+};
+
 /**
  * @brief a wrapper around cpptoml::table 
  * with some added convenience methods for more
@@ -31,9 +46,15 @@ class config {
     
     template <class T>
     T get(std::string);
+
+    template <class T>
+    T get_or(std::string, T);
     
     template <class T>
     std::vector<T> get_vector(std::string);
+
+    template <class T>
+    std::vector<T> get_vector_or(std::string, std::vector<T>);
     
     template <class T>
     void set(std::string, T);
@@ -65,6 +86,19 @@ T config::get(std::string key) {
   return option.value_or(T{});
 }
 
+/**
+ * @brief a getter for optional values in a .toml config
+ * @param key a table prefixed key, for example: "table1.prop2"
+ * @param fallback the value returned when the key is absent
+ * @return the value of type T corresponding to the key if the key exists
+ * in the .toml, fallback otherwise
+ */
+template <class T>
+T config::get_or(std::string key, T fallback) {
+  auto option = tbl_->get_qualified_as<T>(key);
+  return option.value_or(fallback);
+}
+
 /**
  * @brief a getter for retrieving arrays from a .toml config by key
  * @param key a table prefixed key which will be used to fetch an array of
@@ -82,10 +116,38 @@ std::vector<T> config::get_vector(std::string key) {
   return option.value_or(std::vector<T>{});
 }
 
+/**
+ * @brief a getter for optional arrays in a .toml config
+ * @param key a table prefixed key, for example: "table1.prop2"
+ * @param fallback the values returned when the key is absent
+ * @return a std::vector<T> built from the array of values associated with
+ * the key if the key exists in the .toml, fallback otherwise
+ */
+template <class T>
+std::vector<T> config::get_vector_or(std::string key, std::vector<T> fallback) {
+  auto option = tbl_->get_qualified_array_of<T>(key);
+  return option.value_or(fallback);
+}
+
+/**
+ * @brief sets a value in the config, replacing any value already there
+ * @param key a table prefixed key, as in get(). the table must exist
+ * @param value the value to store
+ */
 template <class T>
 void config::set(std::string key, T value) {
-  tbl_->erase(key);
-  tbl_->insert(key, value);
+  auto tbl = tbl_;
+  auto dot = key.rfind('.');
+  if (dot != std::string::npos) {
+    tbl = tbl_->get_table_qualified(key.substr(0, dot));
+    if (!tbl) {
+      std::cerr << "Error: table of key [" << key << "] not in config" << std::endl;
+      throw "MissingTomlKeyException";
+    }
+    key = key.substr(dot + 1);
+  }
+  tbl->erase(key);
+  tbl->insert(key, value);
 }
 
 /**
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace symreg
+{
+/**
+ * @brief elementary functions over arrays of doubles
+ *
+ * Each kernel reduces its argument with a few arithmetic steps and
+ * evaluates a fixed polynomial, so its loop body has no calls and no
+ * data dependent branches (special values are patched in with selects)
+ * and can be vectorized by the compiler. Results stay within 2 ulp of the
+ * correctly rounded value (see test/vector_math.cc). An array holding
+ * arguments sin() and cos() can't reduce accurately, i.e. beyond 1e6 in
+ * magnitude, infinities or NaNs, takes a scalar path which hands those to
+ * the standard library. x and out may be the same array.
+ */
+namespace vmath
+{
+  namespace detail
+  {
+    inline double from_bits(std::uint64_t bits) {
+      double d;
+      std::memcpy(&d, &bits, sizeof(d));
+      return d;
+    }
+
+    inline std::uint64_t to_bits(double d) {
+      std::uint64_t bits;
+      std::memcpy(&bits, &d, sizeof(bits));
+      return bits;
+    }
+
+    // adding 1.5 * 2^52 rounds a double to an integer k, which then sits
+    // in the low bits of the sum, and subtracting it again gives k as a double
+    constexpr double round_shifter = 6755399441055744.0;
+
+    /**
+     * @brief 2^k for an integral double k in [-1022, 1023], built from bits
+     * without integer conversions
+     */
+    inline double pow2(double k) {
+      return from_bits((to_bits(k + round_shifter) + 1023) << 52);
+    }
+
+    // pi/2 split into parts whose products with the quadrant are exact
+    constexpr double pio2_1 = 1.57079632673412561417e+00;
+    constexpr double pio2_2 = 6.07710050630396597660e-11;
+    constexpr double pio2_3 = 2.02226624871116645580e-21;
+    constexpr double two_over_pi = 6.36619772367581382433e-01;
+
+    // the largest magnitude sin() and cos() reduce themselves
+    constexpr double reduction_limit = 1e6;
+
+    constexpr double ln2_hi = 6.93147180369123816490e-01;
+    constexpr double ln2_lo = 1.90821492927058770002e-10;
+
+    // sin(r) and cos(r) for |r| <= pi/4
+    inline double sin_poly(double r) {
+      double z = r * r;
+      double p = -1.0 / 121645100408832000.0;
+      p = p * z + 1.0 / 355687428096000.0;
+      p = p * z - 1.0 / 1307674368000.0;
+      p = p * z + 1.0 / 6227020800.0;
+      p = p * z - 1.0 / 39916800.0;
+      p = p * z + 1.0 / 362880.0;
+      p = p * z - 1.0 / 5040.0;
+      p = p * z + 1.0 / 120.0;
+      p = p * z - 1.0 / 6.0;
+      return r + r * z * p;
+    }
+
+    inline double cos_poly(double r) {
+      double z = r * r;
+      double p = 1.0 / 2432902008176640000.0;
+      p = p * z - 1.0 / 6402373705728000.0;
+      p = p * z + 1.0 / 20922789888000.0;
+      p = p * z - 1.0 / 87178291200.0;
+      p = p * z + 1.0 / 479001600.0;
+      p = p * z - 1.0 / 3628800.0;
+      p = p * z + 1.0 / 40320.0;
+      p = p * z - 1.0 / 720.0;
+      p = p * z + 1.0 / 24.0;
+      double hz = .5 * z;
+      double w = 1 - hz;
+      // recovers the bits of 1 - z/2 lost to rounding
+      return w + (((1 - w) - hz) + z * z * p);
+    }
+
+    /**
+     * @brief x reduced to r in [-pi/4, pi/4] with x = r + k * pi/2.
+     * returns k mod 4
+     */
+    inline std::uint64_t reduce(double x, double& r) {
+      double shifted = x * two_over_pi + round_shifter;
+      double kd = shifted - round_shifter;
+      r = ((x - kd * pio2_1) - kd * pio2_2) - kd * pio2_3;
+      return to_bits(shifted) & 3;
+    }
+  }
+
+  /**
+   * @brief out[i] = e^x[i]
+   */
+  inline void exp(const double* x, double* out, std::size_t n) {
+    using namespace detail;
+    const double log2e = 1.44269504088896338700e+00;
+    for (std::size_t i = 0; i < n; i++) {
+      double xi = x[i];
+      double clamped = std::min(std::max(xi, -746.0), 710.0);
+      double c = xi == xi ? clamped : 0;
+      double kd = (c * log2e + round_shifter) - round_shifter;
+      double r = (c - kd * ln2_hi) - kd * ln2_lo;
+      double p = 1.0 / 6227020800.0;
+      p = p * r + 1.0 / 479001600.0;
+      p = p * r + 1.0 / 39916800.0;
+      p = p * r + 1.0 / 3628800.0;
+      p = p * r + 1.0 / 362880.0;
+      p = p * r + 1.0 / 40320.0;
+      p = p * r + 1.0 / 5040.0;
+      p = p * r + 1.0 / 720.0;
+      p = p * r + 1.0 / 120.0;
+      p = p * r + 1.0 / 24.0;
+      p = p * r + 1.0 / 6.0;
+      p = p * r + .5;
+      p = 1 + (r + r * r * p);
+      // 2^k in two steps, so that subnormal results and k = 1024 work out
+      double k1 = (.5 * kd + round_shifter) - round_shifter;
+      double y = p * pow2(k1) * pow2(kd - k1);
+      y = xi > 709.782712893383973096 ? std::numeric_limits<double>::infinity() : y;
+      y = xi < -745.133219101941108420 ? 0 : y;
+      out[i] = xi == xi ? y : xi;
+    }
+  }
+
+  /**
+   * @brief out[i] = ln x[i]
+   */
+  inline void log(const double* x, double* out, std::size_t n) {
+    using namespace detail;
+    const double sqrt2 = 1.41421356237309514547e+00;
+    for (std::size_t i = 0; i < n; i++) {
+      double xi = x[i];
+      // subnormals are scaled into the normal range first
+      bool tiny = xi < std::numeric_limits<double>::min();
+      double scaled = xi * 18014398509481984.0;
+      std::uint64_t bits = to_bits(tiny ? scaled : xi);
+      // the biased exponent as a double: 2^52 + e - 2^52
+      double e = from_bits(0x4330000000000000ULL | ((bits >> 52) & 0x7ff)) - 4503599627370496.0;
+      e -= tiny ? 1077 : 1023;
+      double m = from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+      bool big = m > sqrt2;
+      double half = .5 * m;
+      m = big ? half : m;
+      e += big ? 1 : 0;
+      // log(1 + f) = 2 atanh(s), s = f / (2 + f)
+      double f = m - 1;
+      double s = f / (2 + f);
+      double z = s * s;
+      double R = 2.0 / 23;
+      R = R * z + 2.0 / 21;
+      R = R * z + 2.0 / 19;
+      R = R * z + 2.0 / 17;
+      R = R * z + 2.0 / 15;
+      R = R * z + 2.0 / 13;
+      R = R * z + 2.0 / 11;
+      R = R * z + 2.0 / 9;
+      R = R * z + 2.0 / 7;
+      R = R * z + 2.0 / 5;
+      R = R * z + 2.0 / 3;
+      R *= z;
+      double hfsq = .5 * f * f;
+      double y = e * ln2_hi - ((hfsq - (s * (hfsq + R) + e * ln2_lo)) - f);
+      y = xi == std::numeric_limits<double>::infinity() ? xi : y;
+      y = xi == 0 ? -std::numeric_limits<double>::infinity() : y;
+      out[i] = xi < 0 || xi != xi ? std::numeric_limits<double>::quiet_NaN() : y;
+    }
+  }
+
+  namespace detail
+  {
+    inline double sin_reduced(double x) {
+      double r;
+      std::uint64_t q = reduce(x, r);
+      double y = q & 1 ? cos_poly(r) : sin_poly(r);
+      return q & 2 ? -y : y;
+    }
+
+    inline double cos_reduced(double x) {
+      double r;
+      std::uint64_t q = reduce(x, r);
+      double y = q & 1 ? sin_poly(r) : cos_poly(r);
+      return (q + 1) & 2 ? -y : y;
+    }
+
+    /**
+     * @brief whether some x[i] is too large to reduce, infinite or NaN
+     */
+    inline bool needs_libm(const double* x, std::size_t n) {
+      bool any = false;
+      for (std::size_t i = 0; i < n; i++) {
+        any |= !(std::abs(x[i]) <= reduction_limit);
+      }
+      return any;
+    }
+  }
+
+  /**
+   * @brief out[i] = sin x[i]
+   */
+  inline void sin(const double* x, double* out, std::size_t n) {
+    if (detail::needs_libm(x, n)) {
+      for (std::size_t i = 0; i < n; i++) {
+        out[i] = std::abs(x[i]) <= detail::reduction_limit ? detail::sin_reduced(x[i]) : std::sin(x[i]);
+      }
+      return;
+    }
+    for (std::size_t i = 0; i < n; i++) {
+      out[i] = detail::sin_reduced(x[i]);
+    }
+  }
+
+  /**
+   * @brief out[i] = cos x[i]
+   */
+  inline void cos(const double* x, double* out, std::size_t n) {
+    if (detail::needs_libm(x, n)) {
+      for (std::size_t i = 0; i < n; i++) {
+        out[i] = std::abs(x[i]) <= detail::reduction_limit ? detail::cos_reduced(x[i]) : std::cos(x[i]);
+      }
+      return;
+    }
+    for (std::size_t i = 0; i < n; i++) {
+      out[i] = detail::cos_reduced(x[i]);
+    }
+  }
+
+  /**
+   * @brief out[i] = sqrt x[i]. square roots are an instruction, and already
+   * correctly rounded
+   */
+  inline void sqrt(const double* x, double* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+      out[i] = std::sqrt(x[i]);
+    }
+  }
+}
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpptoml.hpp"
+#include "symreg.hpp"
+
+/**
+ * plays episodes searches with the given backup rule, each of them stopping
+ * as soon as a rollout's reward exceeds target or max_rollouts leaves have
+ * been evaluated. prints how many of the searches reached the target and
+ * how many rollouts they needed on average
+ */
+void run(symreg::util::config& cfg, symreg::dataset& ds, const std::string& backup,
+    int episodes, int max_rollouts, double target) {
+  cfg.set<std::string>("mcts.backup", backup);
+  cfg.set<std::string>("mcts.budget_mode", "rollouts");
+  cfg.set<double>("mcts.budget", max_rollouts);
+  cfg.set<double>("mcts.early_term_thresh", target);
+  symreg::MCTS::MCTS<symreg::DNN> mcts(ds, nullptr, cfg);
+  int num_reached = 0;
+  std::size_t rollouts_to_target = 0;
+  std::size_t rollouts = 0;
+  for (int i = 0; i < episodes; i++) {
+    mcts.reset();
+    mcts.iterate();
+    rollouts += mcts.get_num_explored();
+    if (mcts.got_reward_within_thresh()) {
+      num_reached++;
+      rollouts_to_target += mcts.get_num_explored();
+    }
+  }
+  std::cout << backup << ": reached " << num_reached << "/" << episodes;
+  if (num_reached > 0) {
+    std::cout << ", rollouts to target: " << rollouts_to_target / num_reached;
+  }
+  std::cout << ", rollouts per episode: " << rollouts / episodes << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Error: must pass a .toml config file path" << std::endl;
+    std::cerr << "usage: backup_benchmark <config.toml> [episodes] [max_rollouts] [target_reward]" << std::endl;
+    return 1;
+  }
+
+  symreg::util::config cfg(cpptoml::parse_file(argv[1]));
+  int episodes = argc > 2 ? std::stoi(argv[2]) : 10;
+  int max_rollouts = argc > 3 ? std::stoi(argv[3]) : 20000;
+  double target = argc > 4 ? std::stod(argv[4]) : .999;
+
+  symreg::dataset ds = symreg::generate_dataset(cfg);
+  std::cout << "episodes: " << episodes << ", max rollouts: " << max_rollouts
+    << ", target reward: " << target << std::endl;
+  for (std::string backup : {"mean", "max", "mixed"}) {
+    run(cfg, ds, backup, episodes, max_rollouts, target);
+  }
+  return 0;
+}
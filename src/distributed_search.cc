@@ -0,0 +1,82 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cpptoml.hpp"
+#include "symreg.hpp"
+
+/**
+ * runs a worker until its coordinator stops it
+ */
+int run_worker(symreg::util::config& cfg, const std::string& address) {
+  symreg::dataset ds = symreg::generate_dataset(cfg);
+  symreg::MCTS::MCTS<symreg::DNN> mcts(ds, nullptr, cfg);
+  symreg::distributed::worker<symreg::DNN> worker(mcts, address);
+  worker.run();
+  return 0;
+}
+
+/**
+ * runs a coordinator until the search is over and prints what it found
+ */
+void run_coordinator(symreg::util::config& cfg, symreg::distributed::coordinator& coord) {
+  coord.run();
+
+  std::cout << "Searching for expressions fitting data generated from f(x) = ";
+  std::cout << cfg.get<std::string>("dataset.function") << std::endl << std::endl;
+
+  auto top_n = coord.get_top_n();
+  int i = top_n.size();
+  std::cout << "After exploring " << coord.get_num_explored() << " ASTs over ";
+  std::cout << cfg.get<int>("distributed.num_workers") << " workers, here are the best ";
+  std::cout << i << " expressions found according to the loss function used:" << std::endl;
+
+  for (auto& cand : top_n) {
+    std::cout << "[" << i << "] expr: " << cand.expr.substr(1);
+    std::cout << " reward: " << cand.reward << std::endl;
+    i--;
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  if (argc < 2) {
+    std::cerr << "Error: Must pass a .toml config file path" << std::endl;
+    std::cerr << "usage: distributed_search <config.toml> [coordinator | worker]" << std::endl;
+    return 1;
+  }
+
+  symreg::util::config cfg(cpptoml::parse_file(argv[1]));
+  std::string role = argc > 2 ? argv[2] : "local";
+
+  if (role == "worker") {
+    return run_worker(cfg, cfg.get<std::string>("distributed.address"));
+  }
+
+  symreg::distributed::coordinator coord(cfg);
+  if (role == "coordinator") {
+    run_coordinator(cfg, coord);
+    return 0;
+  }
+
+  // local: fork the workers ourselves and talk to them over loopback
+  std::vector<pid_t> workers;
+  for (int i = 0; i < cfg.get<int>("distributed.num_workers"); i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      _exit(run_worker(cfg, coord.get_address()));
+    }
+    workers.push_back(pid);
+  }
+  run_coordinator(cfg, coord);
+  int failed = 0;
+  for (pid_t pid : workers) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  return failed ? 1 : 0;
+}
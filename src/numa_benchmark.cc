@@ -0,0 +1,75 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpptoml.hpp"
+#include "symreg.hpp"
+
+/**
+ * plays episodes_per_worker episodes on each of num_workers concurrent
+ * searches and returns the number of ASTs explored per second. when pinned,
+ * each worker is pinned to a node, builds its search there and searches
+ * that node's dataset replica. otherwise every worker shares one dataset
+ * and runs wherever the scheduler puts it
+ */
+double run(symreg::util::config& cfg, const symreg::numa_topology& topo,
+    symreg::node_replicas<symreg::dataset>& replicas, symreg::dataset& shared,
+    int num_workers, int episodes_per_worker, bool pinned) {
+  std::atomic<std::size_t> num_explored(0);
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_workers; i++) {
+    workers.emplace_back([&, i] {
+      std::size_t node = i % topo.num_nodes();
+      if (pinned) {
+        symreg::pin_this_thread_to_node(topo, node);
+      }
+      symreg::dataset& ds = pinned ? replicas.get(node) : shared;
+      symreg::MCTS::MCTS<symreg::DNN> mcts(ds, nullptr, cfg);
+      for (int j = 0; j < episodes_per_worker; j++) {
+        mcts.reset();
+        mcts.iterate();
+        num_explored += mcts.get_num_explored();
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return num_explored / elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Error: must pass a .toml config file path" << std::endl;
+    std::cerr << "usage: numa_benchmark <config.toml> [num_workers] [episodes_per_worker]" << std::endl;
+    return 1;
+  }
+
+  symreg::util::config cfg(cpptoml::parse_file(argv[1]));
+  int num_workers = argc > 2 ? std::stoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+  int episodes_per_worker = argc > 3 ? std::stoi(argv[3]) : 2;
+
+  symreg::numa_topology topo;
+  symreg::dataset shared = symreg::generate_dataset(cfg);
+  symreg::node_replicas<symreg::dataset> replicas(shared, topo);
+
+  std::cout << "NUMA nodes: " << topo.num_nodes();
+  if (!topo.is_numa()) {
+    std::cout << " (pinning is a no-op on this machine)";
+  }
+  std::cout << std::endl;
+  std::cout << "workers: " << num_workers << ", episodes per worker: " << episodes_per_worker << std::endl;
+
+  double unpinned = run(cfg, topo, replicas, shared, num_workers, episodes_per_worker, false);
+  double pinned = run(cfg, topo, replicas, shared, num_workers, episodes_per_worker, true);
+
+  std::cout << "unpinned: " << unpinned << " ASTs/s" << std::endl;
+  std::cout << "pinned:   " << pinned << " ASTs/s" << std::endl;
+  std::cout << "speedup:  " << pinned / unpinned << "x" << std::endl;
+  return 0;
+}
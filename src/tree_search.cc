@@ -1,20 +1,23 @@
+#include <chrono>
 #include <iostream>
 
 #include "cpptoml.hpp"
 #include "symreg.hpp"
 
-int main(int argc, char* argv[]) {
-  
-  if (argc < 2) {
-    std::cerr << "Error: Must pass a .toml config file path" << std::endl;
-    return 1;
+/**
+ * @brief runs a search whose scorer, leaf picker and loss function are
+ * fixed at compile time by Policy and prints what it found
+ */
+template <class Policy>
+int search(symreg::util::config& cfg, symreg::dataset& ds) {
+  symreg::MCTS::MCTS<symreg::DNN, Policy> mcts(ds, nullptr, cfg);
+  int time_limit_ms = cfg.get_or<int>("mcts.time_limit_ms", 0);
+  if (time_limit_ms > 0) {
+    mcts.iterate(std::chrono::steady_clock::now() + std::chrono::milliseconds(time_limit_ms));
+  } else {
+    mcts.iterate();
   }
 
-  symreg::util::config cfg(cpptoml::parse_file(argv[1]));
-  symreg::dataset ds = symreg::generate_dataset(cfg);
-  symreg::MCTS::MCTS<symreg::DNN> mcts(ds, nullptr, cfg);
-  mcts.iterate();
-
   symreg::loss_fn::MSE loss;
 
   std::cout << "Searching for expressions fitting data generated from f(x) = ";
@@ -32,6 +35,38 @@ int main(int argc, char* argv[]) {
     i--;
   }
 
+  if (mcts.was_stopped()) {
+    std::cout << std::endl << "Stopped at the time limit, returning "
+      << mcts.get_deadline_overshoot().count() / 1000 << "us late" << std::endl;
+  }
+
+  if (cfg.get_or<int>("mcts.pipeline_evaluators", 0) > 0) {
+    std::cout << std::endl << "Pipeline: " << mcts.get_pipeline_stats().to_string() << std::endl;
+  }
+
+  if (cfg.get_or<bool>("mcts.semantic_dedup", false)) {
+    std::cout << std::endl << mcts.get_num_equivalent()
+      << " of the explored ASTs computed the same function as an earlier one" << std::endl;
+  }
+
+  if (cfg.get_or<bool>("mcts.fit_constants", false)) {
+    std::cout << std::endl << mcts.get_num_evaluations() << " evaluations of the dataset, "
+      << mcts.get_num_evaluations() - mcts.get_num_explored() << " of them fitting constants" << std::endl;
+  }
+
   return 0;
 }
 
+int main(int argc, char* argv[]) {
+  
+  if (argc < 2) {
+    std::cerr << "Error: Must pass a .toml config file path" << std::endl;
+    return 1;
+  }
+
+  symreg::util::config cfg(cpptoml::parse_file(argv[1]));
+  symreg::dataset ds = symreg::generate_dataset(cfg);
+  return symreg::MCTS::with_search_policy(cfg, [&](auto policy) {
+    return search<decltype(policy)>(cfg, ds);
+  });
+}
@@ -1,4 +1,8 @@
+#include <chrono>
 #include <iostream>
+#include <sstream>
+#include <thread>
+#include <type_traits>
 
 #include "symreg.hpp"
 #include "gtest/gtest.h"
@@ -54,6 +58,300 @@ TEST(Reset, ResultsInRootOnlyState) {
   ASSERT_TRUE(ast->to_string() == "+");
 }
 
+TEST(Iterate, StopsAtDeadline) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 12, 2, nullptr);
+
+  auto mcts = symreg::MCTS::MCTS(ds, sim, 100000000);
+  auto start = std::chrono::steady_clock::now();
+  mcts.iterate(start + std::chrono::milliseconds(50));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_TRUE(mcts.was_stopped());
+  ASSERT_LT(elapsed, std::chrono::seconds(2));
+  ASSERT_LT(mcts.get_deadline_overshoot(), std::chrono::seconds(1));
+  ASSERT_GT(mcts.get_num_explored(), 0);
+  auto ast = mcts.get_result();
+  ASSERT_EQ(ast->get_num_unconnected(), 0);
+}
+
+TEST(Iterate, StopsWhenCancelled) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 12, 2, nullptr);
+
+  auto mcts = symreg::MCTS::MCTS(ds, sim, 100000000);
+  symreg::MCTS::cancel_token token;
+  std::thread canceller([token]() mutable {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    token.cancel();
+  });
+  mcts.iterate(token);
+  canceller.join();
+
+  ASSERT_TRUE(mcts.was_stopped());
+  ASSERT_EQ(mcts.get_deadline_overshoot().count(), 0);
+  ASSERT_FALSE(mcts.get_top_n_asts().empty());
+}
+
+TEST(Iterate, AlreadyCancelledStillGivesValidAST) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 5, 2, nullptr);
+
+  auto mcts = symreg::MCTS::MCTS(ds, sim, 200);
+  symreg::MCTS::cancel_token token;
+  token.cancel();
+  mcts.iterate(token);
+
+  ASSERT_TRUE(mcts.was_stopped());
+  ASSERT_EQ(mcts.get_num_explored(), 0);
+  ASSERT_EQ(mcts.get_result()->get_num_unconnected(), 0);
+}
+
+symreg::MCTS::MCTS<symreg::DNN> budget_test_search(symreg::dataset& ds,
+    std::shared_ptr<symreg::constant_fitter> fitter = nullptr, int num_simulations = 50) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 9, 2, nullptr);
+  sim.set_constant_fitter(fitter);
+  return symreg::MCTS::MCTS<symreg::DNN>(ds, sim, num_simulations);
+}
+
+TEST(Budget, PerMoveBudgetRunsItsSimulations) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  // the search is built with 50 simulations per move
+  auto mcts = budget_test_search(ds);
+  mcts.set_budget(symreg::MCTS::search_budget::per_move(7));
+  mcts.simulate();
+  ASSERT_EQ(mcts.get_num_explored(), 7);
+
+  auto game = budget_test_search(ds);
+  game.iterate(symreg::MCTS::search_budget::per_move(7));
+  auto num_rounds = game.get_current_node().get_depth() + 1;
+  ASSERT_GT(game.get_num_explored(), 0);
+  ASSERT_LE(game.get_num_explored(), 7 * num_rounds);
+}
+
+TEST(Budget, RolloutBudgetIsSpentExactly) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto mcts = budget_test_search(ds);
+  mcts.iterate(symreg::MCTS::search_budget::rollouts(1234));
+  ASSERT_EQ(mcts.get_num_explored(), 1234);
+  ASSERT_EQ(mcts.get_result()->get_num_unconnected(), 0);
+}
+
+TEST(Budget, RolloutBudgetWithoutMoves) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto mcts = budget_test_search(ds);
+  mcts.iterate(symreg::MCTS::search_budget::rollouts(500, false));
+  ASSERT_EQ(mcts.get_num_explored(), 500);
+  ASSERT_TRUE(mcts.get_training_examples().empty());
+  ASSERT_FALSE(mcts.get_top_n_asts().empty());
+}
+
+TEST(Budget, PointEvaluationBudgetReservesFinalScoring) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto mcts = budget_test_search(ds);
+  mcts.iterate(symreg::MCTS::search_budget::point_evaluations(1000 * ds.x.size() + 3));
+  ASSERT_EQ(mcts.get_num_explored(), 999);
+  ASSERT_EQ(mcts.get_num_evaluations(), 999);
+}
+
+TEST(Budget, PointEvaluationBudgetChargesConstantFitting) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto mcts = budget_test_search(ds, std::make_shared<symreg::constant_fitter>("lm", 5));
+  mcts.iterate(symreg::MCTS::search_budget::point_evaluations(1000 * ds.x.size() + 3));
+  ASSERT_GE(mcts.get_num_evaluations(), 999);
+  ASSERT_LT(mcts.get_num_explored(), 999);
+}
+
+TEST(Budget, TimeBudgetIsSpreadOverMoves) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto mcts = budget_test_search(ds);
+  auto start = std::chrono::steady_clock::now();
+  mcts.iterate(symreg::MCTS::search_budget::seconds(.1));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_GE(elapsed, std::chrono::milliseconds(100));
+  ASSERT_LT(mcts.get_deadline_overshoot(), std::chrono::seconds(1));
+  ASSERT_FALSE(mcts.was_stopped());
+  ASSERT_EQ(mcts.get_result()->get_num_unconnected(), 0);
+}
+
+TEST(MoveAllocator, DecidesOnceLeaderCantBeOvertaken) {
+  symreg::search_node parent(std::make_unique<brick::AST::posit_node>());
+  parent.add_child(std::make_unique<brick::AST::addition_node>());
+  parent.add_child(std::make_unique<brick::AST::multiplication_node>());
+  parent.get_children()[0].set_n(30);
+  parent.get_children()[1].set_n(10);
+  symreg::MCTS::move_allocator allocator(true, 1, 8, 8);
+  ASSERT_FALSE(allocator.is_decided(parent, 20, .999));
+  ASSERT_TRUE(allocator.is_decided(parent, 19, .999));
+}
+
+TEST(MoveAllocator, DecidesOnVisitShare) {
+  symreg::search_node parent(std::make_unique<brick::AST::posit_node>());
+  parent.add_child(std::make_unique<brick::AST::addition_node>());
+  parent.add_child(std::make_unique<brick::AST::multiplication_node>());
+  parent.get_children()[0].set_n(80);
+  parent.get_children()[1].set_n(20);
+  ASSERT_TRUE(symreg::MCTS::move_allocator(true, .8, 8, 8).is_decided(parent, 1000, .999));
+  ASSERT_FALSE(symreg::MCTS::move_allocator(true, .9, 8, 8).is_decided(parent, 1000, .999));
+  ASSERT_FALSE(symreg::MCTS::move_allocator(true, .8, 8, 200).is_decided(parent, 1000, .999));
+}
+
+TEST(MoveAllocator, IgnoresWeakTerminals) {
+  symreg::search_node parent(std::make_unique<brick::AST::posit_node>());
+  parent.add_child(std::make_unique<brick::AST::number_node>(1));
+  parent.add_child(std::make_unique<brick::AST::addition_node>());
+  parent.get_children()[0].set_n(90);
+  parent.get_children()[0].set_q(.1);
+  parent.get_children()[1].set_n(10);
+  symreg::MCTS::move_allocator allocator(true, .8, 8, 8);
+  ASSERT_FALSE(allocator.is_decided(parent, 1000, .999));
+}
+
+TEST(MoveAllocator, DecidesBetweenWeakTerminalsWithoutOtherMoves) {
+  symreg::search_node parent(std::make_unique<brick::AST::posit_node>());
+  parent.add_child(std::make_unique<brick::AST::number_node>(1));
+  parent.add_child(std::make_unique<brick::AST::number_node>(2));
+  parent.get_children()[0].set_n(90);
+  parent.get_children()[0].set_q(.1);
+  parent.get_children()[1].set_n(10);
+  parent.get_children()[1].set_q(.1);
+  symreg::MCTS::move_allocator allocator(true, .8, 8, 8);
+  ASSERT_TRUE(allocator.is_decided(parent, 1000, .999));
+}
+
+TEST(MoveAllocator, CarriesUnusedSimulationsForward) {
+  symreg::MCTS::move_allocator allocator(true);
+  ASSERT_EQ(allocator.allocate(100), 100);
+  allocator.give_back(60);
+  ASSERT_EQ(allocator.get_carry(), 60);
+  ASSERT_EQ(allocator.allocate(100), 160);
+  ASSERT_EQ(allocator.get_carry(), 0);
+}
+
+TEST(Iterate, AdaptiveMovesStopEarly) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto mcts = budget_test_search(ds, nullptr, 1000);
+  mcts.set_move_allocator(symreg::MCTS::move_allocator(true, 0, 16, 16));
+  mcts.iterate();
+  ASSERT_GT(mcts.get_move_allocator().get_carry(), 0);
+  ASSERT_EQ(mcts.get_result()->get_num_unconnected(), 0);
+
+  // the same search without the allocator runs every move's simulations
+  auto fixed = budget_test_search(ds, nullptr, 1000);
+  fixed.set_move_allocator(symreg::MCTS::move_allocator(false, 0, 16, 16));
+  fixed.iterate();
+  ASSERT_EQ(fixed.get_move_allocator().get_carry(), 0);
+  ASSERT_LT(mcts.get_num_explored(), fixed.get_num_explored() / 2);
+}
+
+symreg::util::config policy_config(std::string scorer, std::string picker, std::string loss) {
+  std::istringstream toml("[mcts]\nscorer = \"" + scorer + "\"\nleaf_picker = \"" + picker
+    + "\"\nloss_fn = \"" + loss + "\"\n");
+  cpptoml::parser parser(toml);
+  return symreg::util::config(parser.parse());
+}
+
+TEST(Simulate, PartitionsEveryMoveWithWidening) {
+  auto ds = symreg::generate_dataset([](int x) { return x * x * x; }, 5, 1, 50);
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 5, 2, nullptr);
+  sim.set_widening_rule(symreg::MCTS::widening_rule{1, .5});
+  symreg::MCTS::MCTS<symreg::DNN> mcts(ds, sim, 50);
+
+  mcts.simulate(1, 3);
+  auto& current = mcts.get_current_node();
+  ASSERT_FALSE(current.has_pending());
+  ASSERT_EQ(current.get_children().size(), af.get_set(100).size());
+  // every child of this partition got its share, the others none
+  for (std::size_t i = 0; i < current.get_children().size(); i++) {
+    if (i % 3 == 1) {
+      ASSERT_GT(current.get_children()[i].get_n(), 0) << i;
+    } else {
+      ASSERT_EQ(current.get_children()[i].get_n(), 0) << i;
+    }
+  }
+}
+
+TEST(SearchPolicy, DispatchesOnConfiguredNames) {
+  namespace scorer = symreg::MCTS::scorer;
+  namespace leaf_picker = symreg::MCTS::simulator::leaf_picker;
+  auto cfg = policy_config("UCB1", "recursive_heuristic_child_picker<UCB1>", "NRMSD");
+  bool matched = symreg::MCTS::with_search_policy(cfg, [](auto policy) {
+    using P = decltype(policy);
+    return std::is_same_v<typename P::scorer_type, scorer::UCB1>
+      && std::is_same_v<typename P::leaf_picker_type, leaf_picker::recursive_heuristic_child_picker<scorer::UCB1>>
+      && std::is_same_v<typename P::loss_type, symreg::loss_fn::NRMSD>;
+  });
+  ASSERT_TRUE(matched);
+
+  cfg = policy_config("UCB1", "random_leaf", "MASE");
+  matched = symreg::MCTS::with_search_policy(cfg, [](auto policy) {
+    using P = decltype(policy);
+    return std::is_same_v<typename P::leaf_picker_type, leaf_picker::random_leaf_picker>
+      && std::is_same_v<typename P::loss_type, symreg::loss_fn::MAE>;
+  });
+  ASSERT_TRUE(matched);
+}
+
+TEST(SearchPolicy, StaticPolicyPicksLikeDynamicPolicy) {
+  using picker_type = symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>;
+  symreg::search_node parent(std::make_unique<brick::AST::posit_node>());
+  parent.set_n(60);
+  for (int i = 0; i < 6; i++) {
+    parent.add_child(std::make_unique<brick::AST::number_node>(i));
+    parent.get_children().back().set_n(i % 3 + 1);
+    parent.get_children().back().set_q(i % 2 ? .5 : .25);
+  }
+  picker_type static_picker;
+  std::shared_ptr<symreg::MCTS::simulator::leaf_picker::leaf_picker> dynamic_picker =
+    std::make_shared<picker_type>();
+  for (int seed = 0; seed < 10; seed++) {
+    symreg::mt.seed(seed);
+    auto expected = dynamic_picker->pick(&parent);
+    symreg::mt.seed(seed);
+    ASSERT_EQ(static_picker.pick(&parent), expected);
+  }
+}
+
+TEST(SearchPolicy, StaticPolicySearchResultsInValidASTs) {
+  using static_policy = symreg::MCTS::search_policy<
+    symreg::MCTS::scorer::UCB1,
+    symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>,
+    symreg::loss_fn::NRMSD
+  >;
+  auto ds = symreg::generate_dataset([](int x) { return x * x; }, 5, 1, 20);
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN, static_policy> sim(
+    std::make_shared<static_policy::scorer_type>(),
+    std::make_shared<static_policy::loss_type>(),
+    std::make_shared<static_policy::leaf_picker_type>(),
+    af, ds, 7, 2, nullptr);
+  symreg::MCTS::MCTS<symreg::DNN, static_policy> mcts(ds, sim, 100);
+  mcts.iterate();
+
+  ASSERT_GT(mcts.get_num_explored(), 0);
+  ASSERT_EQ(mcts.get_result()->get_num_unconnected(), 0);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -1,5 +1,7 @@
 #include <iostream>
+#include <sstream>
 
+#include "cpptoml.hpp"
 #include "symreg.hpp"
 #include "gtest/gtest.h"
 
@@ -31,6 +33,55 @@ TEST(GetRandom, BasicSanityCheck) {
   ASSERT_TRUE(str.size());
 }
 
+TEST(ActionFactory, ReadsFunctionsFromConfig) {
+  std::istringstream toml(
+    "[actions]\nbinary = [\"addition\"]\nunary = []\nfunctions = [\"sin\", \"exp\"]\n"
+    "vars = [\"x\"]\nscalar_min = 1\nscalar_max = 2\n");
+  cpptoml::parser parser(toml);
+  symreg::util::config cfg(parser.parse());
+  action_factory af(cfg);
+  ASSERT_EQ(af.max_set_size(), 6);
+
+  std::vector<std::string> unary;
+  for (auto& action : af.get_set(1)) {
+    if (action->num_children() == 1) {
+      unary.push_back(action->to_string());
+    }
+  }
+  ASSERT_EQ(unary, std::vector<std::string>({"sin", "exp"}));
+  for (auto& action : af.get_set(0)) {
+    ASSERT_EQ(action->num_children(), 0);
+  }
+
+  std::istringstream unknown(
+    "[actions]\nbinary = []\nunary = []\nfunctions = [\"gamma\"]\n"
+    "vars = [\"x\"]\nscalar_min = 1\nscalar_max = 2\n");
+  cpptoml::parser unknown_parser(unknown);
+  symreg::util::config unknown_cfg(unknown_parser.parse());
+  ASSERT_ANY_THROW(action_factory{unknown_cfg});
+}
+
+TEST(ActionFactory, RolloutsWithFunctionsEvaluate) {
+  std::istringstream toml(
+    "[actions]\nbinary = [\"addition\", \"multiplication\"]\nunary = []\n"
+    "functions = [\"sin\", \"cos\", \"exp\", \"log\", \"sqrt\"]\n"
+    "vars = [\"x\"]\nscalar_min = 1\nscalar_max = 3\n");
+  cpptoml::parser parser(toml);
+  symreg::util::config cfg(parser.parse());
+  action_factory af(cfg);
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  symreg::loss_fn::MSE mse;
+  bool saw_function = false;
+  for (int i = 0; i < 200; i++) {
+    symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+    auto ast = symreg::MCTS::simulator::rollout(&root, 8, af);
+    ASSERT_EQ(ast->get_num_unconnected(), 0);
+    saw_function = saw_function || ast->to_string().find('(') != std::string::npos;
+    ASSERT_GE(mse.loss(ds, ast), 0);
+  }
+  ASSERT_TRUE(saw_function);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <thread>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+using elem_type = std::pair<int, double>;
+
+static auto cmp = [](const elem_type& lhs, const elem_type& rhs) {
+  return lhs.second > rhs.second;
+};
+
+static auto sign = [](const elem_type& elem) {
+  return elem.first;
+};
+
+static auto key = [](const elem_type& elem) {
+  return elem.second;
+};
+
+using queue_type = symreg::concurrent_priority_queue<elem_type,
+  decltype(cmp), decltype(sign), decltype(key)>;
+
+TEST(Push, KeepsOnlyTheTopN) {
+  queue_type q(cmp, sign, key, 3, 2);
+  for (int i = 0; i < 10; i++) {
+    q.push(std::make_pair(i, static_cast<double>(i)));
+  }
+  auto snap = q.snapshot();
+  ASSERT_EQ(snap.size(), 3);
+  ASSERT_EQ(snap[0].first, 7);
+  ASSERT_EQ(snap[1].first, 8);
+  ASSERT_EQ(snap[2].first, 9);
+}
+
+TEST(Push, IgnoresDuplicateSignatures) {
+  queue_type q(cmp, sign, key, 3, 1);
+  q.push(std::make_pair(1, 5.0));
+  q.push(std::make_pair(1, 6.0));
+  q.push(std::make_pair(2, 1.0));
+  auto snap = q.snapshot();
+  ASSERT_EQ(snap.size(), 2);
+  ASSERT_EQ(snap.back().second, 5.0);
+}
+
+TEST(Push, RaisesAdmissionThresholdWhenFull) {
+  queue_type q(cmp, sign, key, 2, 1);
+  ASSERT_TRUE(q.admits(std::make_pair(0, -1e300)));
+  q.push(std::make_pair(1, 4.0));
+  q.push(std::make_pair(2, 5.0));
+  ASSERT_EQ(q.get_threshold(), 4.0);
+  ASSERT_FALSE(q.admits(std::make_pair(3, 3.0)));
+  q.push(std::make_pair(4, 6.0));
+  ASSERT_EQ(q.get_threshold(), 5.0);
+}
+
+TEST(Snapshot, IsNonDestructive) {
+  queue_type q(cmp, sign, key, 5, 2);
+  q.push(std::make_pair(1, 1.0));
+  q.push(std::make_pair(2, 2.0));
+  auto first = q.snapshot();
+  auto second = q.snapshot();
+  ASSERT_EQ(first.size(), 2);
+  ASSERT_EQ(first, second);
+}
+
+TEST(Clear, EmptiesQueueAndResetsThreshold) {
+  queue_type q(cmp, sign, key, 1, 1);
+  q.push(std::make_pair(1, 1.0));
+  q.clear();
+  ASSERT_TRUE(q.snapshot().empty());
+  ASSERT_TRUE(q.admits(std::make_pair(2, 0.0)));
+}
+
+TEST(Push, ConcurrentPushesYieldExactTopN) {
+  const int num_threads = 8;
+  const int per_thread = 5000;
+  queue_type q(cmp, sign, key, 10);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&q, t, per_thread]() {
+      for (int i = 0; i < per_thread; i++) {
+        int id = i * num_threads + t;
+        q.push(std::make_pair(id, static_cast<double>(id)));
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  auto snap = q.snapshot();
+  ASSERT_EQ(snap.size(), 10);
+  int total = num_threads * per_thread;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(snap[i].first, total - 10 + i);
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
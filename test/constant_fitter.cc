@@ -0,0 +1,90 @@
+#include <iostream>
+#include <sstream>
+
+#include "cpptoml.hpp"
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+TEST(ConstantFitter, FitsLinearConstants) {
+  auto ds = symreg::generate_dataset([](int x) { return 5.25 * x - 1.5; }, 10, -5, 5);
+  for (std::string method : {"lm", "bfgs"}) {
+    symreg::constant_fitter fitter(method, 100);
+    auto ast = brick::AST::parse("(2*x)-3");
+    auto fitted = fitter.fit(*ast, ds);
+    ASSERT_TRUE(fitted) << method;
+    for (std::size_t i = 0; i < ds.x.size(); i++) {
+      ASSERT_NEAR(fitted->eval(ds.x[i]), ds.y[i], 1e-3) << method;
+    }
+  }
+}
+
+TEST(ConstantFitter, FitsExponents) {
+  auto ds = symreg::generate_dataset([](int x) { return std::pow(x, 2.5); }, 8, 1, 9);
+  symreg::constant_fitter fitter("lm", 100);
+  auto ast = brick::AST::parse("x^2");
+  auto fitted = fitter.fit(*ast, ds);
+  ASSERT_TRUE(fitted);
+  ASSERT_NEAR(fitted->eval(4), 32, 1e-3);
+}
+
+TEST(ConstantFitter, LeavesExpressionsWithoutNumbersAlone) {
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  symreg::constant_fitter fitter;
+  auto ast = brick::AST::parse("x*x");
+  ASSERT_FALSE(fitter.fit(*ast, ds));
+}
+
+TEST(ConstantFitter, CountsPassesOverTheDataset) {
+  auto ds = symreg::generate_dataset([](int x) { return 5.25 * x - 1.5; }, 10, -5, 5);
+  for (std::string method : {"lm", "bfgs"}) {
+    symreg::constant_fitter fitter(method, 100);
+    std::size_t num_passes = 0;
+    auto ast = brick::AST::parse("(2*x)-3");
+    ASSERT_TRUE(fitter.fit(*ast, ds, &num_passes)) << method;
+    ASSERT_GT(num_passes, 1) << method;
+
+    auto unfittable = brick::AST::parse("x*x");
+    ASSERT_FALSE(fitter.fit(*unfittable, ds, &num_passes)) << method;
+    ASSERT_EQ(num_passes, 0) << method;
+  }
+}
+
+TEST(ConstantFitter, ReadsConfig) {
+  std::istringstream toml("[mcts]\nfit_method = \"bfgs\"\nfit_iterations = 7\n");
+  cpptoml::parser parser(toml);
+  symreg::util::config cfg(parser.parse());
+  auto fitter = symreg::constant_fitter::from_config(cfg);
+  ASSERT_EQ(fitter.get_method(), "bfgs");
+  ASSERT_EQ(fitter.get_max_iterations(), 7);
+  ASSERT_ANY_THROW(symreg::constant_fitter("newton"));
+}
+
+TEST(ConstantFitter, SimulationFitsPromisingRollouts) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return 2.5 * x; }, 10, 1, 11);
+  auto loss = std::make_shared<symreg::loss_fn::MSE>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 4, 2, nullptr);
+  sim.set_constant_fitter(std::make_shared<symreg::constant_fitter>("lm", 50));
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 1000);
+  // fitting evaluates the dataset on top of every leaf's rollout
+  ASSERT_GT(sim.get_num_evaluations(), sim.get_num_explored());
+
+  auto best = sim.dump_scored_pri_q();
+  ASSERT_FALSE(best.empty());
+  double top = best.front().second;
+  for (auto& elem : best) {
+    top = std::max(top, elem.second);
+  }
+  // unfitted, nothing within depth 4 comes close to 2.5*x
+  ASSERT_GT(top, 1 - 1e-6);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+// a regressor whose value is the length of the state it's handed
+struct length_regressor {
+  std::mutex mtx;
+  std::vector<std::size_t> batch_sizes;
+  std::pair<double, std::vector<double>> inference(std::string state) {
+    return std::make_pair(1.0 / state.size(), std::vector<double>{});
+  }
+  std::vector<std::pair<double, std::vector<double>>> inference_batch(const std::vector<std::string>& states) {
+    std::lock_guard<std::mutex> lock(mtx);
+    batch_sizes.push_back(states.size());
+    std::vector<std::pair<double, std::vector<double>>> results;
+    for (auto& state : states) {
+      results.push_back(std::make_pair(1.0 / state.size(), std::vector<double>{}));
+    }
+    return results;
+  }
+};
+
+symreg::sim_task offload_twice(symreg::thread_pool& pool, symreg::serial_scheduler& sched,
+    std::vector<std::thread::id>& resumed_on, int& sum) {
+  for (int i = 1; i <= 2; i++) {
+    sum += co_await symreg::offload(pool, sched, [i] { return i * 10; });
+    resumed_on.push_back(std::this_thread::get_id());
+  }
+}
+
+symreg::sim_task offload_throw(symreg::thread_pool& pool, symreg::serial_scheduler& sched) {
+  co_await symreg::offload(pool, sched, []() -> int { throw std::runtime_error("boom"); });
+}
+
+TEST(Offload, ResumesOnTheSchedulingThread) {
+  symreg::thread_pool pool(2);
+  symreg::serial_scheduler sched;
+  std::vector<std::thread::id> resumed_on;
+  int sum = 0;
+  auto task = offload_twice(pool, sched, resumed_on, sum);
+  task.start();
+  while (!task.done()) {
+    sched.run_one();
+  }
+  ASSERT_EQ(sum, 30);
+  ASSERT_EQ(resumed_on.size(), 2);
+  for (auto id : resumed_on) {
+    ASSERT_EQ(id, std::this_thread::get_id());
+  }
+}
+
+TEST(Offload, ExceptionsEscapeTheTask) {
+  symreg::thread_pool pool(1);
+  symreg::serial_scheduler sched;
+  auto task = offload_throw(pool, sched);
+  task.start();
+  while (!task.done()) {
+    sched.run_one();
+  }
+  ASSERT_THROW(task.rethrow_if_failed(), std::runtime_error);
+}
+
+TEST(SimulateCoroutines, RolloutsAreAllBackpropagated) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  ds.x = {1, 2, 3};
+  ds.y = {4, 5, 6};
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>(symreg::MCTS::scorer::UCB1{});
+  symreg::MCTS::simulator::action_factory af;
+
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 8, 2, nullptr);
+  sim.set_coroutines(8, std::make_shared<symreg::thread_pool>(3));
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 200);
+
+  ASSERT_GT(sim.get_num_explored(), 0);
+  ASSERT_GE(root.get_n(), static_cast<int>(sim.get_num_explored()));
+  ASSERT_FALSE(sim.dump_pri_q().empty());
+}
+
+TEST(SimulateCoroutines, InferenceIsBatchedAcrossSuspendedSimulations) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>(symreg::MCTS::scorer::UCB1{});
+  symreg::MCTS::simulator::action_factory af;
+  length_regressor regr;
+
+  symreg::MCTS::simulator::simulator<length_regressor> sim(mab, loss, lp, af, ds, 8, 2, &regr);
+  auto broker = std::make_shared<symreg::inference_broker<length_regressor>>(
+    &regr, 4, std::chrono::seconds(10));
+  sim.set_inference_broker(broker);
+  sim.set_coroutines(4);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 40);
+
+  ASSERT_EQ(broker->get_num_requests(), sim.get_num_explored());
+  ASSERT_LT(broker->get_num_batches(), broker->get_num_requests());
+  ASSERT_GE(root.get_n(), static_cast<int>(sim.get_num_explored()));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
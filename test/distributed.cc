@@ -0,0 +1,145 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+using namespace symreg::distributed;
+
+TEST(Wire, VarintsRoundTrip) {
+  writer out;
+  std::vector<std::uint64_t> vals = {0, 1, 127, 128, 300, 1ull << 35, ~0ull};
+  for (auto val : vals) {
+    out.put_varint(val);
+  }
+  reader in(out.bytes());
+  for (auto val : vals) {
+    ASSERT_EQ(in.get_varint(), val);
+  }
+  ASSERT_TRUE(in.at_end());
+}
+
+TEST(Wire, ReportsRoundTripCompactly) {
+  report_msg msg;
+  msg.num_explored = 1234;
+  msg.game_over = true;
+  msg.children = {{3, .5, false}, {200, .25, true}};
+  msg.candidates = {{"+x", .75}, {"+*xx", -2}};
+  writer out;
+  encode(out, msg);
+  // 2 + 1 + 1 + (1 + 8 + 1) + (2 + 8 + 1) + 1 + (1 + 2 + 8) + (1 + 4 + 8)
+  ASSERT_EQ(out.bytes().size(), 50);
+
+  report_msg back;
+  reader in(out.bytes());
+  decode(in, back);
+  ASSERT_TRUE(in.at_end());
+  ASSERT_EQ(back.num_explored, 1234);
+  ASSERT_FALSE(back.found_within_thresh);
+  ASSERT_TRUE(back.game_over);
+  ASSERT_EQ(back.children.size(), 2);
+  ASSERT_EQ(back.children[1].n, 200);
+  ASSERT_DOUBLE_EQ(back.children[1].q, .25);
+  ASSERT_TRUE(back.children[1].terminal);
+  ASSERT_EQ(back.candidates[1].expr, "+*xx");
+  ASSERT_DOUBLE_EQ(back.candidates[1].reward, -2);
+}
+
+TEST(Wire, TruncatedMessagesThrow) {
+  round_msg msg;
+  writer out;
+  encode(out, msg);
+  std::vector<std::uint8_t> truncated(out.bytes().begin(), out.bytes().end() - 1);
+  reader in(truncated);
+  ASSERT_ANY_THROW(decode(in, msg));
+}
+
+TEST(ChooseMove, PrefersVisitsAndAvoidsWeakTerminals) {
+  std::vector<child_stats> children = {{5, .1, false}, {9, .2, true}, {7, .3, false}};
+  ASSERT_EQ(symreg::distributed::choose_move(children, .999), 2);
+  children[1].q = 1;
+  ASSERT_EQ(symreg::distributed::choose_move(children, .999), 1);
+  ASSERT_EQ(symreg::distributed::choose_move({{1, 0, true}}, .999), 0);
+  ASSERT_EQ(symreg::distributed::choose_move({}, .999), -1);
+}
+
+// forks num_workers worker processes which connect to coord, then runs the
+// coordinator in this process. returns the number of workers which failed
+int run_loopback(coordinator& coord, int num_workers,
+    symreg::MCTS::widening_rule widening = symreg::MCTS::widening_rule{}) {
+  std::vector<pid_t> pids;
+  for (int i = 0; i < num_workers; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      int status = 0;
+      try {
+        auto ds = symreg::generate_dataset([](int x) { return x * x; }, 10, -5, 5);
+        auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+        auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+        auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>(symreg::MCTS::scorer::UCB1{});
+        symreg::MCTS::simulator::action_factory af;
+        symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 5, 2, nullptr);
+        sim.set_widening_rule(widening);
+        symreg::MCTS::MCTS<symreg::DNN> mcts(ds, sim, 50);
+        worker<symreg::DNN> w(mcts, coord.get_address());
+        w.run();
+      } catch (...) {
+        status = 1;
+      }
+      _exit(status);
+    }
+    pids.push_back(pid);
+  }
+  coord.run();
+  int failed = 0;
+  for (pid_t pid : pids) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  return failed;
+}
+
+TEST(Loopback, RootParallelOverTCP) {
+  coordinator coord("127.0.0.1:0", 3, 5);
+  ASSERT_NE(coord.get_address(), "127.0.0.1:0");
+  ASSERT_EQ(run_loopback(coord, 3), 0);
+
+  auto top_n = coord.get_top_n();
+  ASSERT_EQ(top_n.size(), 5);
+  for (std::size_t i = 1; i < top_n.size(); i++) {
+    ASSERT_LE(top_n[i - 1].reward, top_n[i].reward);
+  }
+  ASSERT_DOUBLE_EQ(coord.get_threshold(), top_n.front().reward);
+  ASSERT_GE(coord.get_num_explored(), 3 * 50 / 2);
+  ASSERT_GT(coord.get_num_moves(), 0);
+}
+
+TEST(Loopback, SubtreesOverUnixSockets) {
+  std::string path = "unix:symreg_test_" + std::to_string(getpid()) + ".sock";
+  coordinator coord(path, 2, 5, true);
+  ASSERT_EQ(run_loopback(coord, 2), 0);
+  ASSERT_FALSE(coord.get_top_n().empty());
+  ASSERT_GT(coord.get_num_explored(), 0);
+}
+
+TEST(Loopback, WorkersAgreeOnWidenedMoves) {
+  symreg::MCTS::widening_rule widening{1, .5};
+  coordinator root_parallel("127.0.0.1:0", 3, 5);
+  ASSERT_EQ(run_loopback(root_parallel, 3, widening), 0);
+  ASSERT_GT(root_parallel.get_num_moves(), 0);
+
+  std::string path = "unix:symreg_test_widening_" + std::to_string(getpid()) + ".sock";
+  coordinator subtrees(path, 2, 5, true);
+  ASSERT_EQ(run_loopback(subtrees, 2, widening), 0);
+  ASSERT_GT(subtrees.get_num_moves(), 0);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
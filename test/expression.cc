@@ -0,0 +1,234 @@
+#include <cmath>
+#include <iostream>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+TEST(Expression, EvaluatesLikeTheAST) {
+  std::vector<std::string> exprs = {"x^2-4*x+3", "-(x/3)", "(5+(1/4))*x", "2^x-x"};
+  std::vector<double> x = {-3, -1, .5, 2, 7};
+  for (auto& str : exprs) {
+    auto ast = brick::AST::parse(str);
+    symreg::expression expr(*ast);
+    std::vector<double> y_hat;
+    expr.eval(x, y_hat);
+    ASSERT_EQ(y_hat.size(), x.size());
+    for (std::size_t i = 0; i < x.size(); i++) {
+      ASSERT_DOUBLE_EQ(expr.eval(x[i]), ast->eval(x[i])) << str;
+      ASSERT_DOUBLE_EQ(y_hat[i], ast->eval(x[i])) << str;
+    }
+  }
+}
+
+TEST(Expression, EvaluatesFunctions) {
+  std::vector<std::string> exprs = {"sin(x)+cos(x*2)", "exp(x/3)", "log(x*x+1)", "sqrt(x*x)-3"};
+  std::vector<double> x = {-3, -1, .5, 2, 7};
+  for (auto& str : exprs) {
+    auto ast = brick::AST::parse(str);
+    symreg::expression expr(*ast);
+    std::vector<double> y_hat;
+    expr.eval(x, y_hat);
+    for (std::size_t i = 0; i < x.size(); i++) {
+      double y = ast->eval(x[i]);
+      ASSERT_NEAR(expr.eval(x[i]), y, 1e-14 * (1 + std::abs(y))) << str;
+      ASSERT_NEAR(y_hat[i], y, 1e-14 * (1 + std::abs(y))) << str;
+    }
+  }
+}
+
+TEST(Expression, NumbersAreParameters) {
+  auto ast = brick::AST::parse("3*x+4");
+  symreg::expression expr(*ast);
+  ASSERT_EQ(expr.num_params(), 2);
+  ASSERT_EQ(expr.get_params(), std::vector<double>({3, 4}));
+  expr.set_params({2, .5});
+  ASSERT_DOUBLE_EQ(expr.eval(2), 4.5);
+
+  // the AST is copied with the new values in place
+  auto fitted = expr.to_ast(*ast);
+  ASSERT_DOUBLE_EQ(fitted->eval(2), 4.5);
+  ASSERT_DOUBLE_EQ(ast->eval(2), 10);
+}
+
+TEST(Expression, DualDerivativesMatchFiniteDifferences) {
+  std::vector<std::string> exprs = {"3*x+4", "2^x/5", "x^3-(2/x)", "-(x*x*7)",
+    "sin(2*x)*exp(x/4)", "log(x+1)+sqrt(3*x)", "cos(x^2)"};
+  std::vector<double> x = {.5, 1.5, 3.0};
+  double h = 1e-6;
+  for (auto& str : exprs) {
+    auto ast = brick::AST::parse(str);
+    symreg::expression expr(*ast);
+    auto params = expr.get_params();
+    auto dual = expr.eval_dual(x);
+    ASSERT_EQ(dual.d_params.size(), params.size());
+    for (std::size_t i = 0; i < x.size(); i++) {
+      ASSERT_DOUBLE_EQ(dual.value[i], expr.eval(x[i]));
+      double d_x = (expr.eval(x[i] + h) - expr.eval(x[i] - h)) / (2 * h);
+      ASSERT_NEAR(dual.d_x[i], d_x, 1e-4 * (1 + std::abs(d_x))) << str;
+      for (std::size_t j = 0; j < params.size(); j++) {
+        auto up = params;
+        auto down = params;
+        up[j] += h;
+        down[j] -= h;
+        expr.set_params(up);
+        double f_up = expr.eval(x[i]);
+        expr.set_params(down);
+        double f_down = expr.eval(x[i]);
+        expr.set_params(params);
+        double d_param = (f_up - f_down) / (2 * h);
+        ASSERT_NEAR(dual.d_params[j][i], d_param, 1e-4 * (1 + std::abs(d_param))) << str;
+      }
+    }
+  }
+}
+
+TEST(Expression, DualDerivativesAreExact) {
+  auto ast = brick::AST::parse("x^2-4*x+3");
+  symreg::expression expr(*ast);
+  auto dual = expr.eval_dual({-2, 0, 1, 10}, false);
+  ASSERT_TRUE(dual.d_params.empty());
+  ASSERT_EQ(dual.d_x, std::vector<double>({-8, -4, -2, 16}));
+
+  // the base's infinite weight at 0 doesn't spill into the exponent's column
+  auto root = brick::AST::parse("x^0.5+2");
+  symreg::expression sqrt(*root);
+  auto at_zero = sqrt.eval_dual({0});
+  ASSERT_EQ(at_zero.d_params[0][0], 0);
+  ASSERT_EQ(at_zero.d_params[1][0], 1);
+}
+
+TEST(Expression, ProtectedOpsAgreeWhereDefined) {
+  std::vector<std::string> exprs = {"x^3-(2/x)", "(x-1)^2", "exp(x)", "log(x+4)", "sqrt(x+4)"};
+  std::vector<double> x = {-3, -1, .5, 2, 7};
+  for (auto& str : exprs) {
+    auto ast = brick::AST::parse(str);
+    std::vector<double> plain;
+    std::vector<double> guarded;
+    symreg::expression(*ast).eval(x, plain);
+    symreg::expression(*ast, true).eval(x, guarded);
+    ASSERT_EQ(plain, guarded) << str;
+  }
+}
+
+TEST(Expression, ProtectedOpsStayFinite) {
+  auto eval = [](const std::string& str, double x) {
+    auto ast = brick::AST::parse(str);
+    symreg::expression expr(*ast, true);
+    return expr.eval(x);
+  };
+  ASSERT_EQ(eval("1/(x-x)", 2), 1);
+  ASSERT_EQ(eval("x^0.5", -4), 2);
+  ASSERT_EQ(eval("x^3", -2), -8);
+  ASSERT_EQ(eval("x^(0-1)", 0), symreg::protected_limit);
+  ASSERT_EQ(eval("10^(x*1000)", 1), symreg::protected_limit);
+  ASSERT_EQ(eval("0-(10^(x*1000))", 1), -symreg::protected_limit);
+  ASSERT_EQ(eval("exp(x*1000)", 1), symreg::protected_limit);
+  ASSERT_EQ(eval("log(x-x)", 3), 0);
+  ASSERT_EQ(eval("sqrt(x)", -4), 2);
+
+  // without protection, they're not
+  auto ast = brick::AST::parse("1/(x-x)");
+  ASSERT_TRUE(std::isinf(symreg::expression(*ast).eval(2)));
+}
+
+TEST(Expression, ProtectedDualDerivativesMatchFiniteDifferences) {
+  std::vector<std::string> exprs = {"x^0.5", "sqrt(x)*x", "log(x)", "x^2/2", "2^x", "exp(x)/x"};
+  std::vector<double> x = {-3, -1.5, .5, 2};
+  double h = 1e-6;
+  for (auto& str : exprs) {
+    auto ast = brick::AST::parse(str);
+    symreg::expression expr(*ast, true);
+    auto params = expr.get_params();
+    auto dual = expr.eval_dual(x);
+    for (std::size_t i = 0; i < x.size(); i++) {
+      ASSERT_DOUBLE_EQ(dual.value[i], expr.eval(x[i]));
+      double d_x = (expr.eval(x[i] + h) - expr.eval(x[i] - h)) / (2 * h);
+      ASSERT_NEAR(dual.d_x[i], d_x, 1e-4 * (1 + std::abs(d_x))) << str << " at " << x[i];
+      for (std::size_t j = 0; j < params.size(); j++) {
+        auto up = params;
+        auto down = params;
+        up[j] += h;
+        down[j] -= h;
+        expr.set_params(up);
+        double f_up = expr.eval(x[i]);
+        expr.set_params(down);
+        double f_down = expr.eval(x[i]);
+        expr.set_params(params);
+        double d_param = (f_up - f_down) / (2 * h);
+        ASSERT_NEAR(dual.d_params[j][i], d_param, 1e-4 * (1 + std::abs(d_param))) << str << " at " << x[i];
+      }
+    }
+  }
+
+  // a guarded division is constant
+  auto ast = brick::AST::parse("x/(x-x)");
+  auto dual = symreg::expression(*ast, true).eval_dual({2});
+  ASSERT_EQ(dual.value[0], 1);
+  ASSERT_EQ(dual.d_x[0], 0);
+}
+
+TEST(Expression, OptimizedProgramsEvaluateTheSame) {
+  std::vector<std::string> exprs = {"x^2-4*x+3", "(5+(1/4))*x", "x^3+x^2*x^3", "x^(0-2)",
+    "(x*x)^2+x^2", "sin(2*3)*x", "x^2/(x^2+1)", "x^7-x^0+x^1", "2^x+x^2.5", "-(x^2)*x^2"};
+  std::vector<double> x = {-3, -1, 0, .5, 2, 7};
+  for (bool protect : {false, true}) {
+    for (auto& str : exprs) {
+      auto ast = brick::AST::parse(str);
+      symreg::expression plain(*ast, protect);
+      symreg::expression optimized(*ast, protect);
+      optimized.optimize();
+      std::vector<double> expected;
+      std::vector<double> y_hat;
+      plain.eval(x, expected);
+      optimized.eval(x, y_hat);
+      for (std::size_t i = 0; i < x.size(); i++) {
+        if (std::isnan(expected[i])) {
+          ASSERT_TRUE(std::isnan(y_hat[i])) << str;
+        } else if (std::isinf(expected[i])) {
+          ASSERT_EQ(y_hat[i], expected[i]) << str;
+        } else {
+          ASSERT_NEAR(y_hat[i], expected[i], 1e-14 * (1 + std::abs(expected[i]))) << str;
+        }
+      }
+    }
+  }
+}
+
+TEST(Expression, FoldsConstantsAndReducesPowers) {
+  auto count = [](const symreg::expression& expr, symreg::opcode op) {
+    std::size_t n = 0;
+    for (auto& ins : expr.get_program()) {
+      n += ins.op == op;
+    }
+    return n;
+  };
+  auto folded = brick::AST::parse("(5+(1/4))*x");
+  symreg::expression expr(*folded);
+  expr.optimize();
+  ASSERT_EQ(expr.get_program().size(), 3);
+  ASSERT_DOUBLE_EQ(expr.eval(2), 10.5);
+
+  // x^2 is computed once, x^3 and x^2.5 aren't shared
+  auto powers = brick::AST::parse("x^2+3*x^2-x^3+x^2.5");
+  symreg::expression reduced(*powers);
+  reduced.optimize();
+  ASSERT_EQ(count(reduced, symreg::opcode::pow), 1);
+  ASSERT_EQ(count(reduced, symreg::opcode::powi), 2);
+  ASSERT_EQ(count(reduced, symreg::opcode::store), 1);
+  ASSERT_EQ(count(reduced, symreg::opcode::load), 1);
+
+  // the parameters and derivatives still see every number
+  ASSERT_EQ(reduced.num_params(), 5);
+  auto dual = reduced.eval_dual({2});
+  ASSERT_EQ(dual.d_params.size(), 5);
+  auto params = reduced.get_params();
+  params[0] = 2.5;
+  reduced.set_params(params);
+  ASSERT_EQ(count(reduced, symreg::opcode::pow), 2);
+  ASSERT_DOUBLE_EQ(reduced.eval(4), 32 + 48 - 64 + 32);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,161 @@
+#include <iostream>
+#include <sstream>
+
+#include "cpptoml.hpp"
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+using AST = brick::AST::AST;
+using grammar = symreg::MCTS::simulator::grammar;
+
+// the AST nodes from ast up to the root, ast being the last one added
+std::vector<AST*> path_of(std::vector<std::shared_ptr<AST>>& path) {
+  std::vector<AST*> ancestors;
+  for (auto it = path.rbegin(); it != path.rend(); it++) {
+    ancestors.push_back(it->get());
+  }
+  return ancestors;
+}
+
+// appends node below the last AST node of path
+void extend(std::vector<std::shared_ptr<AST>>& path, std::unique_ptr<brick::AST::node> node, bool descend = true) {
+  auto child = path.back()->add_child(std::move(node));
+  if (descend) {
+    path.push_back(child);
+  }
+}
+
+std::vector<std::shared_ptr<AST>> start() {
+  return {std::make_shared<AST>(std::make_unique<brick::AST::posit_node>())};
+}
+
+TEST(Grammar, LimitsNestingPerOperator) {
+  grammar g;
+  g.set_max_nesting("exponentiation", 1);
+  auto path = start();
+  extend(path, std::make_unique<brick::AST::exponentiation_node>());
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::exponentiation_node()));
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::addition_node()));
+
+  // nor further down
+  extend(path, std::make_unique<brick::AST::addition_node>());
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::exponentiation_node()));
+}
+
+TEST(Grammar, ForbidsParentChildPairs) {
+  grammar g;
+  g.forbid("division", "division");
+  auto path = start();
+  extend(path, std::make_unique<brick::AST::division_node>());
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::division_node()));
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::multiplication_node()));
+
+  // only direct children are forbidden
+  extend(path, std::make_unique<brick::AST::multiplication_node>());
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::division_node()));
+}
+
+TEST(Grammar, RequiresAVariablePerSubtree) {
+  grammar g;
+  g.set_require_variable(true);
+  auto path = start();
+  extend(path, std::make_unique<brick::AST::addition_node>());
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::number_node(2)));
+  extend(path, std::make_unique<brick::AST::number_node>(2), false);
+  // 2+3 would be constant, 2+x isn't, and 2+(...) may still get a variable
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::number_node(3)));
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::id_node("x")));
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::multiplication_node()));
+}
+
+TEST(Grammar, LimitsConstantSubtreeSize) {
+  grammar g;
+  g.set_max_constant_size(3);
+  auto path = start();
+  extend(path, std::make_unique<brick::AST::exponentiation_node>());
+  extend(path, std::make_unique<brick::AST::number_node>(2), false);
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::number_node(3)));
+
+  // 2^(3^4) is constant and of size 5
+  extend(path, std::make_unique<brick::AST::exponentiation_node>());
+  extend(path, std::make_unique<brick::AST::number_node>(3), false);
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::number_node(4)));
+  ASSERT_TRUE(g.admits(path_of(path), brick::AST::id_node("x")));
+}
+
+TEST(Grammar, ReadsConstraintsFromConfig) {
+  std::istringstream toml(
+    "[actions]\nfunctions = []\n"
+    "[constraints]\nforbidden = [\"exponentiation > division\"]\nrequire_variable = true\n"
+    "[constraints.max_nesting]\nexponentiation = 1\n");
+  cpptoml::parser parser(toml);
+  symreg::util::config cfg(parser.parse());
+  grammar g(cfg);
+  ASSERT_TRUE(g.is_enabled());
+
+  auto path = start();
+  extend(path, std::make_unique<brick::AST::exponentiation_node>());
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::exponentiation_node()));
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::division_node()));
+  extend(path, std::make_unique<brick::AST::number_node>(2), false);
+  ASSERT_FALSE(g.admits(path_of(path), brick::AST::number_node(3)));
+
+  std::istringstream empty("[actions]\nfunctions = []\n");
+  cpptoml::parser empty_parser(empty);
+  symreg::util::config empty_cfg(empty_parser.parse());
+  ASSERT_FALSE(grammar(empty_cfg).is_enabled());
+}
+
+// the largest number of exponentiations on a path down from ast, or -1 if
+// some operator's subtree has no variable
+int check_shape(AST& ast) {
+  auto& node = *ast.get_node();
+  if (node.is_terminal()) {
+    return 0;
+  }
+  if (!symreg::MCTS::simulator::has_variable(ast)) {
+    return -1;
+  }
+  int nesting = 0;
+  for (auto& child : ast.get_children()) {
+    int child_nesting = check_shape(*child);
+    if (child_nesting < 0) {
+      return -1;
+    }
+    nesting = std::max(nesting, child_nesting);
+  }
+  return nesting + node.is_exponentiation();
+}
+
+TEST(Grammar, ExpansionAndRolloutsKeepToIt) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 9, 2, nullptr);
+  grammar g;
+  g.set_max_nesting("exponentiation", 1);
+  g.set_require_variable(true);
+  sim.set_grammar(g);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  ASSERT_TRUE(sim.add_actions(&root));
+  for (auto& child : root.get_children()) {
+    // +2 alone would be constant
+    ASSERT_FALSE(child.get_ast_node()->is_number());
+  }
+
+  for (int i = 0; i < 200; i++) {
+    auto ast = symreg::MCTS::simulator::rollout(&root, 9, af, &sim.get_grammar());
+    ASSERT_EQ(ast->get_num_unconnected(), 0);
+    int nesting = check_shape(*ast);
+    ASSERT_GE(nesting, 0) << ast->to_string();
+    ASSERT_LE(nesting, 1) << ast->to_string();
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
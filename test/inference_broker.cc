@@ -0,0 +1,104 @@
+#include <iostream>
+#include <mutex>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+// a regressor whose value is the length of the state it's handed
+struct length_regressor {
+  std::mutex mtx;
+  std::vector<std::size_t> batch_sizes;
+  std::size_t num_single = 0;
+  std::pair<double, std::vector<double>> inference(std::string state) {
+    std::lock_guard<std::mutex> lock(mtx);
+    num_single++;
+    return std::make_pair(1.0 / state.size(), std::vector<double>{});
+  }
+  std::vector<std::pair<double, std::vector<double>>> inference_batch(const std::vector<std::string>& states) {
+    std::lock_guard<std::mutex> lock(mtx);
+    batch_sizes.push_back(states.size());
+    std::vector<std::pair<double, std::vector<double>>> results;
+    for (auto& state : states) {
+      results.push_back(std::make_pair(1.0 / state.size(), std::vector<double>{}));
+    }
+    return results;
+  }
+};
+
+using broker_type = symreg::inference_broker<length_regressor>;
+
+TEST(Submit, FullBatchesAreDispatchedTogether) {
+  length_regressor regr;
+  broker_type broker(&regr, 4, std::chrono::seconds(10));
+  std::vector<std::future<broker_type::result_type>> futs;
+  for (int i = 1; i <= 8; i++) {
+    futs.push_back(broker.submit(std::string(i, 'a')));
+  }
+  for (int i = 1; i <= 8; i++) {
+    ASSERT_DOUBLE_EQ(futs[i - 1].get().first, 1.0 / i);
+  }
+  ASSERT_EQ(broker.get_num_batches(), 2);
+  ASSERT_EQ(broker.get_num_requests(), 8);
+}
+
+TEST(Submit, PartialBatchesAreDispatchedAfterTimeout) {
+  length_regressor regr;
+  broker_type broker(&regr, 100, std::chrono::milliseconds(5));
+  auto fut = broker.submit("abc");
+  ASSERT_DOUBLE_EQ(fut.get().first, 1.0 / 3);
+  ASSERT_EQ(broker.get_num_batches(), 1);
+}
+
+TEST(Flush, DispatchesPendingRequestsImmediately) {
+  length_regressor regr;
+  broker_type broker(&regr, 100, std::chrono::seconds(10));
+  auto fut1 = broker.submit("ab");
+  auto fut2 = broker.submit("abcd");
+  broker.flush();
+  ASSERT_EQ(fut1.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  ASSERT_DOUBLE_EQ(fut2.get().first, 0.25);
+  ASSERT_EQ(regr.batch_sizes.size(), 1);
+  ASSERT_EQ(regr.batch_sizes[0], 2);
+}
+
+TEST(Submit, CallbacksReceiveResults) {
+  length_regressor regr;
+  broker_type broker(&regr, 2, std::chrono::seconds(10));
+  std::promise<double> got;
+  broker.submit("abcd", [&got](std::exception_ptr error, broker_type::result_type result) {
+    got.set_value(error ? -1 : result.first);
+  });
+  auto fut = broker.submit("ab");
+  ASSERT_DOUBLE_EQ(got.get_future().get(), 0.25);
+  ASSERT_DOUBLE_EQ(fut.get().first, 0.5);
+  ASSERT_EQ(broker.get_num_batches(), 1);
+}
+
+TEST(Simulate, BatchesRegressorEvaluations) {
+  length_regressor regr;
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>(symreg::MCTS::scorer::UCB1{});
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<length_regressor> sim(mab, loss, lp, af, ds, 6, 2, &regr);
+  sim.set_inference_broker(std::make_shared<broker_type>(&regr, 8, std::chrono::seconds(10)));
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 64);
+
+  ASSERT_EQ(regr.num_single, 0);
+  ASSERT_EQ(sim.get_num_explored(), sim.get_inference_broker()->get_num_requests());
+  std::size_t largest = 0;
+  for (auto size : regr.batch_sizes) {
+    largest = std::max(largest, size);
+  }
+  ASSERT_GT(largest, 1);
+  ASSERT_GE(root.get_n(), static_cast<int>(sim.get_num_explored()));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -80,6 +80,72 @@ TEST(RHCP, PickReturnsLeafMaximizingHeuristic) {
   ASSERT_TRUE(leaf->get_ast_node()->to_string() == "2");
 }
 
+TEST(RHCP, PUCTPrefersUnvisitedNodesWithHigherPriors) {
+  symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker rhcp(symreg::MCTS::scorer::PUCT{});
+  symreg::search_node root(std::make_unique<brick::AST::number_node>(0));
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  root.add_child(std::make_unique<brick::AST::number_node>(2));
+  root.add_child(std::make_unique<brick::AST::number_node>(3));
+  root.get_children()[0].set_p(.2);
+  root.get_children()[1].set_p(.7);
+  root.get_children()[2].set_p(.1);
+
+  auto leaf = rhcp.pick(&root);
+  ASSERT_EQ(leaf->get_ast_node()->to_string(), "2");
+}
+
+TEST(RHCP, PUCTWeighsVisitsAgainstPriors) {
+  symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker rhcp(symreg::MCTS::scorer::PUCT{1});
+  symreg::search_node root(std::make_unique<brick::AST::number_node>(0));
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  root.add_child(std::make_unique<brick::AST::number_node>(2));
+  root.set_n(16);
+  auto& one = root.get_children().front();
+  one.set_p(.9);
+  one.set_n(15);
+  one.set_q(.1);
+  auto& two = root.get_children().back();
+  two.set_p(.1);
+
+  // 1: .1 + .9 * 4 / 16 = .325, 2: 0 + .1 * 4 / 1 = .4
+  auto leaf = rhcp.pick(&root);
+  ASSERT_EQ(leaf->get_ast_node()->to_string(), "2");
+}
+
+TEST(RHCP, PickSkipsSolvedSubtrees) {
+  symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker rhcp(symreg::MCTS::scorer::UCB1{});
+  symreg::search_node root(std::make_unique<brick::AST::number_node>(0));
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  root.add_child(std::make_unique<brick::AST::number_node>(2));
+  root.get_children()[0].set_solved(true, 1);
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(rhcp.pick(&root)->get_ast_node()->to_string(), "2");
+  }
+  root.get_children()[1].set_solved(true, 0);
+  ASSERT_EQ(rhcp.pick(&root), nullptr);
+}
+
+TEST(RHCP, PickStopsAtNodesDueForWidening) {
+  symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker rhcp(symreg::MCTS::scorer::UCB1{});
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  root.get_children()[0].set_parent(&root);
+  root.get_pending().push_back(symreg::search_node::pending_child{
+      std::make_unique<brick::AST::number_node>(2), &root, 1});
+  root.set_n(1);
+  root.set_widen_at(4);
+  ASSERT_EQ(rhcp.pick(&root)->get_ast_node()->to_string(), "1");
+
+  root.set_n(4);
+  ASSERT_EQ(rhcp.pick(&root), &root);
+
+  // a node whose children are all solved still has its pending moves
+  root.set_n(1);
+  root.get_children()[0].set_solved(true, 1);
+  ASSERT_EQ(rhcp.pick(&root), &root);
+}
+
 TEST(RRCP, PickReturnsAValidLeaf) {
   symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker rrcp;
   symreg::search_node root(std::make_unique<brick::AST::number_node>(0));
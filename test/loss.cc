@@ -0,0 +1,178 @@
+#include <iostream>
+#include <numeric>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+symreg::dataset big_dataset(int n) {
+  symreg::dataset ds;
+  for (int i = 0; i < n; i++) {
+    double x = (i - n / 2) / 100.0;
+    ds.x.push_back(x);
+    ds.y.push_back(3 * x * x + x + 1);
+  }
+  return ds;
+}
+
+template <class Loss>
+void expect_chunked_matches_sequential() {
+  auto ds = big_dataset(10000);
+  auto ast = std::shared_ptr<brick::AST::AST>(brick::AST::parse("x*x+2"));
+  Loss sequential;
+  sequential.set_chunked_eval(0, 1);
+  Loss chunked;
+  symreg::thread_pool pool(3);
+  chunked.set_chunked_eval(1000, 333, &pool);
+  double expected = sequential.loss(ds, ast);
+  ASSERT_NEAR(chunked.loss(ds, ast), expected, 1e-9 * std::abs(expected));
+}
+
+TEST(ChunkedLoss, MatchesSequentialMAE) {
+  expect_chunked_matches_sequential<symreg::loss_fn::MAE>();
+}
+
+TEST(ChunkedLoss, MatchesSequentialMSE) {
+  expect_chunked_matches_sequential<symreg::loss_fn::MSE>();
+}
+
+TEST(ChunkedLoss, MatchesSequentialNRMSD) {
+  expect_chunked_matches_sequential<symreg::loss_fn::NRMSD>();
+}
+
+TEST(ChunkedLoss, MatchesSequentialMAPE) {
+  expect_chunked_matches_sequential<symreg::loss_fn::MAPE>();
+}
+
+TEST(ChunkedLoss, MatchesSequentialColling) {
+  expect_chunked_matches_sequential<symreg::loss_fn::colling>();
+}
+
+TEST(ChunkedLoss, IsIndependentOfThreadCount) {
+  auto ds = big_dataset(20000);
+  auto ast = std::shared_ptr<brick::AST::AST>(brick::AST::parse("x*x*x"));
+  symreg::thread_pool one(1);
+  symreg::thread_pool four(4);
+  symreg::loss_fn::MSE a;
+  a.set_chunked_eval(1, 777, &one);
+  symreg::loss_fn::MSE b;
+  b.set_chunked_eval(1, 777, &four);
+  double expected = a.loss(ds, ast);
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ(b.loss(ds, ast), expected);
+  }
+}
+
+TEST(ChunkedLoss, SmallDatasetsStaySequential) {
+  auto ds = big_dataset(100);
+  auto ast = std::shared_ptr<brick::AST::AST>(brick::AST::parse("x+1"));
+  symreg::loss_fn::MSE defaults;
+  symreg::loss_fn::MSE sequential;
+  sequential.set_chunked_eval(0, 1);
+  ASSERT_EQ(defaults.loss(ds, ast), sequential.loss(ds, ast));
+}
+
+TEST(Colling, ExactFitHasNoLoss) {
+  auto ds = big_dataset(1000);
+  auto exact = std::shared_ptr<brick::AST::AST>(brick::AST::parse("3*x*x+x+1"));
+  auto close = std::shared_ptr<brick::AST::AST>(brick::AST::parse("3*x*x+1"));
+  symreg::loss_fn::colling colling;
+  ASSERT_NEAR(colling.loss(ds, exact), 0, 1e-9);
+  ASSERT_GT(colling.loss(ds, close), 1e-3);
+
+  // forward differences of a cubic aren't its derivative anywhere
+  symreg::dataset cubic;
+  for (int i = -20; i <= 20; i++) {
+    cubic.x.push_back(i);
+    cubic.y.push_back(i * i * i);
+  }
+  auto cube = std::shared_ptr<brick::AST::AST>(brick::AST::parse("x*x*x"));
+  ASSERT_NEAR(colling.loss(cubic, cube), 0, 1e-12);
+}
+
+TEST(ProtectedOps, KeepLossesFinite) {
+  auto ds = big_dataset(1000);
+  auto ast = std::shared_ptr<brick::AST::AST>(brick::AST::parse("1/x"));
+  symreg::loss_fn::MSE plain;
+  ASSERT_EQ(plain.loss(ds, ast), 1e100);
+  symreg::loss_fn::MSE guarded;
+  guarded.set_protected_ops(true);
+  double loss = guarded.loss(ds, ast);
+  ASSERT_LT(loss, 1e100);
+  ASSERT_GT(loss, 0);
+
+  symreg::loss_fn::NRMSD chunked;
+  symreg::thread_pool pool(2);
+  chunked.set_chunked_eval(100, 77, &pool);
+  chunked.set_protected_ops(true);
+  symreg::loss_fn::NRMSD sequential;
+  sequential.set_chunked_eval(0, 1);
+  sequential.set_protected_ops(true);
+  double expected = sequential.loss(ds, ast);
+  ASSERT_LT(expected, 1e100);
+  ASSERT_NEAR(chunked.loss(ds, ast), expected, 1e-9 * expected);
+}
+
+TEST(ProtectedOps, NonFinitePredictionsGetTheMaximumLoss) {
+  auto ds = big_dataset(1000);
+  auto ast = std::shared_ptr<brick::AST::AST>(brick::AST::parse("x/(x-x)"));
+  symreg::loss_fn::MAPE sequential;
+  sequential.set_chunked_eval(0, 1);
+  ASSERT_EQ(sequential.loss(ds, ast), 1);
+  symreg::loss_fn::MAE chunked;
+  chunked.set_chunked_eval(100, 77);
+  ASSERT_EQ(chunked.loss(ds, ast), 1e100);
+}
+
+TEST(ProtectedOps, ChunkedNRMSDMatchesSequentialOnNonFinitePredictions) {
+  auto ds = big_dataset(1000);
+  symreg::loss_fn::NRMSD chunked;
+  chunked.set_chunked_eval(100, 77);
+  symreg::loss_fn::NRMSD sequential;
+  sequential.set_chunked_eval(0, 1);
+  // every prediction, then only some, aren't finite
+  for (auto str : {"1/(x-x)", "1/x"}) {
+    auto ast = std::shared_ptr<brick::AST::AST>(brick::AST::parse(str));
+    double expected = sequential.loss(ds, ast);
+    ASSERT_GT(expected, 1e40) << str;
+    ASSERT_DOUBLE_EQ(chunked.loss(ds, ast), expected) << str;
+  }
+}
+
+TEST(MapChunks, CoversEveryItemInOrder) {
+  symreg::thread_pool pool(3);
+  auto chunks = symreg::map_chunks(pool, 10, 4, [](std::size_t begin, std::size_t end) {
+    return std::make_pair(begin, end);
+  });
+  ASSERT_EQ(chunks.size(), 3);
+  ASSERT_EQ(chunks[0].first, 0);
+  ASSERT_EQ(chunks[0].second, 4);
+  ASSERT_EQ(chunks[2].first, 8);
+  ASSERT_EQ(chunks[2].second, 10);
+  ASSERT_TRUE(symreg::map_chunks(pool, 0, 4, [](std::size_t, std::size_t) { return 0; }).empty());
+}
+
+TEST(MapChunks, WorksFromInsideThePool) {
+  symreg::thread_pool pool(1);
+  auto fut = pool.submit([&pool] {
+    auto sums = symreg::map_chunks(pool, 100, 10, [](std::size_t begin, std::size_t end) {
+      return static_cast<int>(end - begin);
+    });
+    return std::accumulate(sums.begin(), sums.end(), 0);
+  });
+  ASSERT_EQ(fut.get(), 100);
+}
+
+TEST(MapChunks, RethrowsExceptions) {
+  symreg::thread_pool pool(2);
+  ASSERT_THROW(symreg::map_chunks(pool, 100, 10, [](std::size_t begin, std::size_t) -> int {
+    if (begin == 50) {
+      throw std::runtime_error("boom");
+    }
+    return 0;
+  }), std::runtime_error);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+// writes a sysfs style node directory with one cpulist per node
+std::string fake_sysfs(const std::vector<std::string>& cpulists) {
+  std::string root = "numa_test_" + std::to_string(getpid());
+  mkdir(root.c_str(), 0755);
+  for (std::size_t node = 0; node < cpulists.size(); node++) {
+    std::string dir = root + "/node" + std::to_string(node);
+    mkdir(dir.c_str(), 0755);
+    std::ofstream(dir + "/cpulist") << cpulists[node] << std::endl;
+  }
+  return root;
+}
+
+void remove_fake_sysfs(const std::string& root, std::size_t num_nodes) {
+  for (std::size_t node = 0; node < num_nodes; node++) {
+    std::string dir = root + "/node" + std::to_string(node);
+    std::remove((dir + "/cpulist").c_str());
+    rmdir(dir.c_str());
+  }
+  rmdir(root.c_str());
+}
+
+TEST(ParseCpulist, HandlesRangesAndSingles) {
+  ASSERT_EQ(symreg::parse_cpulist("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_EQ(symreg::parse_cpulist("5"), (std::vector<int>{5}));
+  ASSERT_TRUE(symreg::parse_cpulist("").empty());
+}
+
+TEST(Topology, ReadsNodesFromSysfs) {
+  auto root = fake_sysfs({"0-1,4", "2-3,5"});
+  symreg::numa_topology topo(root);
+  remove_fake_sysfs(root, 2);
+  ASSERT_EQ(topo.num_nodes(), 2);
+  ASSERT_TRUE(topo.is_numa());
+  ASSERT_EQ(topo.cpus_of(1), (std::vector<int>{2, 3, 5}));
+  ASSERT_EQ(topo.node_of_cpu(4), 0);
+  ASSERT_EQ(topo.node_of_cpu(5), 1);
+  ASSERT_EQ(topo.node_of_cpu(99), 0);
+}
+
+TEST(Topology, FallsBackToOneNode) {
+  symreg::numa_topology topo("no_such_directory");
+  ASSERT_EQ(topo.num_nodes(), 1);
+  ASSERT_FALSE(topo.is_numa());
+  ASSERT_EQ(topo.current_node(), 0);
+  ASSERT_FALSE(symreg::pin_this_thread_to_node(topo, 0));
+}
+
+TEST(NodeReplicas, EveryNodeGetsItsOwnCopy) {
+  auto root = fake_sysfs({"0", "0"});
+  symreg::numa_topology topo(root);
+  remove_fake_sysfs(root, 2);
+  auto ds = symreg::generate_dataset([](int x) { return x * x; }, 5, 0, 5);
+  symreg::node_replicas<symreg::dataset> replicas(ds, topo);
+  ASSERT_EQ(replicas.size(), 2);
+  ASSERT_NE(&replicas.get(0), &replicas.get(1));
+  ASSERT_EQ(replicas.get(1).y, ds.y);
+  ASSERT_EQ(&replicas.local(), &replicas.get(0));
+}
+
+TEST(NodeReplicas, SingleNodeHasOneCopy) {
+  symreg::numa_topology topo("no_such_directory");
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 0, 5);
+  symreg::node_replicas<symreg::dataset> replicas(ds, topo);
+  ASSERT_EQ(replicas.size(), 1);
+  ASSERT_EQ(&replicas.get(3), &replicas.local());
+}
+
+struct counting_regressor {
+  void train(symreg::training_examples&) {}
+};
+
+struct fake_search {
+  std::size_t node;
+  std::atomic<int>& num_episodes;
+  fake_search(std::size_t node, std::atomic<int>& num_episodes)
+    : node(node), num_episodes(num_episodes)
+  {}
+  void reset() {}
+  void iterate() {
+    num_episodes++;
+  }
+  symreg::training_examples get_training_examples() {
+    return {};
+  }
+  std::shared_ptr<brick::AST::AST> get_result() {
+    return brick::AST::parse("x");
+  }
+};
+
+TEST(PolicyIterationDriver, SpreadsWorkersOverNodes) {
+  auto root = fake_sysfs({"0", "0"});
+  symreg::numa_topology topo(root);
+  remove_fake_sysfs(root, 2);
+  std::atomic<int> num_episodes(0);
+  std::vector<std::size_t> built_for;
+  counting_regressor regr;
+  symreg::policy_iteration_driver<counting_regressor, fake_search> driver(regr,
+    [&](std::size_t node) {
+      built_for.push_back(node);
+      return std::make_unique<fake_search>(node, num_episodes);
+    }, 3, topo);
+  ASSERT_EQ(built_for, (std::vector<std::size_t>{0, 1, 0}));
+  ASSERT_EQ(driver.get_node_of_worker(1), 1);
+  driver.set_num_iterations(1);
+  driver.set_num_episodes(6);
+  driver.iterate();
+  ASSERT_EQ(num_episodes, 6);
+}
+
+TEST(PolicyIterationDriver, RethrowsFactoryExceptions) {
+  auto root = fake_sysfs({"0", "0"});
+  symreg::numa_topology topo(root);
+  remove_fake_sysfs(root, 2);
+  std::atomic<int> num_episodes(0);
+  counting_regressor regr;
+  using driver_type = symreg::policy_iteration_driver<counting_regressor, fake_search>;
+  ASSERT_ANY_THROW(driver_type(regr,
+    [&](std::size_t node) -> std::unique_ptr<fake_search> {
+      if (node == 1) {
+        throw "FactoryException";
+      }
+      return std::make_unique<fake_search>(node, num_episodes);
+    }, 2, topo));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+struct counting_regressor {
+  int num_trained = 0;
+  std::size_t last_num_examples = 0;
+  void train(symreg::training_examples& examples) {
+    num_trained++;
+    last_num_examples = examples.size();
+  }
+};
+
+struct fake_search {
+  std::atomic<int>& num_episodes;
+  std::atomic<bool> in_use;
+  fake_search(std::atomic<int>& num_episodes)
+    : num_episodes(num_episodes), in_use(false)
+  {}
+  void reset() {
+    EXPECT_FALSE(in_use.exchange(true));
+  }
+  void iterate() {
+    num_episodes++;
+  }
+  symreg::training_examples get_training_examples() {
+    in_use = false;
+    return {symreg::training_example{"x", {1}, 1}};
+  }
+  std::shared_ptr<brick::AST::AST> get_result() {
+    return brick::AST::parse("x");
+  }
+};
+
+TEST(Iterate, PlaysEveryEpisodeSequentially) {
+  std::atomic<int> num_episodes(0);
+  counting_regressor regr;
+  fake_search search(num_episodes);
+  symreg::policy_iteration_driver<counting_regressor, fake_search> driver(regr, search);
+  driver.set_num_iterations(2);
+  driver.set_num_episodes(3);
+  driver.iterate();
+  ASSERT_EQ(num_episodes, 6);
+  ASSERT_EQ(regr.num_trained, 2);
+  ASSERT_EQ(driver.get_training_examples().size(), 6);
+}
+
+TEST(Iterate, PlaysEveryEpisodeConcurrently) {
+  std::atomic<int> num_episodes(0);
+  counting_regressor regr;
+  symreg::policy_iteration_driver<counting_regressor, fake_search> driver(regr,
+    [&num_episodes] { return std::make_unique<fake_search>(num_episodes); }, 4);
+  ASSERT_EQ(driver.get_num_workers(), 4);
+  driver.set_num_iterations(3);
+  driver.set_num_episodes(10);
+  driver.iterate();
+  ASSERT_EQ(num_episodes, 30);
+  ASSERT_EQ(regr.num_trained, 3);
+  ASSERT_EQ(regr.last_num_examples, 30);
+}
+
+struct failing_search : fake_search {
+  bool fails;
+  std::atomic<int>& num_running;
+  failing_search(std::atomic<int>& num_episodes, std::atomic<int>& num_running, bool fails)
+    : fake_search(num_episodes), fails(fails), num_running(num_running)
+  {}
+  void iterate() {
+    num_running++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(fails ? 5 : 20));
+    num_running--;
+    if (fails) {
+      throw "EpisodeException";
+    }
+    fake_search::iterate();
+  }
+};
+
+TEST(Iterate, WaitsForEveryWorkerBeforeRethrowing) {
+  std::atomic<int> num_episodes(0);
+  std::atomic<int> num_running(0);
+  int num_created = 0;
+  counting_regressor regr;
+  symreg::policy_iteration_driver<counting_regressor, failing_search> driver(regr,
+    [&] { return std::make_unique<failing_search>(num_episodes, num_running, num_created++ == 0); }, 4);
+  driver.set_num_iterations(1);
+  driver.set_num_episodes(100);
+  ASSERT_ANY_THROW(driver.iterate());
+  ASSERT_EQ(num_running, 0);
+  ASSERT_LT(num_episodes, 99);
+  ASSERT_EQ(regr.num_trained, 0);
+}
+
+TEST(Iterate, RunsRealSearchesConcurrently) {
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  symreg::DNN dnn(24);
+  using mcts_type = symreg::MCTS::MCTS<symreg::DNN>;
+  auto factory = [&ds, &dnn] {
+    auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+    auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+    auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+    symreg::MCTS::simulator::action_factory af;
+    symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 5, 1, &dnn);
+    return std::make_unique<mcts_type>(ds, sim, 50);
+  };
+  symreg::policy_iteration_driver<symreg::DNN, mcts_type> driver(dnn, factory, 3);
+  driver.set_num_iterations(1);
+  driver.set_num_episodes(6);
+  driver.iterate();
+  ASSERT_FALSE(driver.get_training_examples().empty());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -54,12 +54,6 @@ TEST(AddChildBySearchNode, Case1) {
   ASSERT_TRUE(node.get_children()[0].get_ast_node()->is_number()); 
 }
 
-TEST(SetScorer, Case1) {
-  search_node node(std::make_unique<brick::AST::posit_node>());
-  node.set_scorer([](double a, int b, int c) { return a + b + c; });
-  ASSERT_TRUE(true);
-}
-
 TEST(SetAndGetN, Case1) {
   search_node node(std::make_unique<brick::AST::posit_node>());
   node.set_n(842);
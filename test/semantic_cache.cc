@@ -0,0 +1,121 @@
+#include <iostream>
+#include <set>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+TEST(HashPredictions, EquivalentExpressionsHashTheSame) {
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  symreg::MCTS::semantic_cache cache;
+  auto twice = brick::AST::parse("x+x");
+  auto doubled = brick::AST::parse("2*x");
+  ASSERT_EQ(cache.key(ds, *twice), cache.key(ds, *doubled));
+
+  auto ratio = brick::AST::parse("x/x");
+  auto one = brick::AST::parse("1");
+  ASSERT_EQ(cache.key(ds, *ratio), cache.key(ds, *one));
+}
+
+TEST(HashPredictions, DifferentFunctionsHashDifferently) {
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  symreg::MCTS::semantic_cache cache;
+  auto above = brick::AST::parse("x+1");
+  auto below = brick::AST::parse("x-1");
+  ASSERT_NE(cache.key(ds, *above), cache.key(ds, *below));
+}
+
+TEST(HashPredictions, RoundsToTolerance) {
+  std::vector<double> a = {1, 2, -0.0};
+  std::vector<double> b = {1 + 1e-12, 2, 0};
+  ASSERT_EQ(symreg::MCTS::hash_predictions(a, 1e-9), symreg::MCTS::hash_predictions(b, 1e-9));
+  ASSERT_NE(symreg::MCTS::hash_predictions(a, 1e-14), symreg::MCTS::hash_predictions(b, 1e-14));
+
+  std::vector<double> nan = {std::nan(""), 1};
+  std::vector<double> other_nan = {-std::nan(""), 1};
+  ASSERT_EQ(symreg::MCTS::hash_predictions(nan, 1e-9), symreg::MCTS::hash_predictions(other_nan, 1e-9));
+}
+
+TEST(HashPredictions, LossPredictionsKeyLikeTheAST) {
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 100, -50, 50);
+  symreg::MCTS::semantic_cache cache;
+  std::vector<std::shared_ptr<symreg::loss_fn::loss_fn>> losses = {
+    std::make_shared<symreg::loss_fn::MAE>(),
+    std::make_shared<symreg::loss_fn::MSE>(),
+    std::make_shared<symreg::loss_fn::NRMSD>(),
+    std::make_shared<symreg::loss_fn::MAPE>(),
+    std::make_shared<symreg::loss_fn::colling>()
+  };
+  for (auto& loss : losses) {
+    for (bool chunked : {false, true}) {
+      if (chunked) {
+        loss->set_chunked_eval(10, 7);
+      }
+      for (auto s : {"x*x+1", "1/x", "x"}) {
+        std::shared_ptr<brick::AST::AST> ast = brick::AST::parse(s);
+        std::vector<double> y_hat;
+        loss->loss(ds, ast, &y_hat);
+        ASSERT_EQ(y_hat.size(), ds.x.size());
+        ASSERT_EQ(cache.key(y_hat), cache.key(ds, *ast));
+      }
+    }
+  }
+}
+
+TEST(SemanticCache, CountsEquivalentCandidates) {
+  symreg::MCTS::semantic_cache cache;
+  ASSERT_TRUE(cache.insert(1));
+  ASSERT_TRUE(cache.insert(2));
+  ASSERT_FALSE(cache.insert(1));
+  ASSERT_FALSE(cache.insert(1));
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_EQ(cache.get_num_equivalent(), 2);
+  cache.clear();
+  ASSERT_EQ(cache.size(), 0);
+  ASSERT_EQ(cache.get_num_equivalent(), 0);
+}
+
+TEST(SemanticCache, DedupesTopN) {
+  auto ds = symreg::generate_dataset([](int x) { return 2 * x; }, 5, 1, 6);
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(ds);
+
+  // equal rewards alone don't make expressions duplicates
+  sim.push_priq(brick::AST::parse("x+x"));
+  sim.push_priq(brick::AST::parse("2*x"));
+  ASSERT_EQ(sim.dump_pri_q().size(), 2);
+
+  sim.reset();
+  sim.set_semantic_cache(std::make_shared<symreg::MCTS::semantic_cache>());
+  sim.push_priq(brick::AST::parse("x+x"));
+  sim.push_priq(brick::AST::parse("2*x"));
+  sim.push_priq(brick::AST::parse("x"));
+  ASSERT_EQ(sim.dump_pri_q().size(), 2);
+  ASSERT_EQ(sim.get_num_equivalent(), 1);
+}
+
+TEST(SemanticCache, SimulationOnlyCountsVisitsOfEquivalentRollouts) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 4, 2, nullptr);
+  sim.set_semantic_cache(std::make_shared<symreg::MCTS::semantic_cache>());
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 300);
+
+  ASSERT_GT(sim.get_num_equivalent(), 0);
+  ASSERT_EQ(root.get_n(), sim.get_num_explored());
+
+  // no two expressions in the top N compute the same function
+  std::set<std::size_t> keys;
+  for (auto& ast : sim.dump_pri_q()) {
+    ASSERT_TRUE(keys.insert(sim.get_semantic_cache()->key(ds, *ast)).second);
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
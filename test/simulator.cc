@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "symreg.hpp"
@@ -199,6 +201,297 @@ TEST(AddActions, AddsActionsAccordingToDepthLimit2) {
   ASSERT_EQ(addition.get_children().size(), af.get_set(100).size()); 
 }
 
+// a regressor whose policy puts all of its weight on addition nodes
+struct addition_regressor {
+  int num_inferences = 0;
+  std::pair<double, std::vector<double>> inference(std::string) {
+    num_inferences++;
+    std::vector<double> policy(24, 0);
+    policy[brick::AST::addition_node().get_node_type()] = 1;
+    return std::make_pair(.5, policy);
+  }
+  std::vector<std::pair<double, std::vector<double>>> inference_batch(const std::vector<std::string>& states) {
+    std::vector<std::pair<double, std::vector<double>>> results;
+    for (auto& state : states) {
+      results.push_back(inference(state));
+    }
+    return results;
+  }
+};
+
+TEST(AddActions, GivesUniformPriorsWithoutRegressor) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::PUCT>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::PUCT>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 9, 1, nullptr);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  ASSERT_TRUE(sim.add_actions(&root));
+  double n = root.get_children().size();
+  for (auto& child : root.get_children()) {
+    ASSERT_DOUBLE_EQ(child.get_p(), 1 / n);
+  }
+}
+
+TEST(AddActions, TakesPriorsFromOneInference) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::PUCT>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::PUCT>>();
+  symreg::MCTS::simulator::action_factory af;
+  addition_regressor regr;
+  symreg::MCTS::simulator::simulator<addition_regressor> sim(mab, loss, lp, af, ds, 9, 1, &regr);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  ASSERT_TRUE(sim.add_actions(&root));
+  ASSERT_EQ(regr.num_inferences, 1);
+  auto type = brick::AST::addition_node().get_node_type();
+  double total = 0;
+  for (auto& child : root.get_children()) {
+    if (child.get_ast_node()->get_node_type() == type) {
+      ASSERT_GT(child.get_p(), 0);
+    } else {
+      ASSERT_EQ(child.get_p(), 0);
+    }
+    total += child.get_p();
+  }
+  ASSERT_DOUBLE_EQ(total, 1);
+
+  // the first selection follows the prior
+  ASSERT_EQ(lp->pick(&root)->get_ast_node()->get_node_type(), type);
+}
+
+TEST(AddActions, SkipsInferenceForScorersWithoutPriors) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  addition_regressor regr;
+  symreg::MCTS::simulator::simulator<addition_regressor> sim(mab, loss, lp, af, ds, 9, 1, &regr);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  ASSERT_TRUE(sim.add_actions(&root));
+  ASSERT_EQ(regr.num_inferences, 0);
+}
+
+// expands the second operand of op(first), returning the operands the
+// pruner let through
+std::vector<std::string> expand_second_operand(symreg::MCTS::simulator::action_pruner pruner,
+    std::unique_ptr<brick::AST::node> op, std::unique_ptr<brick::AST::node> first,
+    std::size_t* num_pruned = nullptr) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 9, 1, nullptr);
+  sim.set_action_pruner(pruner);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  root.set_depth(1);
+  root.add_child(std::move(op));
+  auto& parent = root.get_children().front();
+  parent.set_up_link(&root);
+  parent.set_parent(&root);
+  parent.set_depth(2);
+  parent.set_unconnected(2);
+  parent.add_child(std::move(first));
+  auto& operand = parent.get_children().front();
+  operand.set_up_link(&parent);
+  operand.set_parent(&parent);
+  operand.set_depth(3);
+  operand.set_unconnected(1);
+  EXPECT_TRUE(sim.add_actions(&operand));
+
+  std::vector<std::string> operands;
+  for (auto& child : operand.get_children()) {
+    operands.push_back(child.get_ast_node()->to_string());
+  }
+  if (num_pruned) {
+    *num_pruned = sim.get_action_pruner().get_num_pruned();
+  }
+  return operands;
+}
+
+bool contains(const std::vector<std::string>& v, const std::string& s) {
+  return std::find(v.begin(), v.end(), s) != v.end();
+}
+
+TEST(ActionPruner, KeepsEveryActionWithNoRules) {
+  symreg::MCTS::simulator::action_factory af;
+  std::size_t num_pruned;
+  auto operands = expand_second_operand(symreg::MCTS::simulator::action_pruner(),
+      std::make_unique<brick::AST::addition_node>(), std::make_unique<brick::AST::number_node>(4), &num_pruned);
+  ASSERT_EQ(operands.size(), af.get_set(100).size());
+  ASSERT_EQ(num_pruned, 0);
+}
+
+TEST(ActionPruner, OrdersOperandsOfCommutativeOperators) {
+  symreg::MCTS::simulator::action_pruner pruner(true, false, false);
+  std::size_t num_pruned;
+  auto operands = expand_second_operand(pruner,
+      std::make_unique<brick::AST::addition_node>(), std::make_unique<brick::AST::number_node>(4), &num_pruned);
+  // 2+4 and 3+4 are searched instead of 4+2 and 4+3
+  ASSERT_FALSE(contains(operands, "2"));
+  ASSERT_FALSE(contains(operands, "3"));
+  ASSERT_TRUE(contains(operands, "4"));
+  ASSERT_GE(num_pruned, 2);
+
+  // subtraction doesn't commute
+  operands = expand_second_operand(pruner,
+      std::make_unique<brick::AST::subtraction_node>(), std::make_unique<brick::AST::number_node>(4));
+  ASSERT_TRUE(contains(operands, "2"));
+  ASSERT_TRUE(contains(operands, "3"));
+}
+
+TEST(ActionPruner, DropsFoldableConstantOperations) {
+  symreg::MCTS::simulator::action_pruner pruner(false, false, true);
+  std::size_t num_pruned;
+  // 2+2 is 4, which is an action itself, while 2+3 and 2+4 aren't
+  auto operands = expand_second_operand(pruner,
+      std::make_unique<brick::AST::addition_node>(), std::make_unique<brick::AST::number_node>(2), &num_pruned);
+  ASSERT_FALSE(contains(operands, "2"));
+  ASSERT_TRUE(contains(operands, "3"));
+  ASSERT_TRUE(contains(operands, "4"));
+  ASSERT_EQ(num_pruned, 1);
+}
+
+TEST(ActionPruner, DropsDoubleNegation) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_random_child_picker>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 9, 1, nullptr);
+  sim.set_action_pruner(symreg::MCTS::simulator::action_pruner(false, true, false));
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  root.set_depth(1);
+  root.add_child(std::make_unique<brick::AST::negate_node>());
+  auto& negate = root.get_children().front();
+  negate.set_up_link(&root);
+  negate.set_parent(&root);
+  negate.set_depth(2);
+  negate.set_unconnected(1);
+  ASSERT_TRUE(sim.add_actions(&negate));
+  ASSERT_EQ(negate.get_children().size(), af.get_set(100).size() - 1);
+  for (auto& child : negate.get_children()) {
+    ASSERT_FALSE(child.get_ast_node()->is_negate());
+  }
+}
+
+TEST(WideningRule, NextDueMatchesAllowedWidth) {
+  for (auto rule : {symreg::MCTS::widening_rule{1, .5}, symreg::MCTS::widening_rule{2, .3},
+      symreg::MCTS::widening_rule{.5, 1}}) {
+    for (std::size_t children = 1; children < 20; children++) {
+      int n = rule.next_due(children);
+      ASSERT_GT(rule.allowed(n), children);
+      ASSERT_TRUE(n == 1 || rule.allowed(n - 1) <= children);
+    }
+  }
+}
+
+TEST(Widening, AttachesChildrenAsVisitsGrow) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 9, 1, nullptr);
+  sim.set_widening_rule(symreg::MCTS::widening_rule{1, .5});
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  ASSERT_TRUE(sim.add_actions(&root));
+  std::size_t num_moves = af.get_set(100).size();
+  ASSERT_EQ(root.get_children().size(), 1);
+  ASSERT_EQ(root.get_pending().size(), num_moves - 1);
+  ASSERT_FALSE(root.is_widening_due());
+
+  // sqrt(4) = 2 children from 4 visits on
+  root.set_n(4);
+  ASSERT_TRUE(root.is_widening_due());
+  ASSERT_EQ(lp->pick(&root), &root);
+}
+
+TEST(Widening, AttachesBestPriorsFirst) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::PUCT>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::PUCT>>();
+  symreg::MCTS::simulator::action_factory af;
+  addition_regressor regr;
+  symreg::MCTS::simulator::simulator<addition_regressor> sim(mab, loss, lp, af, ds, 9, 1, &regr);
+  sim.set_widening_rule(symreg::MCTS::widening_rule{1, .5});
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  ASSERT_TRUE(sim.add_actions(&root));
+  ASSERT_EQ(regr.num_inferences, 1);
+  ASSERT_EQ(root.get_children().size(), 1);
+  ASSERT_TRUE(root.get_children()[0].get_ast_node()->is_addition());
+  ASSERT_DOUBLE_EQ(root.get_children()[0].get_p(), 1);
+}
+
+TEST(Widening, BreaksTiesByActionOrder) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 9, 1, nullptr);
+  sim.set_widening_rule(symreg::MCTS::widening_rule{1, .5});
+
+  // workers of a distributed search seed the generator differently
+  std::vector<std::vector<std::string>> orders;
+  for (int seed : {1, 2}) {
+    symreg::mt.seed(seed);
+    symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+    sim.add_actions(&root);
+    // the attached child, then the pending ones from the next to the last
+    std::vector<std::string> order;
+    for (auto& child : root.get_children()) {
+      order.push_back(child.get_ast_node()->to_string());
+    }
+    auto& pending = root.get_pending();
+    for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+      order.push_back(it->ast_node->to_string());
+    }
+    orders.push_back(order);
+  }
+  ASSERT_EQ(orders[0].size(), af.get_set(100).size());
+  ASSERT_EQ(orders[0], orders[1]);
+  ASSERT_EQ(orders[0].front(), af.get_set(100).front()->to_string());
+}
+
+TEST(Widening, SimulationKeepsTreeWithinWidth) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x * x; }, 5, 1, 6);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 7, 2, nullptr);
+  symreg::MCTS::widening_rule rule{1, .5};
+  sim.set_widening_rule(rule);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 40);
+
+  std::size_t num_moves = af.get_set(100).size();
+  ASSERT_EQ(root.get_children().size(), std::min(num_moves, rule.allowed(root.get_n())));
+  ASSERT_LT(root.get_children().size(), num_moves);
+  // attaching children late never moves the ones attached before
+  for (auto& child : root.get_children()) {
+    ASSERT_EQ(child.get_parent(), &root);
+    ASSERT_LE(child.get_children().size(), std::max<std::size_t>(1, rule.allowed(child.get_n())));
+    for (auto& grandchild : child.get_children()) {
+      ASSERT_EQ(grandchild.get_parent(), &child);
+    }
+  }
+}
+
 TEST(Simulate, ExpandsTreeIfPossible) {
   auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
   symreg::dataset ds;
@@ -249,6 +542,276 @@ TEST(Simulate, DoesntExpandTreeIfDepthMaximized) {
   ASSERT_EQ(one.get_children().size(), 0);
 }
 
+TEST(VirtualLoss, RevertRestoresPathStatistics) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  auto& one = root.get_children().front();
+  one.set_parent(&root);
+  root.set_n(4);
+  root.set_q(.5);
+  one.set_n(2);
+  one.set_q(.25);
+
+  double penalty = symreg::MCTS::simulator::virtual_loss_penalty(&one);
+  ASSERT_EQ(penalty, 0);
+  symreg::MCTS::simulator::apply_virtual_loss(&one, penalty);
+  ASSERT_EQ(one.get_n(), 3);
+  ASSERT_LT(one.get_q(), .25);
+  symreg::MCTS::simulator::revert_virtual_loss(&one, penalty);
+  ASSERT_EQ(root.get_n(), 4);
+  ASSERT_DOUBLE_EQ(root.get_q(), .5);
+  ASSERT_EQ(one.get_n(), 2);
+  ASSERT_DOUBLE_EQ(one.get_q(), .25);
+}
+
+TEST(VirtualLoss, LowersNegativeRewards) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  auto& one = root.get_children().front();
+  one.set_parent(&root);
+  symreg::MCTS::simulator::backprop(-3, &one);
+  symreg::MCTS::simulator::backprop(-1, &root);
+
+  // a reward of 0 would raise both means. the penalty is bounded by -1
+  double penalty = symreg::MCTS::simulator::virtual_loss_penalty(&one);
+  ASSERT_DOUBLE_EQ(penalty, -1);
+  symreg::MCTS::simulator::apply_virtual_loss(&one, penalty);
+  ASSERT_DOUBLE_EQ(one.get_q(), -2);
+  ASSERT_DOUBLE_EQ(root.get_q(), -5. / 3);
+
+  // a reward backpropagated in the meantime is kept when reverting
+  symreg::MCTS::simulator::backprop(-5, &one);
+  symreg::MCTS::simulator::revert_virtual_loss(&one, penalty);
+  ASSERT_EQ(one.get_n(), 2);
+  ASSERT_DOUBLE_EQ(one.get_q(), -4);
+  ASSERT_EQ(root.get_n(), 3);
+}
+
+TEST(VirtualLoss, DivergingRolloutDoesNotWipeOutThePath) {
+  for (auto rule_str : {"mean", "mixed"}) {
+    auto rule = symreg::MCTS::backup_rule::from_string(rule_str);
+    symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+    root.add_child(std::make_unique<brick::AST::number_node>(1));
+    root.add_child(std::make_unique<brick::AST::number_node>(2));
+    auto& good = root.get_children()[0];
+    auto& diverged = root.get_children()[1];
+    good.set_parent(&root);
+    diverged.set_parent(&root);
+    for (double reward : {.2, .3, .4}) {
+      symreg::MCTS::simulator::backprop(reward, &good, rule);
+    }
+    // a rollout whose loss hit the cap
+    symreg::MCTS::simulator::backprop(1 - 1e100, &diverged, rule);
+    double good_q = good.get_q();
+    double root_q = root.get_q();
+
+    double penalty = symreg::MCTS::simulator::virtual_loss_penalty(&good, rule);
+    ASSERT_DOUBLE_EQ(penalty, -1) << rule_str;
+    symreg::MCTS::simulator::apply_virtual_loss(&good, penalty, rule);
+    ASSERT_LT(good.get_q(), good_q) << rule_str;
+    symreg::MCTS::simulator::revert_virtual_loss(&good, penalty, rule);
+    ASSERT_EQ(good.get_n(), 3) << rule_str;
+    ASSERT_DOUBLE_EQ(good.get_q(), good_q) << rule_str;
+    ASSERT_EQ(root.get_n(), 4) << rule_str;
+    ASSERT_DOUBLE_EQ(root.get_q(), root_q) << rule_str;
+  }
+}
+
+TEST(Backprop, MeanRuleKeepsRunningMean) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  symreg::MCTS::simulator::backprop(1, &root);
+  symreg::MCTS::simulator::backprop(0, &root);
+  symreg::MCTS::simulator::backprop(.5, &root);
+  ASSERT_EQ(root.get_n(), 3);
+  ASSERT_DOUBLE_EQ(root.get_q(), .5);
+  ASSERT_DOUBLE_EQ(root.get_max_q(), 1);
+}
+
+TEST(Backprop, MaxRuleKeepsBestReward) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  auto& one = root.get_children().front();
+  one.set_parent(&root);
+  auto rule = symreg::MCTS::backup_rule::from_string("max");
+  symreg::MCTS::simulator::backprop(.1, &one, rule);
+  symreg::MCTS::simulator::backprop(.9, &one, rule);
+  symreg::MCTS::simulator::backprop(.2, &one, rule);
+  ASSERT_DOUBLE_EQ(one.get_q(), .9);
+  ASSERT_DOUBLE_EQ(root.get_q(), .9);
+  ASSERT_DOUBLE_EQ(one.get_mean_q(), .4);
+}
+
+TEST(Backprop, MaxRuleKeepsBestNegativeReward) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  auto rule = symreg::MCTS::backup_rule::from_string("max");
+  symreg::MCTS::simulator::backprop(-3, &root, rule);
+  symreg::MCTS::simulator::backprop(-5, &root, rule);
+  ASSERT_DOUBLE_EQ(root.get_q(), -3);
+  ASSERT_DOUBLE_EQ(root.get_max_q(), -3);
+  ASSERT_DOUBLE_EQ(root.get_mean_q(), -4);
+}
+
+TEST(Backprop, MixedRuleBlendsMeanAndBest) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  auto rule = symreg::MCTS::backup_rule::from_string("mixed", .25);
+  symreg::MCTS::simulator::backprop(.2, &root, rule);
+  symreg::MCTS::simulator::backprop(.6, &root, rule);
+  ASSERT_DOUBLE_EQ(root.get_q(), .75 * .4 + .25 * .6);
+}
+
+TEST(Backprop, UnknownRuleThrows) {
+  ASSERT_ANY_THROW(symreg::MCTS::backup_rule::from_string("median"));
+}
+
+TEST(VirtualLoss, RevertRestoresMixedRuleStatistics) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  auto rule = symreg::MCTS::backup_rule::from_string("mixed");
+  symreg::MCTS::simulator::backprop(.2, &root, rule);
+  symreg::MCTS::simulator::backprop(.6, &root, rule);
+  double q = root.get_q();
+
+  double penalty = symreg::MCTS::simulator::virtual_loss_penalty(&root, rule);
+  symreg::MCTS::simulator::apply_virtual_loss(&root, penalty, rule);
+  ASSERT_LT(root.get_q(), q);
+  symreg::MCTS::simulator::revert_virtual_loss(&root, penalty, rule);
+  ASSERT_EQ(root.get_n(), 2);
+  ASSERT_DOUBLE_EQ(root.get_q(), q);
+}
+
+TEST(Simulate, MaxBackupTracksBestRollout) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x * x; }, 5, 1, 6);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 6, 2, nullptr);
+  sim.set_backup_rule(symreg::MCTS::backup_rule::from_string("max"));
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 64);
+
+  auto best = sim.dump_scored_pri_q().back().second;
+  ASSERT_DOUBLE_EQ(root.get_q(), root.get_max_q());
+  ASSERT_DOUBLE_EQ(root.get_q(), best);
+  for (auto& child : root.get_children()) {
+    ASSERT_LE(child.get_q(), root.get_q());
+  }
+}
+
+TEST(MarkSolved, SolvesParentsOnceEveryChildIs) {
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  root.add_child(std::make_unique<brick::AST::number_node>(1));
+  root.add_child(std::make_unique<brick::AST::number_node>(2));
+  for (auto& child : root.get_children()) {
+    child.set_parent(&root);
+  }
+
+  symreg::MCTS::simulator::mark_solved(&root.get_children()[0], .7);
+  ASSERT_TRUE(root.get_children()[0].is_solved());
+  ASSERT_FALSE(root.is_solved());
+  symreg::MCTS::simulator::mark_solved(&root.get_children()[1], .4);
+  ASSERT_TRUE(root.is_solved());
+  ASSERT_DOUBLE_EQ(root.get_solved_value(), .7);
+}
+
+TEST(Simulate, StopsOnceEveryASTIsEvaluated) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x; }, 5, 1, 6);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 1, 2, nullptr);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 1000);
+
+  // with a depth limit of 1, every child of the root is a complete AST
+  ASSERT_TRUE(root.is_solved());
+  ASSERT_EQ(sim.get_num_explored(), root.get_children().size());
+  double best = 0;
+  for (auto& child : root.get_children()) {
+    ASSERT_TRUE(child.is_solved());
+    ASSERT_EQ(child.get_n(), 1);
+    best = std::max(best, child.get_solved_value());
+  }
+  ASSERT_DOUBLE_EQ(root.get_solved_value(), best);
+}
+
+TEST(Simulate, PipelinedSimulationAppliesEveryResult) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  ds.x = {1, 2, 3};
+  ds.y = {4, 5, 6};
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>(symreg::MCTS::scorer::UCB1{});
+  symreg::MCTS::simulator::action_factory af;
+
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 8, 2, nullptr);
+  sim.set_pipeline(3, 8);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 200);
+
+  auto& stats = sim.get_pipeline_stats();
+  ASSERT_EQ(stats.num_jobs, sim.get_num_explored());
+  ASSERT_LE(stats.max_occupancy, 8);
+  ASSERT_GE(root.get_n(), static_cast<int>(sim.get_num_explored()));
+  ASSERT_FALSE(sim.dump_pri_q().empty());
+}
+
+struct throwing_loss : symreg::loss_fn::loss_fn {
+  double loss(symreg::dataset&, symreg::loss_fn::ast_ptr&, std::vector<double>*) override {
+    throw "UnsupportedNodeException";
+  }
+};
+
+TEST(Simulate, PipelinedSimulationRethrowsEvaluationErrors) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  ds.x = {1, 2, 3};
+  ds.y = {4, 5, 6};
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>(symreg::MCTS::scorer::UCB1{});
+  symreg::MCTS::simulator::action_factory af;
+
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, std::make_shared<throwing_loss>(), lp, af, ds, 8, 2, nullptr);
+  sim.set_pipeline(3, 8);
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  ASSERT_ANY_THROW(sim.simulate(&root, 100));
+  // the virtual losses of every job in flight were taken back
+  ASSERT_EQ(root.get_n(), 0);
+  ASSERT_EQ(sim.get_pipeline_stats().num_jobs, sim.get_num_explored());
+}
+
+TEST(Simulate, PipelinedSimulationDrainsWhenStopped) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  symreg::dataset ds;
+  ds.x = {1, 2, 3};
+  ds.y = {4, 5, 6};
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>(symreg::MCTS::scorer::UCB1{});
+  symreg::MCTS::simulator::action_factory af;
+
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 8, 2, nullptr);
+  sim.set_pipeline(3, 8);
+  sim.set_stop_condition(symreg::MCTS::stop_condition(
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+
+  symreg::search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 100000000);
+
+  ASSERT_TRUE(sim.should_stop());
+  ASSERT_EQ(sim.get_pipeline_stats().num_jobs, sim.get_num_explored());
+  ASSERT_GE(root.get_n(), static_cast<int>(sim.get_num_explored()));
+  // without a constant fitter, a leaf costs one evaluation
+  ASSERT_EQ(sim.get_num_evaluations(), sim.get_num_explored());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <thread>
+
+#include "spsc_queue.hpp"
+#include "gtest/gtest.h"
+
+TEST(Construction, RoundsCapacityUpToPowerOfTwo) {
+  symreg::spsc_queue<int> q(5);
+  ASSERT_EQ(q.capacity(), 8);
+  ASSERT_TRUE(q.empty());
+}
+
+TEST(TryPush, FailsWhenFull) {
+  symreg::spsc_queue<int> q(2);
+  ASSERT_TRUE(q.try_push(1));
+  ASSERT_TRUE(q.try_push(2));
+  ASSERT_FALSE(q.try_push(3));
+  int out;
+  ASSERT_TRUE(q.try_pop(out));
+  ASSERT_EQ(out, 1);
+  ASSERT_TRUE(q.try_push(3));
+  ASSERT_EQ(q.size(), 2);
+}
+
+TEST(TryPop, FailsWhenEmpty) {
+  symreg::spsc_queue<int> q(4);
+  int out;
+  ASSERT_FALSE(q.try_pop(out));
+}
+
+TEST(TryPop, PreservesOrderAcrossThreads) {
+  const int n = 100000;
+  symreg::spsc_queue<int> q(64);
+  std::thread producer([&q, n] {
+    for (int i = 0; i < n; i++) {
+      while (!q.try_push(int(i))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  int expected = 0;
+  while (expected < n) {
+    int out;
+    if (q.try_pop(out)) {
+      ASSERT_EQ(out, expected);
+      expected++;
+    }
+  }
+  producer.join();
+  ASSERT_TRUE(q.empty());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
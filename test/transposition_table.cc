@@ -0,0 +1,107 @@
+#include <iostream>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+using search_node = symreg::search_node;
+
+// adds a child to parent in the search tree whose AST node hangs off up_link
+search_node& add_move(search_node& parent, search_node& up_link, std::unique_ptr<brick::AST::node> ast_node) {
+  parent.add_child(std::move(ast_node));
+  auto& child = parent.get_children().back();
+  child.set_parent(&parent);
+  child.set_up_link(&up_link);
+  return child;
+}
+
+TEST(HashAST, SameASTThroughDifferentMovesHashesTheSame) {
+  // +(*(2), x) once by filling + before *, once the other way around
+  search_node root1(std::make_unique<brick::AST::posit_node>());
+  auto& add1 = add_move(root1, root1, std::make_unique<brick::AST::addition_node>());
+  auto& mul1 = add_move(add1, add1, std::make_unique<brick::AST::multiplication_node>());
+  auto& x_first = add_move(mul1, add1, std::make_unique<brick::AST::id_node>("x"));
+  auto& two_second = add_move(x_first, mul1, std::make_unique<brick::AST::number_node>(2));
+
+  search_node root2(std::make_unique<brick::AST::posit_node>());
+  auto& add2 = add_move(root2, root2, std::make_unique<brick::AST::addition_node>());
+  auto& mul2 = add_move(add2, add2, std::make_unique<brick::AST::multiplication_node>());
+  auto& two_first = add_move(mul2, mul2, std::make_unique<brick::AST::number_node>(2));
+  auto& x_second = add_move(two_first, add2, std::make_unique<brick::AST::id_node>("x"));
+
+  auto a = symreg::MCTS::simulator::build_ast_upward(&two_second);
+  auto b = symreg::MCTS::simulator::build_ast_upward(&x_second);
+  ASSERT_EQ(a->to_string(), b->to_string());
+  ASSERT_EQ(symreg::MCTS::hash_ast(*a), symreg::MCTS::hash_ast(*b));
+  ASSERT_NE(symreg::MCTS::hash_ast(*a),
+      symreg::MCTS::hash_ast(*symreg::MCTS::simulator::build_ast_upward(&x_first)));
+}
+
+TEST(HashAST, OperandOrderMatters) {
+  auto a = brick::AST::parse("x+2");
+  auto b = brick::AST::parse("2+x");
+  ASSERT_NE(symreg::MCTS::hash_ast(*a), symreg::MCTS::hash_ast(*b));
+}
+
+TEST(TranspositionTable, EquivalentNodesShareStatistics) {
+  symreg::MCTS::transposition_table table;
+  search_node a(std::make_unique<brick::AST::id_node>("x"));
+  search_node b(std::make_unique<brick::AST::id_node>("x"));
+  a.set_state_key(42);
+  b.set_state_key(42);
+  a.set_n(3);
+  a.set_q(.5);
+  a.set_max_q(.9);
+  table.push(a);
+
+  ASSERT_TRUE(table.pull(b));
+  ASSERT_EQ(b.get_n(), 3);
+  ASSERT_DOUBLE_EQ(b.get_q(), .5);
+  ASSERT_DOUBLE_EQ(b.get_max_q(), .9);
+  ASSERT_EQ(table.get_num_hits(), 1);
+
+  // nothing new to catch up with
+  ASSERT_FALSE(table.pull(a));
+  b.set_solved(true, .9);
+  table.push(b);
+  ASSERT_TRUE(table.pull(a));
+  ASSERT_TRUE(a.is_solved());
+}
+
+TEST(TranspositionTable, UnkeyedNodesAreLeftOut) {
+  symreg::MCTS::transposition_table table;
+  search_node a(std::make_unique<brick::AST::id_node>("x"));
+  a.set_n(3);
+  table.push(a);
+  ASSERT_EQ(table.size(), 0);
+  ASSERT_FALSE(table.pull(a));
+}
+
+TEST(Simulate, SharesStatisticsBetweenTranspositions) {
+  auto mab = std::make_shared<symreg::MCTS::scorer::UCB1>();
+  auto ds = symreg::generate_dataset([](int x) { return x * x + x; }, 5, 1, 6);
+  auto loss = std::make_shared<symreg::loss_fn::NRMSD>();
+  auto lp = std::make_shared<symreg::MCTS::simulator::leaf_picker::recursive_heuristic_child_picker<symreg::MCTS::scorer::UCB1>>();
+  symreg::MCTS::simulator::action_factory af;
+  symreg::MCTS::simulator::simulator<symreg::DNN> sim(mab, loss, lp, af, ds, 6, 2, nullptr);
+  auto table = std::make_shared<symreg::MCTS::transposition_table>();
+  sim.set_transposition_table(table);
+
+  search_node root(std::make_unique<brick::AST::posit_node>());
+  sim.add_actions(&root);
+  sim.simulate(&root, 500);
+
+  ASSERT_GT(table->size(), root.get_children().size());
+  ASSERT_GT(table->get_num_hits(), 0);
+  for (auto& child : root.get_children()) {
+    ASSERT_NE(child.get_state_key(), 0);
+    ASSERT_NE(table->find(child.get_state_key()), nullptr);
+  }
+
+  sim.reset();
+  ASSERT_EQ(table->size(), 0);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -9,6 +9,14 @@ TEST(GetRandomInt, ReturnsIntegerWithinRange) {
   ASSERT_LE(random, 10);
 }
 
+TEST(NumericalDerivative, DividesWholeDifferences) {
+  std::vector<double> y = {1, 4, 9, 16};
+  auto deriv = symreg::util::numerical_derivative(y, .5);
+  ASSERT_EQ(deriv, std::vector<double>({6, 10, 14}));
+  std::vector<double> empty;
+  ASSERT_TRUE(symreg::util::numerical_derivative(empty, 1).empty());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
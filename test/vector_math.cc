@@ -0,0 +1,75 @@
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "symreg.hpp"
+#include "gtest/gtest.h"
+
+using kernel = void (*)(const double*, double*, std::size_t);
+
+// how many ulp a is away from b
+double ulp_error(double a, double b) {
+  if (a == b || (std::isnan(a) && std::isnan(b))) {
+    return 0;
+  }
+  double ulp = std::nextafter(std::abs(b), std::numeric_limits<double>::infinity()) - std::abs(b);
+  return std::abs(a - b) / ulp;
+}
+
+double max_ulp_error(kernel f, double (*ref)(double), std::vector<double> x) {
+  std::vector<double> y(x.size());
+  f(x.data(), y.data(), x.size());
+  double worst = 0;
+  for (std::size_t i = 0; i < x.size(); i++) {
+    worst = std::max(worst, ulp_error(y[i], ref(x[i])));
+  }
+  return worst;
+}
+
+std::vector<double> uniform(double lo, double hi, bool log_scale = false) {
+  std::mt19937_64 gen(42);
+  std::uniform_real_distribution<double> dist(lo, hi);
+  std::vector<double> x(100000);
+  for (auto& v : x) {
+    v = log_scale ? std::pow(10, dist(gen)) : dist(gen);
+  }
+  return x;
+}
+
+TEST(VectorMath, StaysWithinTwoUlp) {
+  ASSERT_LE(max_ulp_error(symreg::vmath::exp, std::exp, uniform(-745, 709.7)), 2);
+  ASSERT_LE(max_ulp_error(symreg::vmath::exp, std::exp, uniform(-1, 1)), 2);
+  ASSERT_LE(max_ulp_error(symreg::vmath::log, std::log, uniform(-320, 308, true)), 2);
+  ASSERT_LE(max_ulp_error(symreg::vmath::log, std::log, uniform(.5, 2)), 2);
+  ASSERT_LE(max_ulp_error(symreg::vmath::sin, std::sin, uniform(-10, 10)), 2);
+  ASSERT_LE(max_ulp_error(symreg::vmath::sin, std::sin, uniform(-1e6, 1e6)), 2);
+  ASSERT_LE(max_ulp_error(symreg::vmath::cos, std::cos, uniform(-10, 10)), 2);
+  ASSERT_LE(max_ulp_error(symreg::vmath::cos, std::cos, uniform(-1e6, 1e6)), 2);
+  ASSERT_EQ(max_ulp_error(symreg::vmath::sqrt, std::sqrt, uniform(-300, 300, true)), 0);
+}
+
+TEST(VectorMath, HandlesSpecialValues) {
+  double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> x = {0, inf, -inf, std::nan(""), 1e300, -1e-320, 5e-324, 710, -746, -1, 1e7};
+  for (auto pair : {std::make_pair<kernel, double (*)(double)>(symreg::vmath::exp, std::exp),
+      std::make_pair<kernel, double (*)(double)>(symreg::vmath::log, std::log),
+      std::make_pair<kernel, double (*)(double)>(symreg::vmath::sin, std::sin),
+      std::make_pair<kernel, double (*)(double)>(symreg::vmath::cos, std::cos)}) {
+    ASSERT_LE(max_ulp_error(pair.first, pair.second, x), 2);
+  }
+}
+
+TEST(VectorMath, WorksInPlace) {
+  std::vector<double> x = {.5, 3e7, -2};
+  std::vector<double> expected = {std::sin(.5), std::sin(3e7), std::sin(-2)};
+  symreg::vmath::sin(x.data(), x.data(), x.size());
+  for (std::size_t i = 0; i < x.size(); i++) {
+    ASSERT_LE(ulp_error(x[i], expected[i]), 2);
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}